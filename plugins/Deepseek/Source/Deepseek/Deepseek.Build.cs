@@ -46,6 +46,8 @@ public class Deepseek : ModuleRules
 				"ApplicationCore",
 				"Json",
 				"HTTP",
+				"Sockets",
+				"Networking",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
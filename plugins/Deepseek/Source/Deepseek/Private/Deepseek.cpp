@@ -9,9 +9,18 @@
 #include "Widgets/Text/STextBlock.h"
 #include "ToolMenus.h"
 #include "SDeepseekAIChat.h"
+#include "DeepseekResponseCache.h"
+#include "DeepseekRequestScheduler.h"
+#include "DeepseekHedgePolicy.h"
+#include "DeepseekProviderPool.h"
+#include "DeepseekRequestStats.h"
+#include "DeepseekUsageLedger.h"
+#include "DeepseekHttpTrace.h"
 #include "Framework/Notifications/NotificationManager.h"
 #include "Widgets/Notifications/SNotificationList.h"
 
+DEFINE_LOG_CATEGORY(LogDeepseek);
+
 static const FName DeepseekTabName("Deepseek");
 
 // 在这里设置你的OpenAI API密钥
@@ -28,6 +37,14 @@ void FDeepseekModule::StartupModule()
 	FDeepseekStyle::ReloadTextures();
 
 	FDeepseekCommands::Register();
+
+	FDeepseekResponseCache::Initialize();
+	FDeepseekRequestScheduler::Initialize();
+	FDeepseekHedgePolicy::Initialize();
+	FDeepseekProviderPool::Initialize();
+	FDeepseekRequestStats::Initialize();
+	FDeepseekUsageLedger::Initialize();
+	FDeepseekHttpTrace::Initialize();
 	
 	PluginCommands = MakeShareable(new FUICommandList);
 
@@ -65,6 +82,14 @@ void FDeepseekModule::ShutdownModule()
 
 	FDeepseekCommands::Unregister();
 
+	FDeepseekHttpTrace::Shutdown();
+	FDeepseekUsageLedger::Shutdown();
+	FDeepseekRequestStats::Shutdown();
+	FDeepseekProviderPool::Shutdown();
+	FDeepseekHedgePolicy::Shutdown();
+	FDeepseekRequestScheduler::Shutdown();
+	FDeepseekResponseCache::Shutdown();
+
 	FGlobalTabmanager::Get()->UnregisterNomadTabSpawner(DeepseekTabName);
 }
 
@@ -0,0 +1,311 @@
+#include "Deepseek.h"
+#include "DeepseekOpenAIService.h"
+#include "DeepseekResponseDecoder.h"
+#include "DeepseekSimilarPromptIndex.h"
+#include "DeepseekLoadBenchmark.h"
+#include "DeepseekSessionLog.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+
+/**
+ * 控制台微基准测试
+ * 在编辑器控制台中运行，用于比较不同实现的耗时
+ */
+namespace DeepseekBenchmarks
+{
+	/** 生成内容约为ContentBytes字节的合成响应，包含需要转义的字符和中文 */
+	static FString MakeSyntheticResponse(int32 ContentBytes)
+	{
+		static const TCHAR* Paragraph = TEXT("UE5中的Actor生命周期：BeginPlay -> Tick -> EndPlay。\\n示例：\\\"UPROPERTY(EditAnywhere)\\\" float Speed = 600.f;\\n");
+
+		FString Content;
+		Content.Reserve(ContentBytes + 256);
+		while (Content.Len() < ContentBytes)
+		{
+			Content.Append(Paragraph);
+		}
+
+		return FString::Printf(
+			TEXT("{\"id\":\"bench-0001\",\"object\":\"chat.completion\",\"created\":1700000000,\"model\":\"deepseek-chat\",")
+			TEXT("\"choices\":[{\"index\":0,\"message\":{\"role\":\"assistant\",\"content\":\"%s\"},\"logprobs\":null,\"finish_reason\":\"stop\"}],")
+			TEXT("\"usage\":{\"prompt_tokens\":1200,\"completion_tokens\":8000,\"total_tokens\":9200},\"system_fingerprint\":\"fp_bench\"}"),
+			*Content);
+	}
+
+	/** 旧的DOM解析路径，作为对照 */
+	static bool ParseResponseWithDom(const FString& ResponseString, FOpenAIResponse& OutResponse)
+	{
+		TSharedPtr<FJsonObject> JsonObject;
+		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ResponseString);
+		if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+		{
+			return false;
+		}
+
+		OutResponse.Id = JsonObject->GetStringField(TEXT("id"));
+		OutResponse.Object = JsonObject->GetStringField(TEXT("object"));
+		OutResponse.Created = JsonObject->GetIntegerField(TEXT("created"));
+		OutResponse.Model = JsonObject->GetStringField(TEXT("model"));
+
+		for (const TSharedPtr<FJsonValue>& ChoiceValue : JsonObject->GetArrayField(TEXT("choices")))
+		{
+			TSharedPtr<FJsonObject> ChoiceObject = ChoiceValue->AsObject();
+			FOpenAIChoice Choice;
+			Choice.Index = ChoiceObject->GetIntegerField(TEXT("index"));
+			Choice.FinishReason = ChoiceObject->GetStringField(TEXT("finish_reason"));
+
+			TSharedPtr<FJsonObject> MessageObject = ChoiceObject->GetObjectField(TEXT("message"));
+			Choice.Message.Role = MessageObject->GetStringField(TEXT("role"));
+			Choice.Message.Content = MessageObject->GetStringField(TEXT("content"));
+			OutResponse.Choices.Add(Choice);
+		}
+
+		TSharedPtr<FJsonObject> UsageObject = JsonObject->GetObjectField(TEXT("usage"));
+		OutResponse.Usage.PromptTokens = UsageObject->GetIntegerField(TEXT("prompt_tokens"));
+		OutResponse.Usage.CompletionTokens = UsageObject->GetIntegerField(TEXT("completion_tokens"));
+		OutResponse.Usage.TotalTokens = UsageObject->GetIntegerField(TEXT("total_tokens"));
+
+		return true;
+	}
+
+	/** Deepseek.BenchResponseDecoder [内容KB=256] [迭代次数=50] */
+	static void BenchResponseDecoder(const TArray<FString>& Args)
+	{
+		const int32 SizeKB = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 256;
+		const int32 Iterations = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 50;
+
+		const FString Body = MakeSyntheticResponse(SizeKB * 1024);
+
+		double DomSeconds = 0.0;
+		double DecoderSeconds = 0.0;
+		int32 Mismatches = 0;
+
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			FOpenAIResponse DomResponse;
+			double StartTime = FPlatformTime::Seconds();
+			ParseResponseWithDom(Body, DomResponse);
+			DomSeconds += FPlatformTime::Seconds() - StartTime;
+
+			// 两条路径都从一份响应字符串的拷贝开始，与DecodeResponse中的实际情况一致
+			FOpenAIResponse DecodedResponse;
+			FString BodyCopy = Body;
+			StartTime = FPlatformTime::Seconds();
+			FDeepseekResponseDecoder::DecodeResponse(MoveTemp(BodyCopy), DecodedResponse);
+			DecoderSeconds += FPlatformTime::Seconds() - StartTime;
+
+			if (DomResponse.Choices.Num() != DecodedResponse.Choices.Num()
+				|| (DomResponse.Choices.Num() > 0 && DomResponse.Choices[0].Message.Content != DecodedResponse.Choices[0].Message.Content)
+				|| DomResponse.Usage.TotalTokens != DecodedResponse.Usage.TotalTokens)
+			{
+				++Mismatches;
+			}
+		}
+
+		UE_LOG(LogDeepseek, Display, TEXT("BenchResponseDecoder: 响应 %d KB, %d 次"), static_cast<int32>(Body.Len() * sizeof(TCHAR) / 1024), Iterations);
+		UE_LOG(LogDeepseek, Display, TEXT("  DOM:     平均 %.3f ms"), DomSeconds * 1000.0 / Iterations);
+		UE_LOG(LogDeepseek, Display, TEXT("  Decoder: 平均 %.3f ms (%.2fx)"), DecoderSeconds * 1000.0 / Iterations, DecoderSeconds > 0.0 ? DomSeconds / DecoderSeconds : 0.0);
+		if (Mismatches > 0)
+		{
+			UE_LOG(LogDeepseek, Error, TEXT("  两种解析结果不一致: %d 次"), Mismatches);
+		}
+	}
+
+	static FAutoConsoleCommand BenchResponseDecoderCommand(
+		TEXT("Deepseek.BenchResponseDecoder"),
+		TEXT("比较DOM解析与流式解码器的耗时。用法: Deepseek.BenchResponseDecoder [内容KB] [迭代次数]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchResponseDecoder));
+
+	/** 生成第Index条合成提问，Variant改变其中的行号与空白，规范化后相同 */
+	static FString MakeSyntheticPrompt(int32 Index, int32 Variant)
+	{
+		static const TCHAR* Words[] = { TEXT("Actor"), TEXT("蓝图"), TEXT("Tick"), TEXT("空指针"), TEXT("GC"), TEXT("材质"), TEXT("动画"), TEXT("UPROPERTY"), TEXT("崩溃"), TEXT("网络同步"), TEXT("Niagara"), TEXT("打包") };
+
+		FRandomStream Stream(Index);
+		FString Prompt = FString::Printf(TEXT("解释这个错误：Error at line %d:%s"), 100 + Variant * 7, Variant % 2 ? TEXT("  ") : TEXT(" "));
+		for (int32 WordIndex = 0; WordIndex < 12; ++WordIndex)
+		{
+			Prompt.Append(Words[Stream.RandHelper(UE_ARRAY_COUNT(Words))]);
+			Prompt.AppendChar(TEXT(' '));
+		}
+		return Prompt;
+	}
+
+	/** Deepseek.BenchSimilarPromptIndex [条目数=100000] [查询次数=10000] */
+	static void BenchSimilarPromptIndex(const TArray<FString>& Args)
+	{
+		const int32 NumEntries = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100000;
+		const int32 NumQueries = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 10000;
+
+		// 所有条目使用同一个上下文，即首轮提问的最坏情况
+		FDeepseekSimilarPromptIndex Index;
+		Index.SetMaxEntries(NumEntries);
+
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 EntryIndex = 0; EntryIndex < NumEntries; ++EntryIndex)
+		{
+			const FString Prompt = MakeSyntheticPrompt(EntryIndex, 0);
+			FDeepseekPromptSignature Signature;
+			Signature.SimHash = FDeepseekSimilarPromptIndex::ComputeSimHash(FDeepseekSimilarPromptIndex::NormalizePrompt(Prompt));
+			Signature.PromptHash = FCrc::StrCrc32(*Prompt);
+
+			FSHAHash Key;
+			FSHA1::HashBuffer(&EntryIndex, sizeof(EntryIndex), Key.Hash);
+			Index.Add(Signature, Key);
+		}
+		const double BuildSeconds = FPlatformTime::Seconds() - StartTime;
+
+		// 签名计算与查找分开计时，前者与提问长度有关，后者与索引大小有关
+		TArray<FDeepseekPromptSignature> Queries;
+		Queries.SetNum(NumQueries);
+		StartTime = FPlatformTime::Seconds();
+		for (int32 QueryIndex = 0; QueryIndex < NumQueries; ++QueryIndex)
+		{
+			const FString Prompt = MakeSyntheticPrompt(QueryIndex * 7 % NumEntries, 1 + QueryIndex % 5);
+			Queries[QueryIndex].SimHash = FDeepseekSimilarPromptIndex::ComputeSimHash(FDeepseekSimilarPromptIndex::NormalizePrompt(Prompt));
+			Queries[QueryIndex].PromptHash = FCrc::StrCrc32(*Prompt);
+		}
+		const double SignatureSeconds = FPlatformTime::Seconds() - StartTime;
+
+		int32 Found = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (const FDeepseekPromptSignature& Query : Queries)
+		{
+			FSHAHash Key;
+			int32 Distance = 0;
+			if (Index.FindNearest(Query, FDeepseekSimilarPromptIndex::DefaultMaxDistance, Key, Distance))
+			{
+				++Found;
+			}
+		}
+		const double LookupSeconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogDeepseek, Display, TEXT("BenchSimilarPromptIndex: %d 条, %d 次查询, 建立 %.1f ms"), Index.Num(), NumQueries, BuildSeconds * 1000.0);
+		UE_LOG(LogDeepseek, Display, TEXT("  签名: 平均 %.2f us"), SignatureSeconds * 1000000.0 / NumQueries);
+		UE_LOG(LogDeepseek, Display, TEXT("  查找: 平均 %.2f us, 命中 %d"), LookupSeconds * 1000000.0 / NumQueries, Found);
+	}
+
+	static FAutoConsoleCommand BenchSimilarPromptIndexCommand(
+		TEXT("Deepseek.BenchSimilarPromptIndex"),
+		TEXT("测量近似提问索引的签名与查找耗时。用法: Deepseek.BenchSimilarPromptIndex [条目数] [查询次数]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchSimilarPromptIndex));
+
+	/** Deepseek.BenchSessionLog [日志大小MB=50] */
+	static void BenchSessionLog(const TArray<FString>& Args)
+	{
+		const int64 TargetBytes = (Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 50) * 1024ll * 1024;
+		const FString LogPath = FPaths::ProjectSavedDir() / TEXT("Deepseek") / TEXT("Bench") / TEXT("SessionLog.dslog");
+
+		// 一问一答交替，回答长短不一
+		double StartTime = FPlatformTime::Seconds();
+		{
+			// 清掉上次运行留下的文件
+			FDeepseekSessionLog::Create(LogPath)->Delete();
+			TSharedRef<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = FDeepseekSessionLog::Create(LogPath);
+
+			FRandomStream Stream(25);
+			const FString Answer = MakeSyntheticResponse(8 * 1024);
+			int32 Index = 0;
+			while (Log->GetFileSize() < TargetBytes)
+			{
+				Log->Append(FDeepseekSessionLog::ERole::User, TEXT("用户"), MakeSyntheticPrompt(Index, 0));
+				Log->Append(FDeepseekSessionLog::ERole::Assistant, TEXT("AI助手"), Answer.Left(256 + Stream.RandHelper(Answer.Len() - 256)));
+				++Index;
+			}
+		}
+		const double WriteSeconds = FPlatformTime::Seconds() - StartTime;
+
+		const uint64 StartMemory = FPlatformMemory::GetStats().UsedPhysical;
+		StartTime = FPlatformTime::Seconds();
+		TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = FDeepseekSessionLog::Open(LogPath);
+		const double OpenSeconds = FPlatformTime::Seconds() - StartTime;
+		if (!Log.IsValid())
+		{
+			UE_LOG(LogDeepseek, Error, TEXT("BenchSessionLog: 无法打开 %s"), *LogPath);
+			return;
+		}
+
+		// 与打开会话时相同：只读取最后一页
+		const int32 PageSize = 50;
+		TArray<FDeepseekSessionLog::FRecord> Records;
+		StartTime = FPlatformTime::Seconds();
+		Log->ReadMessages(FMath::Max(0, Log->Num() - PageSize), FMath::Min(Log->Num(), PageSize), Records);
+		const double TailSeconds = FPlatformTime::Seconds() - StartTime;
+		const double MemoryMB = (static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - static_cast<int64>(StartMemory)) / (1024.0 * 1024.0);
+
+		// 向上翻页，每次一页
+		const int32 NumPages = FMath::Min(20, Log->Num() / PageSize);
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Page = 1; Page <= NumPages; ++Page)
+		{
+			Records.Reset();
+			Log->ReadMessages(Log->Num() - (Page + 1) * PageSize, PageSize, Records);
+		}
+		const double PageSeconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogDeepseek, Display, TEXT("BenchSessionLog: %d 条消息, %.1f MB, 生成 %.1f s"), Log->Num(), Log->GetFileSize() / (1024.0 * 1024.0), WriteSeconds);
+		UE_LOG(LogDeepseek, Display, TEXT("  打开: %.2f ms, 读取最后一页: %.2f ms, 内存增加 %.1f MB"), OpenSeconds * 1000.0, TailSeconds * 1000.0, MemoryMB);
+		UE_LOG(LogDeepseek, Display, TEXT("  向上翻页: 平均 %.2f ms"), NumPages > 0 ? PageSeconds * 1000.0 / NumPages : 0.0);
+
+		Log->Delete();
+	}
+
+	static FAutoConsoleCommand BenchSessionLogCommand(
+		TEXT("Deepseek.BenchSessionLog"),
+		TEXT("测量长会话记录的打开、读取最后一页与向上翻页耗时。用法: Deepseek.BenchSessionLog [日志大小MB]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchSessionLog));
+
+	/** 正在运行的压测，同一时间只有一个 */
+	static TSharedPtr<FDeepseekLoadBenchmark> ActiveLoadBenchmark;
+
+	/** Deepseek.LoadBench [Concurrency=16] [Requests=200] [Stream=1] [模拟服务参数] */
+	static void RunLoadBenchmark(const TArray<FString>& Args)
+	{
+		if (ActiveLoadBenchmark.IsValid())
+		{
+			UE_LOG(LogDeepseek, Warning, TEXT("LoadBench: 上一次压测尚未结束"));
+			return;
+		}
+
+		const FString Joined = FString::Join(Args, TEXT(" "));
+		int32 Concurrency = 16;
+		int32 TotalRequests = 200;
+		bool bStream = true;
+		FParse::Value(*Joined, TEXT("Concurrency="), Concurrency);
+		FParse::Value(*Joined, TEXT("Requests="), TotalRequests);
+		FParse::Bool(*Joined, TEXT("Stream="), bStream);
+		Concurrency = FMath::Clamp(Concurrency, 1, 512);
+		TotalRequests = FMath::Max(TotalRequests, Concurrency);
+
+		FDeepseekMockServerSettings ServerSettings;
+		ServerSettings.ParseFrom(*Joined);
+
+		TSharedRef<FDeepseekLoadBenchmark> Benchmark = MakeShared<FDeepseekLoadBenchmark>(Concurrency, TotalRequests, bStream);
+		Benchmark->OnFinished = []()
+		{
+			// 仍在服务的回调中，下一帧再释放服务与模拟服务
+			FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float DeltaTime)
+			{
+				ActiveLoadBenchmark.Reset();
+				return false;
+			}));
+		};
+		ActiveLoadBenchmark = Benchmark;
+		if (!Benchmark->Start(ServerSettings))
+		{
+			ActiveLoadBenchmark.Reset();
+			return;
+		}
+
+		UE_LOG(LogDeepseek, Display, TEXT("LoadBench: 已开始，并发 %d，共 %d 个请求"), Benchmark->GetEffectiveConcurrency(), TotalRequests);
+	}
+
+	static FAutoConsoleCommand LoadBenchmarkCommand(
+		TEXT("Deepseek.LoadBench"),
+		TEXT("对本地模拟服务进行端到端压测，报告吞吐、延迟分位数与游戏线程耗时。")
+		TEXT("用法: Deepseek.LoadBench [Concurrency=16] [Requests=200] [Stream=1] [TTFT=0.3] [TPS=50] [Tokens=200] [Chars=2] [Chunk=1] [Error=0] [RateLimit=0]")
+		TEXT("；给出Trace=文件时回放录制的响应，Speed=0表示不等待"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunLoadBenchmark));
+}
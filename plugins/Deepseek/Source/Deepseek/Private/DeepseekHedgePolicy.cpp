@@ -0,0 +1,112 @@
+#include "DeepseekHedgePolicy.h"
+#include "Misc/ConfigCacheIni.h"
+
+TUniquePtr<FDeepseekHedgePolicy> FDeepseekHedgePolicy::Instance;
+
+/** 额度上限，避免长时间没有对冲后连续大量对冲 */
+static const double MaxHedgeCredit = 3.0;
+
+void FDeepseekHedgePolicy::Initialize()
+{
+	if (!Instance.IsValid())
+	{
+		Instance.Reset(new FDeepseekHedgePolicy());
+
+		FString ApiUrl;
+		FString ApiKey;
+		FString Model;
+		GConfig->GetString(TEXT("DeepseekAISettings"), TEXT("HedgeApiUrl"), ApiUrl, GEngineIni);
+		GConfig->GetString(TEXT("DeepseekAISettings"), TEXT("HedgeApiKey"), ApiKey, GEngineIni);
+		GConfig->GetString(TEXT("DeepseekAISettings"), TEXT("HedgeModel"), Model, GEngineIni);
+		Instance->SetSecondary(ApiUrl, ApiKey, Model);
+
+		float HedgePercentile = 95.0f;
+		float HedgeMaxRatio = 0.05f;
+		float HedgeMinDelaySeconds = 1.0f;
+		GConfig->GetFloat(TEXT("DeepseekAISettings"), TEXT("HedgePercentile"), HedgePercentile, GEngineIni);
+		GConfig->GetFloat(TEXT("DeepseekAISettings"), TEXT("HedgeMaxRatio"), HedgeMaxRatio, GEngineIni);
+		GConfig->GetFloat(TEXT("DeepseekAISettings"), TEXT("HedgeMinDelaySeconds"), HedgeMinDelaySeconds, GEngineIni);
+		Instance->SetPolicy(HedgePercentile, HedgeMaxRatio, HedgeMinDelaySeconds);
+	}
+}
+
+void FDeepseekHedgePolicy::Shutdown()
+{
+	Instance.Reset();
+}
+
+FDeepseekHedgePolicy* FDeepseekHedgePolicy::Get()
+{
+	return Instance.Get();
+}
+
+FDeepseekHedgePolicy::FDeepseekHedgePolicy()
+	: Percentile(95.0f)
+	, MaxHedgeRatio(0.05f)
+	, MinDelaySeconds(1.0f)
+	, NextSample(0)
+	, HedgeCredit(0.0)
+{
+	Samples.Reserve(MaxSamples);
+}
+
+void FDeepseekHedgePolicy::SetSecondary(const FString& InApiUrl, const FString& InApiKey, const FString& InModel)
+{
+	SecondaryApiUrl = InApiUrl;
+	SecondaryApiKey = InApiKey;
+	SecondaryModel = InModel;
+}
+
+void FDeepseekHedgePolicy::SetPolicy(float InPercentile, float InMaxHedgeRatio, float InMinDelaySeconds)
+{
+	Percentile = FMath::Clamp(InPercentile, 50.0f, 99.9f);
+	MaxHedgeRatio = FMath::Clamp(InMaxHedgeRatio, 0.0f, 1.0f);
+	MinDelaySeconds = FMath::Max(0.0f, InMinDelaySeconds);
+}
+
+void FDeepseekHedgePolicy::AddFirstByteSample(double Seconds)
+{
+	if (Samples.Num() < MaxSamples)
+	{
+		Samples.Add(Seconds);
+	}
+	else
+	{
+		Samples[NextSample] = Seconds;
+	}
+	NextSample = (NextSample + 1) % MaxSamples;
+}
+
+double FDeepseekHedgePolicy::OnRequestStarted()
+{
+	++Stats.Requests;
+	HedgeCredit = FMath::Min(MaxHedgeCredit, HedgeCredit + MaxHedgeRatio);
+
+	if (!IsEnabled() || Samples.Num() < MinSamples)
+	{
+		return -1.0;
+	}
+
+	return FMath::Max(static_cast<double>(MinDelaySeconds), ComputePercentile());
+}
+
+bool FDeepseekHedgePolicy::TryAcquireHedge()
+{
+	if (!IsEnabled() || HedgeCredit < 1.0)
+	{
+		return false;
+	}
+
+	HedgeCredit -= 1.0;
+	++Stats.Hedges;
+	return true;
+}
+
+double FDeepseekHedgePolicy::ComputePercentile() const
+{
+	TArray<double, TInlineAllocator<MaxSamples>> Sorted(Samples);
+	Sorted.Sort();
+
+	const int32 Index = FMath::Clamp(FMath::CeilToInt(Sorted.Num() * Percentile / 100.0f) - 1, 0, Sorted.Num() - 1);
+	return Sorted[Index];
+}
@@ -0,0 +1,167 @@
+#include "DeepseekHistoryCompactor.h"
+#include "DeepseekTokenizer.h"
+
+/** 摘要消息的前缀，用于识别并在下次压缩时一并折叠 */
+static const TCHAR* SummaryPrefix = TEXT("以下是之前对话的摘要：\n");
+
+/** 请求摘要时使用的系统提示词 */
+static const TCHAR* SummaryInstruction = TEXT("请把下面的对话压缩成简洁的摘要，保留关键事实、已做出的决定、代码中的类名函数名和尚未解决的问题，不要添加对话中没有的内容。");
+
+/** 摘要回复的token上限 */
+static const int32 SummaryMaxTokens = 800;
+
+/** 至少保留的最新消息数 */
+static const int32 MinRecentMessages = 4;
+
+FDeepseekHistoryCompactor::FDeepseekHistoryCompactor()
+	: ThresholdTokens(24000)
+	, bCompacting(false)
+	, Generation(0)
+{
+	SummaryService = MakeShared<FDeepseekOpenAIService>();
+	SummaryService->SetContextBudget(64000, SummaryMaxTokens);
+}
+
+void FDeepseekHistoryCompactor::Initialize(const FString& InApiKey, const FString& InModel, const FString& InApiUrl)
+{
+	SummaryService->Initialize(InApiKey, InModel, InApiUrl);
+}
+
+void FDeepseekHistoryCompactor::SetThreshold(int32 InThresholdTokens)
+{
+	ThresholdTokens = FMath::Max(0, InThresholdTokens);
+}
+
+void FDeepseekHistoryCompactor::Cancel()
+{
+	// 摘要已不再需要，断开请求
+	SummaryRequest.Cancel();
+	++Generation;
+	bCompacting = false;
+}
+
+bool FDeepseekHistoryCompactor::MaybeCompact(const TArray<FOpenAIMessage>& History, TFunction<void(int32, const FString&)> OnCompacted)
+{
+	if (bCompacting || ThresholdTokens <= 0)
+	{
+		return false;
+	}
+
+	const int32 NumFolded = SelectFoldCount(History);
+	if (NumFolded <= 0)
+	{
+		return false;
+	}
+
+	// 把要折叠的轮次拼成一条待总结的文本，请求独立于主对话
+	const int32 FirstIndex = GetFirstFoldIndex(History);
+	FString Transcript;
+	for (int32 Index = FirstIndex; Index < FirstIndex + NumFolded; ++Index)
+	{
+		const FOpenAIMessage& Message = History[Index];
+		Transcript.Append(IsSummaryMessage(Message) ? TEXT("[之前的摘要]") : FString::Printf(TEXT("[%s]"), *Message.Role));
+		Transcript.AppendChar(TEXT('\n'));
+		Transcript.Append(*Message.Content, Message.Content.Len());
+		Transcript.Append(TEXT("\n\n"));
+	}
+
+	TArray<FOpenAIMessage> SummaryMessages;
+	SummaryMessages.Add(FOpenAIMessage(TEXT("system"), SummaryInstruction));
+	SummaryMessages.Add(FOpenAIMessage(TEXT("user"), Transcript));
+	SummaryService->ResetContext();
+
+	bCompacting = true;
+	const uint32 RequestGeneration = Generation;
+	TWeakPtr<FDeepseekHistoryCompactor> WeakThis = AsShared();
+
+	// 摘要在后台进行，排在用户的提问之后
+	FDeepseekRequestOptions Options;
+	Options.Priority = EDeepseekRequestPriority::Background;
+
+	SummaryRequest = SummaryService->SendChatRequest(SummaryMessages, [WeakThis, RequestGeneration, NumFolded, OnCompacted = MoveTemp(OnCompacted)](const FDeepseekChatReplyRef& Reply)
+	{
+		TSharedPtr<FDeepseekHistoryCompactor> This = WeakThis.Pin();
+		if (!This.IsValid() || This->Generation != RequestGeneration)
+		{
+			return;
+		}
+
+		This->bCompacting = false;
+
+		// 摘要失败时保持历史不变，下一轮再尝试
+		if (Reply->bSuccess && !Reply->Content.IsEmpty())
+		{
+			OnCompacted(NumFolded, Reply->Content);
+		}
+	}, Options);
+
+	return true;
+}
+
+void FDeepseekHistoryCompactor::ApplySummary(TArray<FOpenAIMessage>& History, int32 NumFolded, const FString& Summary)
+{
+	const int32 FirstIndex = GetFirstFoldIndex(History);
+	if (NumFolded <= 0 || FirstIndex + NumFolded > History.Num())
+	{
+		return;
+	}
+
+	History.RemoveAt(FirstIndex, NumFolded, false);
+	History.Insert(FOpenAIMessage(TEXT("system"), FString(SummaryPrefix) + Summary), FirstIndex);
+}
+
+bool FDeepseekHistoryCompactor::IsSummaryMessage(const FOpenAIMessage& Message)
+{
+	return Message.Role == TEXT("system") && Message.Content.View().StartsWith(SummaryPrefix, ESearchCase::CaseSensitive);
+}
+
+int32 FDeepseekHistoryCompactor::GetFirstFoldIndex(const TArray<FOpenAIMessage>& History)
+{
+	// 固定保留最前面的系统提示词，之前的摘要本身也会被再次折叠
+	return (History.Num() > 0 && History[0].Role == TEXT("system") && !IsSummaryMessage(History[0])) ? 1 : 0;
+}
+
+int32 FDeepseekHistoryCompactor::SelectFoldCount(const TArray<FOpenAIMessage>& History) const
+{
+	int32 TotalTokens = 0;
+	for (const FOpenAIMessage& Message : History)
+	{
+		TotalTokens += FDeepseekTokenizer::CountMessageTokens(Message);
+	}
+
+	if (TotalTokens <= ThresholdTokens)
+	{
+		return 0;
+	}
+
+	// 从最新消息向前保留约一半阈值的内容，其余折叠
+	const int32 FirstIndex = GetFirstFoldIndex(History);
+	int32 KeepTokens = 0;
+	int32 SplitIndex = History.Num();
+	while (SplitIndex > FirstIndex)
+	{
+		const int32 MessageTokens = FDeepseekTokenizer::CountMessageTokens(History[SplitIndex - 1]);
+		if (History.Num() - SplitIndex >= MinRecentMessages && KeepTokens + MessageTokens > ThresholdTokens / 2)
+		{
+			break;
+		}
+		KeepTokens += MessageTokens;
+		--SplitIndex;
+	}
+
+	// 保留的部分从用户消息开始，不拆开一问一答
+	while (SplitIndex < History.Num() && History[SplitIndex].Role != TEXT("user"))
+	{
+		++SplitIndex;
+	}
+
+	const int32 NumFolded = SplitIndex - FirstIndex;
+
+	// 只有一条旧摘要可折叠时没有意义
+	if (NumFolded < 2 || SplitIndex >= History.Num())
+	{
+		return 0;
+	}
+
+	return NumFolded;
+}
@@ -0,0 +1,247 @@
+#include "DeepseekHttpTrace.h"
+#include "Deepseek.h"
+#include "DeepseekMockServer.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+TUniquePtr<FDeepseekHttpTrace> FDeepseekHttpTrace::Instance;
+
+/** 文件头 */
+static const uint32 TraceMagic = 0x52545344;	// "DSTR"
+static const uint32 TraceVersion = 1;
+
+void FDeepseekTraceExchange::AddChunk(const uint8* Data, int32 Num)
+{
+	FDeepseekTraceChunk& Chunk = Chunks.AddDefaulted_GetRef();
+	Chunk.OffsetMs = static_cast<uint32>(FMath::Max(0.0, FPlatformTime::Seconds() - StartTime) * 1000.0);
+	Chunk.Bytes.Append(Data, Num);
+}
+
+/** 读写一次交换 */
+static void SerializeExchange(FArchive& Ar, FDeepseekTraceExchange& Exchange)
+{
+	uint8 bStream = Exchange.bStream ? 1 : 0;
+	Ar << Exchange.RequestBody << bStream << Exchange.ResponseCode << Exchange.ContentType << Exchange.RetryAfter;
+	Exchange.bStream = bStream != 0;
+
+	int32 NumChunks = Exchange.Chunks.Num();
+	Ar << NumChunks;
+	if (Ar.IsLoading())
+	{
+		// 损坏的文件不应导致巨大的分配
+		if (NumChunks < 0 || NumChunks > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return;
+		}
+		Exchange.Chunks.SetNum(NumChunks);
+	}
+
+	for (FDeepseekTraceChunk& Chunk : Exchange.Chunks)
+	{
+		Ar << Chunk.OffsetMs << Chunk.Bytes;
+		if (Ar.IsError())
+		{
+			return;
+		}
+	}
+}
+
+void FDeepseekHttpTrace::Initialize()
+{
+	if (!Instance.IsValid())
+	{
+		Instance.Reset(new FDeepseekHttpTrace());
+	}
+}
+
+void FDeepseekHttpTrace::Shutdown()
+{
+	Instance.Reset();
+}
+
+FDeepseekHttpTrace* FDeepseekHttpTrace::Get()
+{
+	return Instance.Get();
+}
+
+FDeepseekHttpTrace::FDeepseekHttpTrace()
+	: NumRecorded(0)
+{
+}
+
+FDeepseekHttpTrace::~FDeepseekHttpTrace()
+{
+	Stop();
+}
+
+bool FDeepseekHttpTrace::StartRecording(const FString& FilePath)
+{
+	Stop();
+
+	// 文件不存在或为空时先写文件头
+	if (IFileManager::Get().FileSize(*FilePath) <= 0)
+	{
+		TArray<uint8> Header;
+		FMemoryWriter Writer(Header);
+		uint32 Magic = TraceMagic;
+		uint32 Version = TraceVersion;
+		Writer << Magic << Version;
+		if (!FFileHelper::SaveArrayToFile(Header, *FilePath))
+		{
+			UE_LOG(LogDeepseek, Warning, TEXT("无法创建轨迹文件 %s"), *FilePath);
+			return false;
+		}
+	}
+
+	RecordPath = FilePath;
+	NumRecorded = 0;
+	UE_LOG(LogDeepseek, Display, TEXT("开始录制HTTP交换到 %s"), *RecordPath);
+	return true;
+}
+
+bool FDeepseekHttpTrace::StartReplay(const FString& FilePath, float Speed)
+{
+	Stop();
+
+	TArray<FDeepseekTraceExchange> Exchanges;
+	if (!LoadFile(FilePath, Exchanges) || Exchanges.Num() == 0)
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("轨迹文件 %s 中没有可回放的交换"), *FilePath);
+		return false;
+	}
+
+	FDeepseekMockServerSettings Settings;
+	Settings.Trace = MakeShared<const TArray<FDeepseekTraceExchange>, ESPMode::ThreadSafe>(MoveTemp(Exchanges));
+	Settings.ReplaySpeed = Speed;
+
+	TUniquePtr<FDeepseekMockServer> Server = MakeUnique<FDeepseekMockServer>(Settings);
+	if (!Server->Start())
+	{
+		return false;
+	}
+	ReplayServer = MoveTemp(Server);
+
+	UE_LOG(LogDeepseek, Display, TEXT("开始回放 %s：%d 次交换，速度 %.1fx，地址 %s"),
+		*FilePath, Settings.Trace->Num(), Speed, *ReplayServer->GetUrl());
+	return true;
+}
+
+void FDeepseekHttpTrace::Stop()
+{
+	if (IsRecording())
+	{
+		UE_LOG(LogDeepseek, Display, TEXT("停止录制，共 %d 次交换：%s"), NumRecorded, *RecordPath);
+		RecordPath.Reset();
+	}
+
+	if (IsReplaying())
+	{
+		UE_LOG(LogDeepseek, Display, TEXT("停止回放，共处理 %d 次请求"), ReplayServer->GetStats().Requests.Load());
+		ReplayServer.Reset();
+	}
+}
+
+FString FDeepseekHttpTrace::GetReplayUrl() const
+{
+	return ReplayServer.IsValid() ? ReplayServer->GetUrl() : FString();
+}
+
+void FDeepseekHttpTrace::AddExchange(const FDeepseekTraceExchange& Exchange)
+{
+	check(IsInGameThread());
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	// 写入时不会修改交换
+	SerializeExchange(Writer, const_cast<FDeepseekTraceExchange&>(Exchange));
+
+	TUniquePtr<FArchive> FileWriter(IFileManager::Get().CreateFileWriter(*RecordPath, FILEWRITE_Append | FILEWRITE_AllowRead));
+	if (!FileWriter.IsValid())
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("无法写入轨迹文件 %s，停止录制"), *RecordPath);
+		RecordPath.Reset();
+		return;
+	}
+
+	FileWriter->Serialize(Bytes.GetData(), Bytes.Num());
+	FileWriter->Close();
+	++NumRecorded;
+}
+
+bool FDeepseekHttpTrace::LoadFile(const FString& FilePath, TArray<FDeepseekTraceExchange>& OutExchanges)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FilePath))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic << Version;
+	if (Reader.IsError() || Magic != TraceMagic || Version != TraceVersion)
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("%s 不是轨迹文件"), *FilePath);
+		return false;
+	}
+
+	// 录制中途退出时最后一次交换可能不完整，忽略即可
+	while (!Reader.AtEnd())
+	{
+		FDeepseekTraceExchange Exchange;
+		SerializeExchange(Reader, Exchange);
+		if (Reader.IsError())
+		{
+			break;
+		}
+		OutExchanges.Add(MoveTemp(Exchange));
+	}
+	return true;
+}
+
+FString FDeepseekHttpTrace::GetDefaultTracePath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Deepseek") / FString::Printf(TEXT("Trace-%s.dstrace"), *FDateTime::Now().ToString());
+}
+
+static void RunTraceCommand(const TArray<FString>& Args)
+{
+	FDeepseekHttpTrace* Trace = FDeepseekHttpTrace::Get();
+	if (Trace == nullptr || Args.Num() == 0)
+	{
+		return;
+	}
+
+	if (Args[0].Equals(TEXT("Record"), ESearchCase::IgnoreCase))
+	{
+		Trace->StartRecording(Args.Num() > 1 ? Args[1] : FDeepseekHttpTrace::GetDefaultTracePath());
+	}
+	else if (Args[0].Equals(TEXT("Replay"), ESearchCase::IgnoreCase) && Args.Num() > 1)
+	{
+		float Speed = 1.0f;
+		if (Args.Num() > 2)
+		{
+			FParse::Value(*Args[2], TEXT("Speed="), Speed);
+		}
+		Trace->StartReplay(Args[1], Speed);
+	}
+	else if (Args[0].Equals(TEXT("Stop"), ESearchCase::IgnoreCase))
+	{
+		Trace->Stop();
+	}
+}
+
+static FAutoConsoleCommand TraceCommand(
+	TEXT("Deepseek.Trace"),
+	TEXT("录制或回放HTTP交换。用法: Deepseek.Trace Record [文件] | Deepseek.Trace Replay <文件> [Speed=1] | Deepseek.Trace Stop"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunTraceCommand));
@@ -0,0 +1,185 @@
+#include "DeepseekLoadBenchmark.h"
+#include "Deepseek.h"
+#include "DeepseekRequestScheduler.h"
+#include "HAL/PlatformTime.h"
+
+FDeepseekLoadBenchmark::FDeepseekLoadBenchmark(int32 InConcurrency, int32 InTotalRequests, bool bInStream)
+	: Concurrency(InConcurrency)
+	, TotalRequests(InTotalRequests)
+	, bStream(bInStream)
+	, PreviousMaxConcurrent(0)
+	, EffectiveConcurrency(InConcurrency)
+	, NumSent(0)
+	, NumCompleted(0)
+	, NumFailed(0)
+	, NumRetries(0)
+	, CompletionTokens(0)
+	, StartTime(0.0)
+	, StartGameThreadSeconds(0.0)
+{
+}
+
+FDeepseekLoadBenchmark::~FDeepseekLoadBenchmark()
+{
+	RestoreMaxConcurrent();
+}
+
+bool FDeepseekLoadBenchmark::Start(const FDeepseekMockServerSettings& ServerSettings)
+{
+	Server = MakeUnique<FDeepseekMockServer>(ServerSettings);
+	if (!Server->Start())
+	{
+		return false;
+	}
+
+	// 调度器的并发上限低于压测的并发数时，报告的吞吐与延迟对应的并不是要求的并发，压测期间临时提高
+	FDeepseekRequestScheduler* Scheduler = FDeepseekRequestScheduler::Get();
+	if (Scheduler != nullptr)
+	{
+		if (Scheduler->GetMaxConcurrent() < Concurrency)
+		{
+			PreviousMaxConcurrent = Scheduler->GetMaxConcurrent();
+			Scheduler->SetMaxConcurrent(Concurrency);
+		}
+		EffectiveConcurrency = FMath::Min(Concurrency, Scheduler->GetMaxConcurrent());
+	}
+
+	for (int32 Worker = 0; Worker < Concurrency; ++Worker)
+	{
+		TUniquePtr<FDeepseekOpenAIService> Service = MakeUnique<FDeepseekOpenAIService>();
+		Service->Initialize(TEXT("mock-key"), TEXT("deepseek-mock"), Server->GetUrl());
+		Services.Add(MoveTemp(Service));
+	}
+
+	Latencies.Reserve(TotalRequests);
+	FirstDeltaLatencies.Reserve(TotalRequests);
+	StartTime = FPlatformTime::Seconds();
+	StartGameThreadSeconds = FDeepseekOpenAIService::GetGameThreadSeconds();
+
+	for (int32 Worker = 0; Worker < Concurrency; ++Worker)
+	{
+		SendNext(Worker);
+	}
+	return true;
+}
+
+void FDeepseekLoadBenchmark::SendNext(int32 Worker)
+{
+	if (NumSent >= TotalRequests)
+	{
+		return;
+	}
+	const int32 Index = NumSent++;
+
+	TArray<FOpenAIMessage> Messages;
+	Messages.Emplace(TEXT("system"), TEXT("你是一个有用的AI助手。"));
+	Messages.Emplace(TEXT("user"), FString::Printf(TEXT("压测请求 #%d：解释UE5中Actor的生命周期。"), Index));
+
+	FDeepseekRequestOptions Options;
+	Options.bIsolated = true;
+
+	const double SendTime = FPlatformTime::Seconds();
+	TSharedRef<double> FirstDeltaTime = MakeShared<double>(0.0);
+	TWeakPtr<FDeepseekLoadBenchmark> WeakThis = AsShared();
+	FOnDeepseekChatCompleted OnCompleted = [WeakThis, Worker, SendTime, FirstDeltaTime](const FDeepseekChatReplyRef& Reply)
+	{
+		if (TSharedPtr<FDeepseekLoadBenchmark> This = WeakThis.Pin())
+		{
+			This->OnRequestCompleted(Worker, SendTime, *FirstDeltaTime, Reply);
+		}
+	};
+
+	FDeepseekOpenAIService& Service = *Services[Worker];
+	if (bStream)
+	{
+		Service.SendChatStreamRequest(Messages, [FirstDeltaTime](const FString& Delta)
+		{
+			if (*FirstDeltaTime == 0.0)
+			{
+				*FirstDeltaTime = FPlatformTime::Seconds();
+			}
+		}, MoveTemp(OnCompleted), Options);
+	}
+	else
+	{
+		Service.SendChatRequest(Messages, MoveTemp(OnCompleted), Options);
+	}
+}
+
+void FDeepseekLoadBenchmark::OnRequestCompleted(int32 Worker, double SendTime, double FirstDeltaTime, const FDeepseekChatReplyRef& Reply)
+{
+	const double Now = FPlatformTime::Seconds();
+	++NumCompleted;
+	NumRetries += Reply->Timings.Retries;
+	if (Reply->bSuccess)
+	{
+		Latencies.Add(Now - SendTime);
+		if (FirstDeltaTime > 0.0)
+		{
+			FirstDeltaLatencies.Add(FirstDeltaTime - SendTime);
+		}
+		CompletionTokens += Reply->Usage.CompletionTokens;
+	}
+	else
+	{
+		++NumFailed;
+	}
+
+	if (NumCompleted < TotalRequests)
+	{
+		SendNext(Worker);
+		return;
+	}
+
+	RestoreMaxConcurrent();
+	Report(Now);
+
+	if (OnFinished)
+	{
+		OnFinished();
+	}
+}
+
+void FDeepseekLoadBenchmark::Report(double EndTime)
+{
+	const double ElapsedSeconds = FMath::Max(EndTime - StartTime, 0.001);
+	const double GameThreadSeconds = FDeepseekOpenAIService::GetGameThreadSeconds() - StartGameThreadSeconds;
+
+	auto Percentile = [](TArray<double>& Values, double Fraction)
+	{
+		if (Values.Num() == 0)
+		{
+			return 0.0;
+		}
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Values.Num() * Fraction) - 1, 0, Values.Num() - 1);
+		return Values[Index] * 1000.0;
+	};
+	Latencies.Sort();
+	FirstDeltaLatencies.Sort();
+
+	const FDeepseekMockServer::FStats& ServerStats = Server->GetStats();
+	UE_LOG(LogDeepseek, Display, TEXT("LoadBench: %s, 并发 %d, %d 个请求, 耗时 %.2f 秒"),
+		bStream ? TEXT("流式") : TEXT("非流式"), EffectiveConcurrency, TotalRequests, ElapsedSeconds);
+	UE_LOG(LogDeepseek, Display, TEXT("  吞吐: %.1f 请求/秒, %.0f token/秒"), NumCompleted / ElapsedSeconds, CompletionTokens / ElapsedSeconds);
+	UE_LOG(LogDeepseek, Display, TEXT("  延迟: p50 %.0f ms / p95 %.0f ms / p99 %.0f ms"),
+		Percentile(Latencies, 0.50), Percentile(Latencies, 0.95), Percentile(Latencies, 0.99));
+	if (bStream)
+	{
+		UE_LOG(LogDeepseek, Display, TEXT("  首段内容: p50 %.0f ms / p95 %.0f ms / p99 %.0f ms"),
+			Percentile(FirstDeltaLatencies, 0.50), Percentile(FirstDeltaLatencies, 0.95), Percentile(FirstDeltaLatencies, 0.99));
+	}
+	UE_LOG(LogDeepseek, Display, TEXT("  游戏线程: 共 %.1f ms, 每个请求 %.3f ms"), GameThreadSeconds * 1000.0, GameThreadSeconds * 1000.0 / TotalRequests);
+	UE_LOG(LogDeepseek, Display, TEXT("  失败 %d, 重试 %d; 模拟服务: %d 个连接, %d 次请求, 注入500 %d 次, 注入429 %d 次"),
+		NumFailed, NumRetries, ServerStats.Connections.Load(), ServerStats.Requests.Load(),
+		ServerStats.InjectedErrors.Load(), ServerStats.InjectedRateLimits.Load());
+}
+
+void FDeepseekLoadBenchmark::RestoreMaxConcurrent()
+{
+	FDeepseekRequestScheduler* Scheduler = FDeepseekRequestScheduler::Get();
+	if (Scheduler != nullptr && PreviousMaxConcurrent > 0)
+	{
+		Scheduler->SetMaxConcurrent(PreviousMaxConcurrent);
+	}
+	PreviousMaxConcurrent = 0;
+}
@@ -0,0 +1,70 @@
+#include "DeepseekMessageStore.h"
+
+FDeepseekMessageText::FDeepseekMessageText(FStringView Text)
+	: Offset(0)
+	, Length(Text.Len())
+{
+	if (Length > 0)
+	{
+		TSharedRef<FDeepseekTextChunk, ESPMode::ThreadSafe> NewChunk = MakeShared<FDeepseekTextChunk, ESPMode::ThreadSafe>();
+		NewChunk->Chars.Reserve(Length + 1);
+		NewChunk->Chars.Append(Text.GetData(), Length);
+		NewChunk->Chars.Add(TEXT('\0'));
+		Chunk = NewChunk;
+	}
+}
+
+bool FDeepseekMessageText::Equals(const FDeepseekMessageText& Other) const
+{
+	if (Chunk == Other.Chunk && Offset == Other.Offset)
+	{
+		return Length == Other.Length;
+	}
+	return View().Equals(Other.View(), ESearchCase::CaseSensitive);
+}
+
+FDeepseekMessageStore::FDeepseekMessageStore()
+	: NumChars(0)
+	, NumChunks(0)
+{
+}
+
+FDeepseekMessageText FDeepseekMessageStore::Add(FStringView Text)
+{
+	if (Text.Len() == 0)
+	{
+		return FDeepseekMessageText();
+	}
+
+	NumChars += Text.Len();
+
+	// 较长的文本单独成块，不浪费当前块剩余的空间
+	const int32 NeededChars = Text.Len() + 1;
+	if (NeededChars > ChunkChars / 4)
+	{
+		++NumChunks;
+		return FDeepseekMessageText(Text);
+	}
+
+	// 块的容量固定，追加不会移动已写入的文本，其他引用可以继续读取
+	if (!CurrentChunk.IsValid() || CurrentChunk->Chars.Num() + NeededChars > CurrentChunk->Chars.Max())
+	{
+		CurrentChunk = MakeShared<FDeepseekTextChunk, ESPMode::ThreadSafe>();
+		CurrentChunk->Chars.Reserve(ChunkChars);
+		++NumChunks;
+	}
+
+	FDeepseekMessageText Result;
+	Result.Chunk = CurrentChunk;
+	Result.Offset = CurrentChunk->Chars.Num();
+	Result.Length = Text.Len();
+
+	CurrentChunk->Chars.Append(Text.GetData(), Text.Len());
+	CurrentChunk->Chars.Add(TEXT('\0'));
+	return Result;
+}
+
+void FDeepseekMessageStore::Reset()
+{
+	CurrentChunk.Reset();
+}
@@ -0,0 +1,634 @@
+#include "DeepseekMockServer.h"
+#include "Deepseek.h"
+#include "Async/Async.h"
+#include "Common/TcpSocketBuilder.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CoreDelegates.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+/** 生成回复内容所用的文本，循环使用 */
+static const TCHAR* MockReplyText = TEXT("虚幻引擎中的Actor在BeginPlay之后每帧调用Tick，销毁前调用EndPlay；UPROPERTY标记的成员由GC追踪。");
+
+/** 空闲连接保持的时间（秒） */
+static const double MockIdleTimeoutSeconds = 60.0;
+
+void FDeepseekMockServerSettings::ParseFrom(const TCHAR* Args)
+{
+	FParse::Value(Args, TEXT("Port="), Port);
+	FParse::Value(Args, TEXT("TTFT="), FirstTokenSeconds);
+	FParse::Value(Args, TEXT("TPS="), TokensPerSecond);
+	FParse::Value(Args, TEXT("Tokens="), CompletionTokens);
+	FParse::Value(Args, TEXT("Chars="), CharsPerToken);
+	FParse::Value(Args, TEXT("Chunk="), TokensPerChunk);
+	FParse::Value(Args, TEXT("Error="), ErrorRate);
+	FParse::Value(Args, TEXT("RateLimit="), RateLimitRate);
+	FParse::Value(Args, TEXT("RetryAfter="), RetryAfterSeconds);
+	FParse::Value(Args, TEXT("Speed="), ReplaySpeed);
+
+	FString TracePath;
+	if (FParse::Value(Args, TEXT("Trace="), TracePath))
+	{
+		TArray<FDeepseekTraceExchange> Exchanges;
+		if (FDeepseekHttpTrace::LoadFile(TracePath, Exchanges) && Exchanges.Num() > 0)
+		{
+			Trace = MakeShared<const TArray<FDeepseekTraceExchange>, ESPMode::ThreadSafe>(MoveTemp(Exchanges));
+		}
+		else
+		{
+			UE_LOG(LogDeepseek, Warning, TEXT("无法读取轨迹文件 %s，使用生成的响应"), *TracePath);
+		}
+	}
+
+	CompletionTokens = FMath::Max(1, CompletionTokens);
+	CharsPerToken = FMath::Max(1, CharsPerToken);
+	TokensPerChunk = FMath::Max(1, TokensPerChunk);
+}
+
+FDeepseekMockServer::FDeepseekMockServer(const FDeepseekMockServerSettings& InSettings)
+	: Settings(InSettings)
+	, ListenSocket(nullptr)
+	, Thread(nullptr)
+	, BoundPort(0)
+	, bStopping(false)
+	, NextTraceExchange(0)
+{
+	// 同一请求体录制了多次时使用第一次
+	if (Settings.Trace.IsValid())
+	{
+		for (int32 Index = 0; Index < Settings.Trace->Num(); ++Index)
+		{
+			const TArray<uint8>& RequestBody = (*Settings.Trace)[Index].RequestBody;
+			FSHAHash Hash;
+			FSHA1::HashBuffer(RequestBody.GetData(), RequestBody.Num(), Hash.Hash);
+			if (!TraceIndex.Contains(Hash))
+			{
+				TraceIndex.Add(Hash, Index);
+			}
+		}
+	}
+}
+
+FDeepseekMockServer::~FDeepseekMockServer()
+{
+	Shutdown();
+}
+
+bool FDeepseekMockServer::Start()
+{
+	check(ListenSocket == nullptr);
+
+	ListenSocket = FTcpSocketBuilder(TEXT("DeepseekMockServer"))
+		.AsReusable()
+		.AsBlocking()
+		.BoundToEndpoint(FIPv4Endpoint(FIPv4Address(127, 0, 0, 1), Settings.Port))
+		.Listening(128)
+		.Build();
+	if (ListenSocket == nullptr)
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("模拟服务无法监听端口 %d"), Settings.Port);
+		return false;
+	}
+
+	BoundPort = ListenSocket->GetPortNo();
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("DeepseekMockServer"));
+
+	UE_LOG(LogDeepseek, Log, TEXT("模拟服务已启动：%s"), *GetUrl());
+	return true;
+}
+
+void FDeepseekMockServer::Shutdown()
+{
+	bStopping = true;
+
+	if (Thread != nullptr)
+	{
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	// 连接线程每隔一小段时间检查停止标记，不会等待太久
+	TArray<TFuture<void>> PendingConnections;
+	{
+		FScopeLock Lock(&ConnectionsMutex);
+		PendingConnections = MoveTemp(Connections);
+	}
+	for (TFuture<void>& Connection : PendingConnections)
+	{
+		Connection.Wait();
+	}
+
+	if (ListenSocket != nullptr)
+	{
+		ListenSocket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ListenSocket);
+		ListenSocket = nullptr;
+	}
+}
+
+FString FDeepseekMockServer::GetUrl() const
+{
+	return FString::Printf(TEXT("http://127.0.0.1:%d/chat/completions"), BoundPort);
+}
+
+uint32 FDeepseekMockServer::Run()
+{
+	while (!bStopping)
+	{
+		bool bHasPendingConnection = false;
+		if (!ListenSocket->WaitForPendingConnection(bHasPendingConnection, FTimespan::FromMilliseconds(100)) || !bHasPendingConnection)
+		{
+			continue;
+		}
+
+		FSocket* Socket = ListenSocket->Accept(TEXT("DeepseekMockConnection"));
+		if (Socket == nullptr)
+		{
+			continue;
+		}
+		Socket->SetNonBlocking(false);
+
+		const uint32 Seed = ++Stats.Connections;
+		FScopeLock Lock(&ConnectionsMutex);
+		Connections.RemoveAll([](const TFuture<void>& Connection)
+		{
+			return Connection.IsReady();
+		});
+		Connections.Add(Async(EAsyncExecution::Thread, [this, Socket, Seed]()
+		{
+			HandleConnection(Socket, Seed);
+		}));
+	}
+	return 0;
+}
+
+void FDeepseekMockServer::Stop()
+{
+	bStopping = true;
+}
+
+/** 头部结束的位置，即"\r\n\r\n"的起点 */
+static int32 FindHeaderEnd(const TArray<uint8>& Buffer)
+{
+	for (int32 Index = 0; Index + 3 < Buffer.Num(); ++Index)
+	{
+		if (Buffer[Index] == '\r' && Buffer[Index + 1] == '\n' && Buffer[Index + 2] == '\r' && Buffer[Index + 3] == '\n')
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+bool FDeepseekMockServer::ReadRequest(FSocket* Socket, TArray<uint8>& Buffer, FString& OutRequestLine, TArray<uint8>& OutBody, bool& bOutKeepAlive)
+{
+	const double IdleDeadline = FPlatformTime::Seconds() + MockIdleTimeoutSeconds;
+	auto ReceiveMore = [this, Socket, &Buffer, IdleDeadline]()
+	{
+		while (!bStopping && FPlatformTime::Seconds() < IdleDeadline)
+		{
+			if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(100)))
+			{
+				continue;
+			}
+
+			// 可读但读不到数据说明对方已关闭连接
+			uint8 Data[16 * 1024];
+			int32 BytesRead = 0;
+			if (!Socket->Recv(Data, sizeof(Data), BytesRead) || BytesRead <= 0)
+			{
+				return false;
+			}
+			Buffer.Append(Data, BytesRead);
+			return true;
+		}
+		return false;
+	};
+
+	int32 HeaderEnd = FindHeaderEnd(Buffer);
+	while (HeaderEnd == INDEX_NONE)
+	{
+		if (!ReceiveMore())
+		{
+			return false;
+		}
+		HeaderEnd = FindHeaderEnd(Buffer);
+	}
+
+	const FString Header(FUTF8ToTCHAR(reinterpret_cast<const ANSICHAR*>(Buffer.GetData()), HeaderEnd));
+	TArray<FString> Lines;
+	Header.ParseIntoArrayLines(Lines);
+	if (Lines.Num() == 0)
+	{
+		return false;
+	}
+
+	OutRequestLine = Lines[0];
+	bOutKeepAlive = true;
+	int32 ContentLength = 0;
+	bool bExpectContinue = false;
+	for (int32 Index = 1; Index < Lines.Num(); ++Index)
+	{
+		FString Name;
+		FString Value;
+		if (!Lines[Index].Split(TEXT(":"), &Name, &Value))
+		{
+			continue;
+		}
+		Name.TrimStartAndEndInline();
+		Value.TrimStartAndEndInline();
+
+		if (Name.Equals(TEXT("Content-Length"), ESearchCase::IgnoreCase))
+		{
+			ContentLength = FMath::Max(0, FCString::Atoi(*Value));
+		}
+		else if (Name.Equals(TEXT("Connection"), ESearchCase::IgnoreCase))
+		{
+			bOutKeepAlive = !Value.Equals(TEXT("close"), ESearchCase::IgnoreCase);
+		}
+		else if (Name.Equals(TEXT("Expect"), ESearchCase::IgnoreCase))
+		{
+			bExpectContinue = Value.Equals(TEXT("100-continue"), ESearchCase::IgnoreCase);
+		}
+	}
+
+	if (bExpectContinue && !SendAll(Socket, TEXT("HTTP/1.1 100 Continue\r\n\r\n")))
+	{
+		return false;
+	}
+
+	const int32 BodyStart = HeaderEnd + 4;
+	while (Buffer.Num() < BodyStart + ContentLength)
+	{
+		if (!ReceiveMore())
+		{
+			return false;
+		}
+	}
+
+	OutBody = TArray<uint8>(Buffer.GetData() + BodyStart, ContentLength);
+	Buffer.RemoveAt(0, BodyStart + ContentLength, false);
+	return true;
+}
+
+bool FDeepseekMockServer::SendAll(FSocket* Socket, const FString& Data)
+{
+	FTCHARToUTF8 Converted(*Data);
+	return SendBytes(Socket, reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+}
+
+bool FDeepseekMockServer::SendBytes(FSocket* Socket, const uint8* Data, int32 Num)
+{
+	while (Num > 0)
+	{
+		int32 BytesSent = 0;
+		if (bStopping || !Socket->Send(Data, Num, BytesSent))
+		{
+			return false;
+		}
+		Data += BytesSent;
+		Num -= BytesSent;
+	}
+	return true;
+}
+
+bool FDeepseekMockServer::SendChunk(FSocket* Socket, const FString& Data)
+{
+	FTCHARToUTF8 Converted(*Data);
+	return SendChunk(Socket, reinterpret_cast<const uint8*>(Converted.Get()), Converted.Length());
+}
+
+bool FDeepseekMockServer::SendChunk(FSocket* Socket, const uint8* Data, int32 Num)
+{
+	// 长度行、数据与结尾一次发出，避免小包被延迟
+	FTCHARToUTF8 SizeLine(*FString::Printf(TEXT("%x\r\n"), Num));
+	TArray<uint8> Chunk;
+	Chunk.Reserve(SizeLine.Length() + Num + 2);
+	Chunk.Append(reinterpret_cast<const uint8*>(SizeLine.Get()), SizeLine.Length());
+	Chunk.Append(Data, Num);
+	Chunk.Add('\r');
+	Chunk.Add('\n');
+	return SendBytes(Socket, Chunk.GetData(), Chunk.Num());
+}
+
+bool FDeepseekMockServer::WaitUntil(double Time) const
+{
+	for (double Now = FPlatformTime::Seconds(); Now < Time; Now = FPlatformTime::Seconds())
+	{
+		if (bStopping)
+		{
+			return false;
+		}
+		FPlatformProcess::Sleep(static_cast<float>(FMath::Min(Time - Now, 0.01)));
+	}
+	return !bStopping;
+}
+
+FString FDeepseekMockServer::MakeTokenText(int32 Index) const
+{
+	const int32 TextLength = FCString::Strlen(MockReplyText);
+	FString Text;
+	Text.Reserve(Settings.CharsPerToken);
+	for (int32 Char = 0; Char < Settings.CharsPerToken; ++Char)
+	{
+		Text.AppendChar(MockReplyText[(Index * Settings.CharsPerToken + Char) % TextLength]);
+	}
+	return Text;
+}
+
+/** 完整的响应：状态行、头部与正文 */
+static FString MakeResponse(int32 Code, const TCHAR* Reason, const TCHAR* ContentType, const FString& ExtraHeaders, const FString& Body, bool bKeepAlive)
+{
+	return FString::Printf(TEXT("HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n%s%s\r\n%s"),
+		Code, Reason, ContentType, FTCHARToUTF8(*Body).Length(), *ExtraHeaders,
+		bKeepAlive ? TEXT("") : TEXT("Connection: close\r\n"), *Body);
+}
+
+/** usage字段，模拟服务不命中前缀缓存 */
+static FString MakeUsageJson(int32 PromptTokens, int32 CompletionTokens)
+{
+	return FString::Printf(TEXT("{\"prompt_tokens\":%d,\"completion_tokens\":%d,\"total_tokens\":%d,\"prompt_cache_hit_tokens\":0,\"prompt_cache_miss_tokens\":%d}"),
+		PromptTokens, CompletionTokens, PromptTokens + CompletionTokens, PromptTokens);
+}
+
+void FDeepseekMockServer::HandleConnection(FSocket* Socket, uint32 Seed)
+{
+	FRandomStream Random(static_cast<int32>(Seed * 2654435761u));
+	TArray<uint8> Buffer;
+
+	while (!bStopping)
+	{
+		FString RequestLine;
+		TArray<uint8> Body;
+		bool bKeepAlive = true;
+		if (!ReadRequest(Socket, Buffer, RequestLine, Body, bKeepAlive))
+		{
+			break;
+		}
+		const double ReceivedTime = FPlatformTime::Seconds();
+		++Stats.Requests;
+
+		TArray<FString> RequestParts;
+		RequestLine.ParseIntoArrayWS(RequestParts);
+		const FString Method = RequestParts.Num() > 0 ? RequestParts[0] : FString();
+		const FString Path = RequestParts.Num() > 1 ? RequestParts[1] : FString();
+
+		// 预热连接用的HEAD请求
+		if (Method == TEXT("HEAD"))
+		{
+			if (!SendAll(Socket, FString::Printf(TEXT("HTTP/1.1 200 OK\r\nContent-Length: 0\r\n%s\r\n"), bKeepAlive ? TEXT("") : TEXT("Connection: close\r\n"))))
+			{
+				break;
+			}
+			continue;
+		}
+
+		if (Method != TEXT("POST") || !Path.EndsWith(TEXT("/chat/completions")))
+		{
+			SendAll(Socket, MakeResponse(404, TEXT("Not Found"), TEXT("application/json"), FString(), TEXT("{\"error\":{\"message\":\"Not found\"}}"), false));
+			break;
+		}
+
+		if (Settings.Trace.IsValid())
+		{
+			if (!ReplayExchange(Socket, Body, ReceivedTime, bKeepAlive) || !bKeepAlive)
+			{
+				break;
+			}
+			continue;
+		}
+
+		const FString BodyString(FUTF8ToTCHAR(reinterpret_cast<const ANSICHAR*>(Body.GetData()), Body.Num()));
+		bool bStream = false;
+		FString Model = TEXT("deepseek-mock");
+		TSharedPtr<FJsonObject> JsonObject;
+		if (FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BodyString), JsonObject) && JsonObject.IsValid())
+		{
+			JsonObject->TryGetBoolField(TEXT("stream"), bStream);
+			JsonObject->TryGetStringField(TEXT("model"), Model);
+		}
+
+		// 按请求体长度粗略估算提示token数
+		const int32 PromptTokens = FMath::Max(1, BodyString.Len() / 4);
+		const int32 CompletionTokens = Settings.CompletionTokens;
+
+		const float Roll = Random.FRand();
+		if (Roll < Settings.RateLimitRate)
+		{
+			++Stats.InjectedRateLimits;
+			if (!SendAll(Socket, MakeResponse(429, TEXT("Too Many Requests"), TEXT("application/json"),
+				FString::Printf(TEXT("Retry-After: %d\r\n"), Settings.RetryAfterSeconds),
+				TEXT("{\"error\":{\"message\":\"Rate limit reached (mock)\",\"type\":\"rate_limit_error\"}}"), bKeepAlive)) || !bKeepAlive)
+			{
+				break;
+			}
+			continue;
+		}
+		if (Roll < Settings.RateLimitRate + Settings.ErrorRate)
+		{
+			++Stats.InjectedErrors;
+			if (!SendAll(Socket, MakeResponse(500, TEXT("Internal Server Error"), TEXT("application/json"), FString(),
+				TEXT("{\"error\":{\"message\":\"Internal error (mock)\",\"type\":\"server_error\"}}"), bKeepAlive)) || !bKeepAlive)
+			{
+				break;
+			}
+			continue;
+		}
+
+		const double FirstTokenTime = ReceivedTime + Settings.FirstTokenSeconds;
+		auto GetTokenTime = [this, FirstTokenTime](int32 Token)
+		{
+			return Settings.TokensPerSecond > 0.0f ? FirstTokenTime + Token / Settings.TokensPerSecond : FirstTokenTime;
+		};
+
+		if (!bStream)
+		{
+			// 非流式请求在全部生成后一次返回
+			if (!WaitUntil(GetTokenTime(CompletionTokens)))
+			{
+				break;
+			}
+
+			FString Content;
+			Content.Reserve(CompletionTokens * Settings.CharsPerToken);
+			for (int32 Token = 0; Token < CompletionTokens; ++Token)
+			{
+				Content += MakeTokenText(Token);
+			}
+
+			const FString ResponseBody = FString::Printf(
+				TEXT("{\"id\":\"mock-%u\",\"object\":\"chat.completion\",\"created\":0,\"model\":\"%s\",")
+				TEXT("\"choices\":[{\"index\":0,\"message\":{\"role\":\"assistant\",\"content\":\"%s\"},\"finish_reason\":\"stop\"}],\"usage\":%s}"),
+				Seed, *Model, *Content, *MakeUsageJson(PromptTokens, CompletionTokens));
+			if (!SendAll(Socket, MakeResponse(200, TEXT("OK"), TEXT("application/json"), FString(), ResponseBody, bKeepAlive)) || !bKeepAlive)
+			{
+				break;
+			}
+			continue;
+		}
+
+		++Stats.StreamRequests;
+
+		// 流式响应使用chunked编码，连接可以继续复用
+		bool bSent = SendAll(Socket, FString::Printf(TEXT("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nTransfer-Encoding: chunked\r\n%s\r\n"),
+			bKeepAlive ? TEXT("") : TEXT("Connection: close\r\n")));
+		for (int32 Token = 0; bSent && Token < CompletionTokens; Token += Settings.TokensPerChunk)
+		{
+			if (!WaitUntil(GetTokenTime(Token)))
+			{
+				bSent = false;
+				break;
+			}
+
+			FString Content;
+			for (int32 ChunkToken = Token; ChunkToken < FMath::Min(Token + Settings.TokensPerChunk, CompletionTokens); ++ChunkToken)
+			{
+				Content += MakeTokenText(ChunkToken);
+			}
+			bSent = SendChunk(Socket, FString::Printf(
+				TEXT("data: {\"id\":\"mock-%u\",\"object\":\"chat.completion.chunk\",\"created\":0,\"model\":\"%s\",")
+				TEXT("\"choices\":[{\"index\":0,\"delta\":{\"content\":\"%s\"},\"finish_reason\":null}]}\n\n"),
+				Seed, *Model, *Content));
+		}
+
+		bSent = bSent
+			&& SendChunk(Socket, FString::Printf(
+				TEXT("data: {\"id\":\"mock-%u\",\"object\":\"chat.completion.chunk\",\"created\":0,\"model\":\"%s\",")
+				TEXT("\"choices\":[{\"index\":0,\"delta\":{\"content\":\"\"},\"finish_reason\":\"stop\"}],\"usage\":%s}\n\n"),
+				Seed, *Model, *MakeUsageJson(PromptTokens, CompletionTokens)))
+			&& SendChunk(Socket, TEXT("data: [DONE]\n\n"))
+			&& SendAll(Socket, TEXT("0\r\n\r\n"));
+		if (!bSent || !bKeepAlive)
+		{
+			break;
+		}
+	}
+
+	Socket->Close();
+	ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+}
+
+/** 回放响应的状态行短语 */
+static const TCHAR* GetReasonPhrase(int32 Code)
+{
+	switch (Code)
+	{
+	case 200:	return TEXT("OK");
+	case 400:	return TEXT("Bad Request");
+	case 401:	return TEXT("Unauthorized");
+	case 429:	return TEXT("Too Many Requests");
+	case 500:	return TEXT("Internal Server Error");
+	case 503:	return TEXT("Service Unavailable");
+	default:	return TEXT("Status");
+	}
+}
+
+bool FDeepseekMockServer::ReplayExchange(FSocket* Socket, const TArray<uint8>& RequestBody, double ReceivedTime, bool bKeepAlive)
+{
+	const TArray<FDeepseekTraceExchange>& Exchanges = *Settings.Trace;
+
+	FSHAHash Hash;
+	FSHA1::HashBuffer(RequestBody.GetData(), RequestBody.Num(), Hash.Hash);
+	const int32* Found = TraceIndex.Find(Hash);
+	const int32 Index = Found != nullptr ? *Found : (NextTraceExchange++ % Exchanges.Num());
+	const FDeepseekTraceExchange& Exchange = Exchanges[Index];
+
+	auto GetChunkTime = [this, ReceivedTime](const FDeepseekTraceChunk& Chunk)
+	{
+		return Settings.ReplaySpeed > 0.0f ? ReceivedTime + Chunk.OffsetMs / (1000.0 * Settings.ReplaySpeed) : ReceivedTime;
+	};
+
+	const FString ContentType = Exchange.ContentType.IsEmpty() ? FString(TEXT("application/json")) : Exchange.ContentType;
+	const TCHAR* ConnectionHeader = bKeepAlive ? TEXT("") : TEXT("Connection: close\r\n");
+
+	// 成功的流式响应按记录的分段与时间送出
+	if (Exchange.bStream && Exchange.ResponseCode == 200)
+	{
+		++Stats.StreamRequests;
+		if (!SendAll(Socket, FString::Printf(TEXT("HTTP/1.1 200 OK\r\nContent-Type: %s\r\nCache-Control: no-cache\r\nTransfer-Encoding: chunked\r\n%s\r\n"),
+			*ContentType, ConnectionHeader)))
+		{
+			return false;
+		}
+
+		for (const FDeepseekTraceChunk& Chunk : Exchange.Chunks)
+		{
+			if (!WaitUntil(GetChunkTime(Chunk)) || !SendChunk(Socket, Chunk.Bytes.GetData(), Chunk.Bytes.Num()))
+			{
+				return false;
+			}
+		}
+		return SendAll(Socket, TEXT("0\r\n\r\n"));
+	}
+
+	// 其余响应在最后一段到达的时间整体送出
+	TArray<uint8> Body;
+	for (const FDeepseekTraceChunk& Chunk : Exchange.Chunks)
+	{
+		Body.Append(Chunk.Bytes);
+	}
+	if (Exchange.Chunks.Num() > 0 && !WaitUntil(GetChunkTime(Exchange.Chunks.Last())))
+	{
+		return false;
+	}
+
+	const FString RetryAfterHeader = Exchange.RetryAfter.IsEmpty() ? FString() : FString::Printf(TEXT("Retry-After: %s\r\n"), *Exchange.RetryAfter);
+	return SendAll(Socket, FString::Printf(TEXT("HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n%s%s\r\n"),
+			Exchange.ResponseCode, GetReasonPhrase(Exchange.ResponseCode), *ContentType, Body.Num(), *RetryAfterHeader, ConnectionHeader))
+		&& SendBytes(Socket, Body.GetData(), Body.Num());
+}
+
+/** 控制台启动的模拟服务 */
+static TUniquePtr<FDeepseekMockServer> ConsoleMockServer;
+
+static void RunMockServerCommand(const TArray<FString>& Args)
+{
+	const FString Joined = FString::Join(Args, TEXT(" "));
+	if (ConsoleMockServer.IsValid())
+	{
+		ConsoleMockServer.Reset();
+		UE_LOG(LogDeepseek, Display, TEXT("模拟服务已停止"));
+	}
+
+	if (Args.Num() > 0 && Args[0].Equals(TEXT("Stop"), ESearchCase::IgnoreCase))
+	{
+		return;
+	}
+
+	FDeepseekMockServerSettings Settings;
+	Settings.Port = 18080;
+	Settings.ParseFrom(*Joined);
+
+	TUniquePtr<FDeepseekMockServer> Server = MakeUnique<FDeepseekMockServer>(Settings);
+	if (!Server->Start())
+	{
+		return;
+	}
+	ConsoleMockServer = MoveTemp(Server);
+
+	// 套接字子系统在退出时关闭，需要先停掉服务
+	static bool bRegisteredPreExit = false;
+	if (!bRegisteredPreExit)
+	{
+		bRegisteredPreExit = true;
+		FCoreDelegates::OnPreExit.AddLambda([]()
+		{
+			ConsoleMockServer.Reset();
+		});
+	}
+
+	UE_LOG(LogDeepseek, Display, TEXT("模拟服务：%s（首token %.2f 秒，%.0f token/s，每次 %d tokens，错误 %.0f%%，429 %.0f%%）"),
+		*ConsoleMockServer->GetUrl(), Settings.FirstTokenSeconds, Settings.TokensPerSecond, Settings.CompletionTokens,
+		Settings.ErrorRate * 100.0f, Settings.RateLimitRate * 100.0f);
+}
+
+static FAutoConsoleCommand MockServerCommand(
+	TEXT("Deepseek.MockServer"),
+	TEXT("启动或停止本地模拟服务。用法: Deepseek.MockServer [Stop] [Port=18080] [TTFT=0.3] [TPS=50] [Tokens=200] [Chars=2] [Chunk=1] [Error=0] [RateLimit=0] [RetryAfter=1] [Trace=文件] [Speed=1]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunMockServerCommand));
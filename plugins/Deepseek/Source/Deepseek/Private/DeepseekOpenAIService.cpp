@@ -1,157 +1,1702 @@
 #include "DeepseekOpenAIService.h"
 #include "HttpModule.h"
+#include "PlatformHttp.h"
 #include "Interfaces/IHttpResponse.h"
+#include "DeepseekSSEParser.h"
+#include "DeepseekResponseDecoder.h"
+#include "Async/Async.h"
+#include "DeepseekTokenizer.h"
+#include "DeepseekResponseCache.h"
+#include "Deepseek.h"
+#include "DeepseekHedgePolicy.h"
+#include "DeepseekProviderPool.h"
+#include "DeepseekRequestStats.h"
+#include "DeepseekUsageLedger.h"
+#include "DeepseekHttpTrace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Containers/Ticker.h"
+
+/** 请求使用的采样温度 */
+static const double ChatTemperature = 0.7;
+
+/** 服务在游戏线程累计花费的时间，包括其中调用的回调 */
+static double GameThreadSeconds = 0.0;
+static int32 GameThreadScopeDepth = 0;
+
+/** 统计一段游戏线程代码的耗时，嵌套时只计最外层 */
+struct FDeepseekGameThreadScope
+{
+    double StartTime;
+
+    FDeepseekGameThreadScope()
+        : StartTime(++GameThreadScopeDepth == 1 ? FPlatformTime::Seconds() : 0.0)
+    {
+    }
+
+    ~FDeepseekGameThreadScope()
+    {
+        if (--GameThreadScopeDepth == 0)
+        {
+            GameThreadSeconds += FPlatformTime::Seconds() - StartTime;
+        }
+    }
+};
+
+double FDeepseekOpenAIService::GetGameThreadSeconds()
+{
+    return GameThreadSeconds;
+}
 
 FDeepseekOpenAIService::FDeepseekOpenAIService()
-    : HttpModule(nullptr)
+    : MaxContextTokens(64000)
+    , MaxTokens(1000)
+    , WindowStart(0)
+    , PrefixBreaks(0)
+    , SessionId(FDeepseekRequestScheduler::AllocateSessionId())
+    , TotalTimeoutSeconds(120.0f)
+    , FirstByteTimeoutSeconds(30.0f)
+    , MaxRetries(3)
+    , bKeepAlive(true)
+{
+}
+
+FDeepseekOpenAIService::~FDeepseekOpenAIService()
+{
+    // 服务的使用者已经不在，未结束的请求不再需要
+    CancelAll();
+}
+
+void FDeepseekOpenAIService::Initialize(const FString& InApiKey, const FString& InModel, const FString& InApiUrl)
+{
+    ApiKey = InApiKey;
+    Model = InModel;
+    ApiUrl = InApiUrl;
+}
+
+void FDeepseekOpenAIService::SetContextBudget(int32 InMaxContextTokens, int32 InMaxTokens)
+{
+    MaxTokens = FMath::Max(1, InMaxTokens);
+    MaxContextTokens = FMath::Max(MaxTokens + 1, InMaxContextTokens);
+}
+
+void FDeepseekOpenAIService::SetTimeouts(float InTotalTimeoutSeconds, float InFirstByteTimeoutSeconds)
+{
+    TotalTimeoutSeconds = FMath::Max(0.0f, InTotalTimeoutSeconds);
+    FirstByteTimeoutSeconds = FMath::Max(0.0f, InFirstByteTimeoutSeconds);
+}
+
+void FDeepseekOpenAIService::SetMaxRetries(int32 InMaxRetries)
+{
+    MaxRetries = FMath::Max(0, InMaxRetries);
+}
+
+void FDeepseekOpenAIService::SetKeepAlive(bool bInKeepAlive)
+{
+    bKeepAlive = bInKeepAlive;
+}
+
+void FDeepseekOpenAIService::PrewarmConnection(const FString& InApiUrl)
+{
+    check(IsInGameThread());
+
+    // 连接按协议、主机与端口复用，只请求站点根路径
+    const int32 SchemeEnd = InApiUrl.Find(TEXT("://"));
+    if (SchemeEnd == INDEX_NONE)
+    {
+        return;
+    }
+
+    const int32 PathStart = InApiUrl.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, SchemeEnd + 3);
+    const FString Origin = PathStart == INDEX_NONE ? InApiUrl : InApiUrl.Left(PathStart);
+
+    static TSet<FString> WarmedOrigins;
+    bool bAlreadyWarmed = false;
+    WarmedOrigins.Add(Origin, &bAlreadyWarmed);
+    if (bAlreadyWarmed)
+    {
+        return;
+    }
+
+    // 状态码无关紧要，握手完成即可
+    TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+    HttpRequest->SetVerb(TEXT("HEAD"));
+    HttpRequest->SetURL(Origin + TEXT("/"));
+
+    const double StartTime = FPlatformTime::Seconds();
+    HttpRequest->OnProcessRequestComplete().BindLambda(
+        [Origin, StartTime](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+        {
+            UE_LOG(LogDeepseek, Log, TEXT("预热到 %s 的连接%s，用时 %.0f ms"), *Origin,
+                bWasSuccessful ? TEXT("完成") : TEXT("失败"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+        }
+    );
+    HttpRequest->ProcessRequest();
+}
+
+void FDeepseekOpenAIService::ResetContext()
+{
+    WindowStart = 0;
+    RequestBodyCache.Reset();
+}
+
+int32 FDeepseekOpenAIService::EstimatePromptTokens(const TArray<FOpenAIMessage>& Messages, const FString& PendingUserMessage) const
+{
+    const int32 NumPinned = (Messages.Num() > 0 && Messages[0].Role == TEXT("system")) ? 1 : 0;
+    const int32 PendingTokens = PendingUserMessage.IsEmpty() ? 0 : FDeepseekTokenizer::CountTokens(PendingUserMessage) + FDeepseekTokenizer::MessageOverheadTokens;
+    return CountWindowTokens(Messages, NumPinned, ComputeWindowStart(Messages, NumPinned, PendingTokens)) + PendingTokens;
+}
+
+void FDeepseekOpenAIService::UpdateContextWindow(const TArray<FOpenAIMessage>& Messages, int32& OutNumPinned)
+{
+    OutNumPinned = (Messages.Num() > 0 && Messages[0].Role == TEXT("system")) ? 1 : 0;
+    WindowStart = ComputeWindowStart(Messages, OutNumPinned, 0);
+}
+
+int32 FDeepseekOpenAIService::ComputeWindowStart(const TArray<FOpenAIMessage>& Messages, int32 NumPinned, int32 ExtraTokens) const
+{
+    // 历史被清空或缩短后窗口从头开始
+    int32 Start = WindowStart;
+    if (Start < NumPinned || Start >= Messages.Num())
+    {
+        Start = NumPinned;
+    }
+
+    const int32 Budget = FMath::Max(0, MaxContextTokens - MaxTokens);
+    int32 Tokens = CountWindowTokens(Messages, NumPinned, Start) + ExtraTokens;
+    if (Tokens <= Budget)
+    {
+        return Start;
+    }
+
+    // 一次丢弃到预算的四分之三以下，避免之后每一轮都移动窗口导致请求体缓存失效
+    const int32 Target = Budget * 3 / 4;
+    const int32 LastIndex = Messages.Num() - 1;
+    while (Start < LastIndex && Tokens > Target)
+    {
+        Tokens -= FDeepseekTokenizer::CountMessageTokens(Messages[Start]);
+        ++Start;
+    }
+
+    // 窗口从用户消息开始，避免以孤立的助手回复开头
+    while (Start < LastIndex && Messages[Start].Role != TEXT("user"))
+    {
+        ++Start;
+    }
+
+    return Start;
+}
+
+int32 FDeepseekOpenAIService::CountWindowTokens(const TArray<FOpenAIMessage>& Messages, int32 NumPinned, int32 InWindowStart)
+{
+    int32 Tokens = 0;
+    for (int32 Index = 0; Index < NumPinned && Index < Messages.Num(); ++Index)
+    {
+        Tokens += FDeepseekTokenizer::CountMessageTokens(Messages[Index]);
+    }
+    for (int32 Index = FMath::Max(InWindowStart, NumPinned); Index < Messages.Num(); ++Index)
+    {
+        Tokens += FDeepseekTokenizer::CountMessageTokens(Messages[Index]);
+    }
+    return Tokens;
+}
+
+/** 重试等待时间的上限（秒） */
+static const double MaxRetryDelaySeconds = 30.0;
+
+/**
+ * 单次请求的状态，在HTTP回调线程、后台任务与游戏线程之间共享
+ * 一个请求可能经过多次尝试，每次重试前重置与单次尝试相关的字段
+ */
+struct FDeepseekChatRequestState
+{
+    /** 请求地址 */
+    FString Url;
+
+    /** Authorization头 */
+    FString Authorization;
+
+    /** 序列化好的请求体，每次尝试复用 */
+    TArray<uint8> Body;
+
+    /** 请求体中的模型，提供方池据此筛选地址 */
+    FString Model;
+
+    /** 估算的提示与回复token数，用于限流 */
+    int32 EstimatedTokens = 0;
+
+    /** 对冲请求使用的备用地址、Authorization头与请求体，未启用对冲时为空；请求体为空时沿用Body */
+    FString HedgeUrl;
+    FString HedgeAuthorization;
+    TArray<uint8> HedgeBody;
+
+    /** 对冲请求使用的模型，与Model相同时为空 */
+    FString HedgeModel;
+
+    /** 是否为流式请求 */
+    bool bStream = false;
+
+    /** 是否复用连接 */
+    bool bKeepAlive = true;
+
+    /** 在调度器中的会话与优先级，0表示不属于任何会话，不必排在同一会话的请求之后 */
+    uint32 SessionId = 0;
+    EDeepseekRequestPriority Priority = EDeepseekRequestPriority::Normal;
+
+    /** 用量记入的会话，对冲请求不在调度器的会话中，但用量仍归属发起它的会话 */
+    uint32 LedgerSessionId = 0;
+
+    /** 超时与重试设置 */
+    float TotalTimeoutSeconds = 0.0f;
+    float FirstByteTimeoutSeconds = 0.0f;
+    int32 MaxRetries = 0;
+
+    /** 当前尝试的HTTP请求，只在游戏线程访问，未发出时为空 */
+    TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+
+    /** 当前尝试在调度器中的票据，只在游戏线程访问 */
+    uint64 Ticket = 0;
+
+    /** 已进行的重试次数，只在游戏线程访问 */
+    int32 Attempt = 0;
+
+    /** 请求已结束或已取消，只在游戏线程访问 */
+    bool bFinished = false;
+
+    /** 当前尝试因首字节超时被中断 */
+    bool bFirstByteTimedOut = false;
+
+    /** 因总超时被中断 */
+    bool bTotalTimedOut = false;
+
+    /** 已开始输出的流式回复长时间没有新内容而被中断 */
+    bool bStalled = false;
+
+    /** 最近一次把增量交给调用方的时刻，只在游戏线程访问 */
+    double LastDeltaTime = 0.0;
+
+    /** 计时器，只在游戏线程访问 */
+    FTSTicker::FDelegateHandle TotalTimer;
+    FTSTicker::FDelegateHandle FirstByteTimer;
+    FTSTicker::FDelegateHandle RetryTimer;
+    FTSTicker::FDelegateHandle HedgeTimer;
+
+    /** 本次尝试使用的提供方，未使用提供方池时为INDEX_NONE */
+    int32 ProviderIndex = INDEX_NONE;
+
+    /** 发往备用地址的对冲请求，只在游戏线程访问 */
+    TSharedPtr<FDeepseekChatRequestState, ESPMode::ThreadSafe> Hedge;
+
+    /** 对冲请求所属的主请求 */
+    TWeakPtr<FDeepseekChatRequestState, ESPMode::ThreadSafe> HedgeOf;
+
+    /** 等待此请求的调用方分组，回调交给对冲请求时随之转移，只在游戏线程访问 */
+    TWeakPtr<FDeepseekRequestGroup> Group;
+
+    /** 是否为对冲请求 */
+    bool bIsHedge = false;
+
+    /** 是否只发往服务自己的地址 */
+    bool bIsolated = false;
+
+    /** 发出时正在回放录制的轨迹，回放的响应不影响限流器与对冲策略 */
+    bool bReplaying = false;
+
+    /** 录制中的本次尝试，未录制时为空，只在游戏线程访问 */
+    TSharedPtr<FDeepseekTraceExchange> TraceExchange;
+
+    /** 已取消，后台任务据此丢弃剩余数据 */
+    TAtomic<bool> bCancelled { false };
+
+    /** 当前尝试是否已收到响应字节 */
+    TAtomic<bool> bFirstByteReceived { false };
+
+    /** 已从响应中取走的字节数，只在HTTP回调中访问 */
+    int32 BytesConsumed = 0;
+
+    /** 保护以下待处理数据 */
+    FCriticalSection Mutex;
+
+    /** 等待后台解析的字节 */
+    TArray<uint8> PendingBytes;
+
+    /** 是否有后台任务正在解析 */
+    bool bWorkerActive = false;
+
+    /** HTTP请求是否已结束 */
+    bool bRequestFinished = false;
+
+    /** HTTP请求结束时的结果 */
+    bool bWasSuccessful = false;
+    int32 ResponseCode = 0;
+    FString ErrorBody;
+
+    /** 服务端要求的重试等待秒数 */
+    double RetryAfterSeconds = 0.0;
+
+    /** 调用发送的时刻与序列化请求体的耗时 */
+    double RequestStartTime = 0.0;
+    double SerializeSeconds = 0.0;
+
+    /** 当前尝试进入排队、发出、开始上传与收到首字节的时刻，在游戏线程记录 */
+    double QueueStartTime = 0.0;
+    double StartTime = 0.0;
+    double SendStartTime = 0.0;
+    double FirstByteTime = 0.0;
+
+    /** 当前尝试解析出第一段内容的时刻与累计解析时间，只在后台任务中访问 */
+    double FirstTokenTime = 0.0;
+    double DecodeSeconds = 0.0;
+
+    /** 在游戏线程执行回调的累计时间 */
+    double UIApplySeconds = 0.0;
+
+    /** 当前尝试结束时计算的耗时，后台任务组装回复时读取 */
+    FDeepseekRequestTimings Timings;
+
+    /** SSE解析器，只在后台任务中访问 */
+    FDeepseekSSEParser Parser;
+
+    /** 已收到的完整内容，只在后台任务中访问 */
+    FString Content;
+
+    /** 是否已把增量交给调用方，之后失败不再重试，避免内容重复 */
+    bool bDeltaDelivered = false;
+
+    /** 结束原因 */
+    FString FinishReason;
+
+    /** 使用情况 */
+    FOpenAIUsage Usage;
+
+    /** 增量回调，只在游戏线程访问 */
+    FOnDeepseekChatDelta OnDelta;
+
+    /** 完成回调，只在游戏线程访问 */
+    FOnDeepseekChatCompleted OnCompleted;
+
+    /** 重试前重置单次尝试的状态，此时上一次尝试的HTTP回调与后台任务都已结束 */
+    void ResetAttempt()
+    {
+        bFirstByteTimedOut = false;
+        bFirstByteReceived = false;
+        BytesConsumed = 0;
+        PendingBytes.Reset();
+        bWorkerActive = false;
+        bRequestFinished = false;
+        bWasSuccessful = false;
+        ResponseCode = 0;
+        ErrorBody.Reset();
+        RetryAfterSeconds = 0.0;
+        QueueStartTime = 0.0;
+        StartTime = 0.0;
+        SendStartTime = 0.0;
+        FirstByteTime = 0.0;
+        FirstTokenTime = 0.0;
+        DecodeSeconds = 0.0;
+        TraceExchange.Reset();
+        Parser.Reset();
+        Content.Reset();
+        FinishReason.Reset();
+        Usage = FOpenAIUsage();
+    }
+};
+
+typedef TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe> FDeepseekChatRequestStateRef;
+
+/** 录制中的尝试结束，把响应写入轨迹；流式响应的数据已在到达时分段记录，连接失败的尝试不记录 */
+static void FinishTraceExchange(FDeepseekChatRequestState& State, const FHttpResponsePtr& Response, bool bWasSuccessful)
+{
+    TSharedPtr<FDeepseekTraceExchange> Exchange = MoveTemp(State.TraceExchange);
+    State.TraceExchange.Reset();
+
+    FDeepseekHttpTrace* Trace = FDeepseekHttpTrace::Get();
+    if (!Exchange.IsValid() || Trace == nullptr || !bWasSuccessful || !Response.IsValid())
+    {
+        return;
+    }
+
+    Exchange->ResponseCode = Response->GetResponseCode();
+    Exchange->ContentType = Response->GetContentType();
+    Exchange->RetryAfter = Response->GetHeader(TEXT("Retry-After"));
+    if (Exchange->Chunks.Num() == 0 && Response->GetContent().Num() > 0)
+    {
+        Exchange->AddChunk(Response->GetContent().GetData(), Response->GetContent().Num());
+    }
+    Trace->AddExchange(*Exchange);
+}
+
+/**
+ * 合并到同一请求上的调用方
+ * 请求的增量与完成回调分发给所有调用方，最后一个调用方取消时才取消请求；只在游戏线程访问
+ */
+struct FDeepseekRequestGroup
+{
+    struct FSubscriber
+    {
+        uint32 Id = 0;
+        FOnDeepseekChatDelta OnDelta;
+        FOnDeepseekChatCompleted OnCompleted;
+    };
+
+    /** 实际发出的请求 */
+    TWeakPtr<FDeepseekChatRequestState, ESPMode::ThreadSafe> State;
+
+    /** 在进行中请求表里的键 */
+    FSHAHash Key;
+
+    TArray<FSubscriber> Subscribers;
+    uint32 NextSubscriberId = 1;
+
+    /** 已分发的流式内容，补给后加入的调用方 */
+    FString DeliveredContent;
+
+    bool bCompleted = false;
+
+    uint32 AddSubscriber(FOnDeepseekChatDelta OnDelta, FOnDeepseekChatCompleted OnCompleted)
+    {
+        FSubscriber& Subscriber = Subscribers.AddDefaulted_GetRef();
+        Subscriber.Id = NextSubscriberId++;
+        Subscriber.OnDelta = MoveTemp(OnDelta);
+        Subscriber.OnCompleted = MoveTemp(OnCompleted);
+        return Subscriber.Id;
+    }
+
+    bool HasSubscriber(uint32 Id) const
+    {
+        return Subscribers.ContainsByPredicate([Id](const FSubscriber& Subscriber) { return Subscriber.Id == Id; });
+    }
+
+    void DispatchDelta(const FString& Delta);
+
+    void DispatchCompleted(const FDeepseekChatReplyRef& Reply);
+};
+
+/** 进行中的请求，按合并键查找；只在游戏线程访问 */
+static TMap<FSHAHash, TWeakPtr<FDeepseekRequestGroup>> InFlightRequests;
+
+static void UnregisterInFlight(const FDeepseekRequestGroup& Group)
+{
+    const TWeakPtr<FDeepseekRequestGroup>* Found = InFlightRequests.Find(Group.Key);
+    if (Found != nullptr && (!Found->IsValid() || Found->Pin().Get() == &Group))
+    {
+        InFlightRequests.Remove(Group.Key);
+    }
+}
+
+void FDeepseekRequestGroup::DispatchDelta(const FString& Delta)
+{
+    DeliveredContent.Append(Delta);
+
+    // 回调中可能取消其他调用方或发出新请求，按ID逐个查找并复制回调再调用
+    TArray<uint32, TInlineAllocator<4>> Ids;
+    for (const FSubscriber& Subscriber : Subscribers)
+    {
+        Ids.Add(Subscriber.Id);
+    }
+
+    for (uint32 Id : Ids)
+    {
+        const FSubscriber* Subscriber = Subscribers.FindByPredicate([Id](const FSubscriber& Candidate) { return Candidate.Id == Id; });
+        if (Subscriber != nullptr && Subscriber->OnDelta)
+        {
+            FOnDeepseekChatDelta OnDelta = Subscriber->OnDelta;
+            OnDelta(Delta);
+        }
+    }
+}
+
+void FDeepseekRequestGroup::DispatchCompleted(const FDeepseekChatReplyRef& Reply)
+{
+    bCompleted = true;
+    UnregisterInFlight(*this);
+
+    TArray<FSubscriber> Completed = MoveTemp(Subscribers);
+    Subscribers.Reset();
+    for (FSubscriber& Subscriber : Completed)
+    {
+        if (Subscriber.OnCompleted)
+        {
+            Subscriber.OnCompleted(Reply);
+        }
+    }
+}
+
+/** 在当前尝试结束时计算各阶段耗时，没有观察到的阶段并入下一阶段 */
+static FDeepseekRequestTimings MakeTimings(const FDeepseekChatRequestState& State)
+{
+    const double EndTime = FPlatformTime::Seconds();
+    const double SendStartTime = State.SendStartTime > 0.0 ? State.SendStartTime : State.StartTime;
+    const double FirstByteTime = State.FirstByteTime > 0.0 ? State.FirstByteTime : EndTime;
+
+    FDeepseekRequestTimings Timings;
+    Timings.QueueSeconds = FMath::Max(0.0, State.StartTime - State.QueueStartTime);
+    Timings.SerializeSeconds = State.SerializeSeconds;
+    Timings.ConnectSeconds = FMath::Max(0.0, SendStartTime - State.StartTime);
+    Timings.ServerSeconds = FMath::Max(0.0, FirstByteTime - SendStartTime);
+    Timings.TransferSeconds = FMath::Max(0.0, EndTime - FirstByteTime);
+    Timings.FirstByteSeconds = FMath::Max(0.0, FirstByteTime - State.StartTime);
+    Timings.Retries = State.Attempt;
+    return Timings;
+}
+
+/** 移除尚未触发的计时器 */
+static void ClearTimer(FTSTicker::FDelegateHandle& Timer)
+{
+    if (Timer.IsValid())
+    {
+        FTSTicker::GetCoreTicker().RemoveTicker(Timer);
+        Timer.Reset();
+    }
+}
+
+void FDeepseekRequestHandle::Cancel()
+{
+    TSharedPtr<FDeepseekRequestGroup> PinnedGroup = Group.Pin();
+    if (PinnedGroup.IsValid())
+    {
+        FDeepseekOpenAIService::Unsubscribe(PinnedGroup.ToSharedRef(), SubscriberId);
+    }
+    Group.Reset();
+}
+
+bool FDeepseekRequestHandle::IsActive() const
+{
+    // 请求被取消或回调交给对冲请求后，分组随回调一起释放或转移，由完成标记决定是否结束
+    TSharedPtr<FDeepseekRequestGroup> PinnedGroup = Group.Pin();
+    return PinnedGroup.IsValid() && !PinnedGroup->bCompleted && PinnedGroup->HasSubscriber(SubscriberId);
+}
+
+void FDeepseekOpenAIService::CancelAll()
+{
+    // 只撤下本服务的调用方，其他服务合并到同一请求上的调用方不受影响
+    TArray<FDeepseekRequestHandle> Requests = MoveTemp(ActiveRequests);
+    ActiveRequests.Reset();
+
+    for (FDeepseekRequestHandle& Request : Requests)
+    {
+        Request.Cancel();
+    }
+}
+
+FDeepseekRequestHandle FDeepseekOpenAIService::SendChatRequest(const TArray<FOpenAIMessage>& Messages, FOnDeepseekChatCompleted OnCompleted, const FDeepseekRequestOptions& Options)
+{
+    return SendRequest(Messages, false, nullptr, MoveTemp(OnCompleted), Options);
+}
+
+FDeepseekRequestHandle FDeepseekOpenAIService::SendChatStreamRequest(const TArray<FOpenAIMessage>& Messages, FOnDeepseekChatDelta OnDelta, FOnDeepseekChatCompleted OnCompleted, const FDeepseekRequestOptions& Options)
+{
+    return SendRequest(Messages, true, MoveTemp(OnDelta), MoveTemp(OnCompleted), Options);
+}
+
+FDeepseekRequestHandle FDeepseekOpenAIService::SendRequest(const TArray<FOpenAIMessage>& Messages, bool bStream, FOnDeepseekChatDelta OnDelta, FOnDeepseekChatCompleted OnCompleted, const FDeepseekRequestOptions& Options)
+{
+    check(IsInGameThread());
+    FDeepseekGameThreadScope GameThreadScope;
+
+    FDeepseekChatRequestStateRef State = MakeShared<FDeepseekChatRequestState, ESPMode::ThreadSafe>();
+    State->RequestStartTime = FPlatformTime::Seconds();
+
+    FString Error;
+    if (!PrepareChatRequest(Messages, bStream, *State, Error))
+    {
+        DeliverReply(OnCompleted, MakeErrorReply(Error));
+        return FDeepseekRequestHandle();
+    }
+    State->SerializeSeconds = FPlatformTime::Seconds() - State->RequestStartTime;
+
+    // 回放在发出时确定，之后的重试也发往回放服务；回放的请求按隔离请求处理，不读写缓存、不记账
+    FDeepseekHttpTrace* Trace = FDeepseekHttpTrace::Get();
+    State->bReplaying = Trace != nullptr && Trace->IsReplaying();
+    FDeepseekRequestOptions RequestOptions = Options;
+    if (State->bReplaying)
+    {
+        State->Url = Trace->GetReplayUrl();
+        RequestOptions.bIsolated = true;
+    }
+
+    // 相同的请求直接使用缓存的回复，不发出HTTP请求；流式请求把整段内容作为一次增量交给调用方
+    FSHAHash CacheKey;
+    FString CachedContent;
+    if (LookupCachedReply(RequestOptions, CacheKey, CachedContent))
+    {
+        if (OnDelta)
+        {
+            OnDelta(CachedContent);
+        }
+
+        TSharedRef<FDeepseekChatReply, ESPMode::ThreadSafe> Reply = MakeShared<FDeepseekChatReply, ESPMode::ThreadSafe>();
+        Reply->bSuccess = true;
+        Reply->Content = MoveTemp(CachedContent);
+        Reply->FinishReason = TEXT("stop");
+        DeliverReply(OnCompleted, Reply);
+        return FDeepseekRequestHandle();
+    }
+
+    // 顺便清理已结束的请求
+    ActiveRequests.RemoveAll([](const FDeepseekRequestHandle& Request)
+    {
+        return !Request.IsActive();
+    });
+
+    // 完全相同的请求仍在进行时合并到它上面，流式请求先补上已输出的部分
+    const FSHAHash CoalesceKey = MakeCoalesceKey(*State);
+    if (const TWeakPtr<FDeepseekRequestGroup>* InFlight = InFlightRequests.Find(CoalesceKey))
+    {
+        TSharedPtr<FDeepseekRequestGroup> PinnedGroup = InFlight->Pin();
+        if (PinnedGroup.IsValid() && !PinnedGroup->bCompleted)
+        {
+            if (OnDelta && !PinnedGroup->DeliveredContent.IsEmpty())
+            {
+                OnDelta(PinnedGroup->DeliveredContent);
+            }
+
+            const uint32 SubscriberId = PinnedGroup->AddSubscriber(MoveTemp(OnDelta), MoveTemp(OnCompleted));
+            UE_LOG(LogDeepseek, Verbose, TEXT("合并到进行中的相同请求，共 %d 个调用方"), PinnedGroup->Subscribers.Num());
+
+            FDeepseekRequestHandle Handle(PinnedGroup.ToSharedRef(), SubscriberId);
+            ActiveRequests.Add(Handle);
+            return Handle;
+        }
+    }
+
+    TSharedRef<FDeepseekRequestGroup> Group = MakeShared<FDeepseekRequestGroup>();
+    Group->State = State;
+    Group->Key = CoalesceKey;
+    State->Group = Group;
+    const uint32 SubscriberId = Group->AddSubscriber(MoveTemp(OnDelta), MoveTemp(OnCompleted));
+    InFlightRequests.Add(CoalesceKey, Group);
+
+    State->SessionId = SessionId;
+    State->LedgerSessionId = SessionId;
+    State->Priority = RequestOptions.Priority;
+    State->TotalTimeoutSeconds = TotalTimeoutSeconds;
+    State->FirstByteTimeoutSeconds = bStream ? FirstByteTimeoutSeconds : 0.0f;
+    State->MaxRetries = MaxRetries;
+    State->bKeepAlive = bKeepAlive;
+    State->bIsolated = RequestOptions.bIsolated;
+    if (bStream)
+    {
+        State->OnDelta = [Group](const FString& Delta)
+        {
+            Group->DispatchDelta(Delta);
+        };
+    }
+    FOnDeepseekChatCompleted DispatchCompleted = [Group](const FDeepseekChatReplyRef& Reply)
+    {
+        Group->DispatchCompleted(Reply);
+    };
+    if (RequestOptions.bIsolated)
+    {
+        State->HedgeUrl.Reset();
+        State->OnCompleted = MoveTemp(DispatchCompleted);
+    }
+    else
+    {
+        State->OnCompleted = StoreReplyOnCompleted(CacheKey, Messages, MoveTemp(DispatchCompleted));
+    }
+
+    FDeepseekRequestHandle Handle(Group, SubscriberId);
+    ActiveRequests.Add(Handle);
+
+    StartAttempt(State);
+    return Handle;
+}
+
+void FDeepseekOpenAIService::StartAttempt(const FDeepseekChatRequestStateRef& State)
+{
+    State->QueueStartTime = FPlatformTime::Seconds();
+
+    FDeepseekRequestScheduler* Scheduler = FDeepseekRequestScheduler::Get();
+    if (Scheduler == nullptr)
+    {
+        ProcessAttempt(State);
+        return;
+    }
+
+    // 每次尝试单独排队，退避等待期间不占用并发名额
+    State->Ticket = Scheduler->Enqueue(State->SessionId, State->Priority, State->EstimatedTokens, [State]()
+    {
+        ProcessAttempt(State);
+    });
+}
+
+void FDeepseekOpenAIService::ProcessAttempt(const FDeepseekChatRequestStateRef& State)
+{
+    // 所有会话共用引擎的HTTP模块，连接由其统一复用
+    FString Url = State->Url;
+    FString Authorization = State->Authorization;
+
+    // 配置了提供方池时每次尝试重新选择地址，重试会避开刚失败的地址；没有可用地址时使用服务自己的地址
+    FDeepseekProviderPool* ProviderPool = FDeepseekProviderPool::Get();
+    if (ProviderPool != nullptr && !ProviderPool->IsEmpty() && !State->bIsHedge && !State->bIsolated)
+    {
+        State->ProviderIndex = ProviderPool->SelectProvider(State->Model, State->ProviderIndex);
+        if (const FDeepseekProvider* Provider = ProviderPool->GetProvider(State->ProviderIndex))
+        {
+            // 每个提供方使用自己的密钥，服务的密钥不发往其他地址
+            Url = Provider->ApiUrl;
+            Authorization = FString::Printf(TEXT("Bearer %s"), *Provider->ApiKey);
+        }
+    }
+
+    TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+    HttpRequest->SetVerb(TEXT("POST"));
+    HttpRequest->SetURL(Url);
+    HttpRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
+    HttpRequest->SetHeader(TEXT("Authorization"), Authorization);
+    if (State->bStream)
+    {
+        HttpRequest->SetHeader(TEXT("Accept"), TEXT("text/event-stream"));
+    }
+    if (!State->bKeepAlive)
+    {
+        HttpRequest->SetHeader(TEXT("Connection"), TEXT("close"));
+    }
+    HttpRequest->SetContent(State->Body);
+
+    // 录制请求体，响应在到达时记录
+    FDeepseekHttpTrace* Trace = FDeepseekHttpTrace::Get();
+    if (Trace != nullptr && Trace->IsRecording())
+    {
+        State->TraceExchange = MakeShared<FDeepseekTraceExchange>();
+        State->TraceExchange->RequestBody = State->Body;
+        State->TraceExchange->bStream = State->bStream;
+        State->TraceExchange->StartTime = FPlatformTime::Seconds();
+    }
+
+    // 流式请求在数据到达时立即取走已收到的部分，在后台解析，而不是等待整个响应结束
+    HttpRequest->OnRequestProgress().BindLambda(
+        [State](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
+        {
+            FDeepseekGameThreadScope GameThreadScope;
+
+            // 开始上传说明连接已建立，收到首字节说明服务端已开始响应
+            if (BytesSent > 0 && State->SendStartTime == 0.0)
+            {
+                State->SendStartTime = FPlatformTime::Seconds();
+            }
+
+            if (BytesReceived > 0 && State->FirstByteTime == 0.0)
+            {
+                State->FirstByteTime = FPlatformTime::Seconds();
+                State->bFirstByteReceived = true;
+                OnFirstByte(State);
+            }
+
+            if (State->bStream && Request.IsValid())
+            {
+                EnqueueStreamBytes(State, Request->GetResponse());
+            }
+        }
+    );
+
+    HttpRequest->OnProcessRequestComplete().BindLambda(
+        [State](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+        {
+            FDeepseekGameThreadScope GameThreadScope;
+            const double RetryAfterSeconds = ParseRetryAfter(Response);
+            const FDeepseekRequestTimings Timings = MakeTimings(*State);
+
+            // 所有请求共用一个限流器，任何一个响应中的限额信息都对之后的请求有效；回放的限额信息不是当前的
+            FDeepseekRequestScheduler* Scheduler = FDeepseekRequestScheduler::Get();
+            if (Scheduler != nullptr && !State->bReplaying)
+            {
+                Scheduler->GetRateLimiter().UpdateFromResponse(Response);
+            }
+
+            // 非流式响应整体在后台解码
+            if (!State->bStream)
+            {
+                FinishTraceExchange(*State, Response, bWasSuccessful);
+                {
+                    FScopeLock Lock(&State->Mutex);
+                    State->bRequestFinished = true;
+                    State->bWasSuccessful = bWasSuccessful && Response.IsValid();
+                    State->ResponseCode = Response.IsValid() ? Response->GetResponseCode() : 0;
+                    State->RetryAfterSeconds = RetryAfterSeconds;
+                }
+
+                AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [State, Response, bWasSuccessful, Timings]()
+                {
+                    FDeepseekChatReplyRef Reply = DecodeResponse(Response, bWasSuccessful, State->Model, Timings);
+                    AsyncTask(ENamedThreads::GameThread, [State, Reply]()
+                    {
+                        FDeepseekGameThreadScope GameThreadScope;
+                        FinishAttempt(State, Reply);
+                    });
+                });
+                return;
+            }
+
+            // 取走最后一次进度回调之后到达的数据
+            EnqueueStreamBytes(State, Response);
+            FinishTraceExchange(*State, Response, bWasSuccessful);
+
+            bool bStartWorker = false;
+            {
+                FScopeLock Lock(&State->Mutex);
+                State->bRequestFinished = true;
+                State->bWasSuccessful = bWasSuccessful && Response.IsValid();
+                State->ResponseCode = Response.IsValid() ? Response->GetResponseCode() : 0;
+                State->RetryAfterSeconds = RetryAfterSeconds;
+                State->Timings = Timings;
+                if (State->bWasSuccessful && State->ResponseCode != 200)
+                {
+                    State->ErrorBody = Response->GetContentAsString();
+                }
+                bStartWorker = !State->bWorkerActive;
+                State->bWorkerActive = true;
+            }
+
+            // 正在运行的解析任务会在处理完剩余数据后结束本次尝试
+            if (bStartWorker)
+            {
+                AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [State]()
+                {
+                    DrainStream(State);
+                });
+            }
+        }
+    );
+
+    State->HttpRequest = HttpRequest;
+    State->StartTime = FPlatformTime::Seconds();
+
+    // 只对主请求的第一次尝试对冲，重试本身已经是一次新的机会
+    FDeepseekHedgePolicy* HedgePolicy = FDeepseekHedgePolicy::Get();
+    if (HedgePolicy != nullptr && !State->HedgeUrl.IsEmpty() && State->Attempt == 0)
+    {
+        const double HedgeDelay = HedgePolicy->OnRequestStarted();
+        if (HedgeDelay >= 0.0)
+        {
+            State->HedgeTimer = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([State](float DeltaTime)
+            {
+                FDeepseekGameThreadScope GameThreadScope;
+                State->HedgeTimer.Reset();
+                LaunchHedge(State);
+                return false;
+            }), static_cast<float>(HedgeDelay));
+        }
+    }
+
+    // 总超时从第一次发出开始计算，覆盖之后的所有重试
+    if (State->TotalTimeoutSeconds > 0.0f && !State->TotalTimer.IsValid())
+    {
+        State->TotalTimer = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([State](float DeltaTime)
+        {
+            FDeepseekGameThreadScope GameThreadScope;
+            State->TotalTimer.Reset();
+            OnTotalTimeout(State);
+            return false;
+        }), State->TotalTimeoutSeconds);
+    }
+
+    // 首字节超时只针对本次尝试，连接建立不了或服务端迟迟不开始输出时中断并重试
+    if (State->FirstByteTimeoutSeconds > 0.0f)
+    {
+        State->FirstByteTimer = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([State](float DeltaTime)
+        {
+            State->FirstByteTimer.Reset();
+            if (!State->bFirstByteReceived && State->HttpRequest.IsValid())
+            {
+                State->bFirstByteTimedOut = true;
+                State->HttpRequest->CancelRequest();
+            }
+            return false;
+        }), State->FirstByteTimeoutSeconds);
+    }
+
+    HttpRequest->ProcessRequest();
+}
+
+void FDeepseekOpenAIService::FinishAttempt(const FDeepseekChatRequestStateRef& State, const FDeepseekChatReplyRef& Reply)
+{
+    // 先归还名额，让排队的请求尽早发出
+    FDeepseekRequestScheduler* Scheduler = FDeepseekRequestScheduler::Get();
+    if (Scheduler != nullptr && State->Ticket != 0)
+    {
+        if (!State->bReplaying)
+        {
+            Scheduler->GetRateLimiter().Reconcile(State->EstimatedTokens, Reply->Usage.TotalTokens);
+        }
+        Scheduler->Finish(State->Ticket);
+    }
+    State->Ticket = 0;
+    State->HttpRequest.Reset();
+
+    ClearTimer(State->FirstByteTimer);
+    ClearTimer(State->HedgeTimer);
+
+    // 已取消的请求不再回调
+    if (State->bFinished)
+    {
+        return;
+    }
+
+    // 输出停滞被中断，已收到的部分作为被截断的回复交给调用方；此时解析任务已结束，可以读取内容
+    if (State->bStalled && !Reply->bSuccess)
+    {
+        TSharedRef<FDeepseekChatReply, ESPMode::ThreadSafe> TruncatedReply = MakeShared<FDeepseekChatReply, ESPMode::ThreadSafe>();
+        TruncatedReply->bSuccess = true;
+        TruncatedReply->Content = State->Content;
+        TruncatedReply->FinishReason = TEXT("timeout");
+        TruncatedReply->Model = State->Model;
+        TruncatedReply->Timings = Reply->Timings;
+        CompleteRequest(State, TruncatedReply);
+        return;
+    }
+
+    if (State->bTotalTimedOut)
+    {
+        CompleteRequest(State, MakeErrorReply(TEXT("请求超时")));
+        return;
+    }
+
+    // 把本次尝试的结果计入提供方的延迟与熔断状态；请求本身的错误（如400）不算提供方失败
+    FDeepseekProviderPool* ProviderPool = FDeepseekProviderPool::Get();
+    const bool bProviderFailed = !State->bWasSuccessful || State->bFirstByteTimedOut || IsRetryableStatus(State->ResponseCode)
+        || State->ResponseCode == 401 || State->ResponseCode == 403;
+    if (ProviderPool != nullptr && State->ProviderIndex != INDEX_NONE)
+    {
+        if (Reply->bSuccess || State->bDeltaDelivered)
+        {
+            const double FirstByteTime = State->FirstByteTime > 0.0 ? State->FirstByteTime : FPlatformTime::Seconds();
+            ProviderPool->ReportSuccess(State->ProviderIndex, FirstByteTime - State->StartTime);
+        }
+        else if (bProviderFailed)
+        {
+            ProviderPool->ReportFailure(State->ProviderIndex);
+        }
+    }
+
+    // 开始输出前失败，对冲请求仍在进行时由它继续，不再重试
+    if (!Reply->bSuccess && !State->bDeltaDelivered && State->Hedge.IsValid() && !State->Hedge->bFinished)
+    {
+        HandOverToHedge(State);
+        return;
+    }
+
+    // 连接失败、首字节超时、429与5xx可以重试；已经显示了部分内容的流式请求不重试
+    const bool bRetryable = !Reply->bSuccess && !State->bDeltaDelivered
+        && (!State->bWasSuccessful || State->bFirstByteTimedOut || IsRetryableStatus(State->ResponseCode));
+
+    if (bRetryable && State->Attempt < State->MaxRetries)
+    {
+        // 还有其他提供方可用时立即切换，不必等待失败地址的退避
+        const bool bFailover = ProviderPool != nullptr && State->ProviderIndex != INDEX_NONE
+            && ProviderPool->HasAlternative(State->Model, State->ProviderIndex);
+        const double Delay = bFailover ? 0.0 : ComputeRetryDelay(State->Attempt, State->RetryAfterSeconds);
+        ++State->Attempt;
+
+        UE_LOG(LogDeepseek, Log, TEXT("请求失败（状态码 %d%s），%.1f 秒后进行第 %d 次重试"),
+            State->ResponseCode, State->bFirstByteTimedOut ? TEXT("，首字节超时") : TEXT(""), Delay, State->Attempt);
+
+        State->ResetAttempt();
+        State->RetryTimer = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([State](float DeltaTime)
+        {
+            FDeepseekGameThreadScope GameThreadScope;
+            State->RetryTimer.Reset();
+            StartAttempt(State);
+            return false;
+        }), static_cast<float>(Delay));
+        return;
+    }
+
+    CompleteRequest(State, State->bFirstByteTimedOut ? MakeErrorReply(TEXT("等待响应超时")) : Reply);
+}
+
+void FDeepseekOpenAIService::CompleteRequest(const FDeepseekChatRequestStateRef& State, const FDeepseekChatReplyRef& Reply)
+{
+    State->bFinished = true;
+
+    ClearTimer(State->TotalTimer);
+
+    const FDeepseekRequestTimings& Timings = Reply->Timings;
+    if (Timings.IsValid())
+    {
+        UE_LOG(LogDeepseek, Verbose, TEXT("请求耗时：排队 %.0f ms，连接 %.0f ms，服务端 %.0f ms，传输 %.0f ms，重试 %d 次"),
+            Timings.QueueSeconds * 1000.0, Timings.ConnectSeconds * 1000.0, Timings.ServerSeconds * 1000.0,
+            Timings.TransferSeconds * 1000.0, Timings.Retries);
+    }
+
+    // 回调可能再次发出请求，先从状态中取出
+    FOnDeepseekChatCompleted OnCompleted = MoveTemp(State->OnCompleted);
+    State->OnCompleted = nullptr;
+    State->OnDelta = nullptr;
+
+    // 只有完整结束的回复带有usage，按实际回答的请求的模型记账；被取消或中断的请求拿不到usage，不记账
+    FDeepseekUsageLedger* Ledger = FDeepseekUsageLedger::Get();
+    if (Ledger != nullptr && Reply->bSuccess && Reply->Usage.TotalTokens > 0 && !State->bIsolated)
+    {
+        Ledger->Record(State->Model, State->LedgerSessionId, Reply->Usage);
+    }
+
+    if (!OnCompleted)
+    {
+        return;
+    }
+
+    const double ApplyStartTime = FPlatformTime::Seconds();
+    {
+        TRACE_CPUPROFILER_EVENT_SCOPE(Deepseek_ApplyReply);
+        OnCompleted(Reply);
+    }
+
+    // 只统计有调用方等待的请求，被取消的对冲请求不计入
+    FDeepseekRequestStats* RequestStats = FDeepseekRequestStats::Get();
+    if (RequestStats != nullptr)
+    {
+        FDeepseekRequestSample Sample;
+        Sample.Time = FDateTime::Now();
+        Sample.Model = State->Model;
+        Sample.bStream = State->bStream;
+        Sample.bSuccess = Reply->bSuccess;
+        Sample.Timings = Reply->Timings;
+        Sample.Timings.SerializeSeconds = State->SerializeSeconds;
+        Sample.Timings.UIApplySeconds = State->UIApplySeconds + (FPlatformTime::Seconds() - ApplyStartTime);
+        Sample.Timings.TotalSeconds = ApplyStartTime - State->RequestStartTime;
+        Sample.PromptTokens = Reply->Usage.PromptTokens;
+        Sample.CompletionTokens = Reply->Usage.CompletionTokens;
+        RequestStats->AddSample(Sample);
+    }
+}
+
+void FDeepseekOpenAIService::OnTotalTimeout(const FDeepseekChatRequestStateRef& State)
 {
-    HttpModule = &FHttpModule::Get();
+    if (State->bFinished)
+    {
+        return;
+    }
+
+    // 已经开始输出的流式回复不受总超时限制，推理模型的长回答常常超过它；
+    // 改为检查输出是否停滞，停滞超过首字节超时（未设置时30秒）才中断，保留已收到的部分
+    if (State->LastDeltaTime > 0.0 && State->HttpRequest.IsValid())
+    {
+        const double StallSeconds = State->FirstByteTimeoutSeconds > 0.0f ? State->FirstByteTimeoutSeconds : 30.0;
+        const double IdleSeconds = FPlatformTime::Seconds() - State->LastDeltaTime;
+        if (IdleSeconds < StallSeconds)
+        {
+            State->TotalTimer = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([State](float DeltaTime)
+            {
+                FDeepseekGameThreadScope GameThreadScope;
+                State->TotalTimer.Reset();
+                OnTotalTimeout(State);
+                return false;
+            }), static_cast<float>(StallSeconds - IdleSeconds));
+            return;
+        }
+
+        UE_LOG(LogDeepseek, Log, TEXT("流式回复 %.0f 秒没有新的输出，中断并保留已收到的部分"), IdleSeconds);
+        State->bStalled = true;
+        State->HttpRequest->CancelRequest();
+        return;
+    }
+
+    State->bTotalTimedOut = true;
+
+    if (State->Hedge.IsValid())
+    {
+        CancelRequest(State->Hedge.ToSharedRef());
+    }
+
+    // 进行中的尝试断开后由FinishAttempt报告超时
+    if (State->HttpRequest.IsValid())
+    {
+        State->HttpRequest->CancelRequest();
+        return;
+    }
+
+    // 正在排队或等待重试
+    FDeepseekRequestScheduler* Scheduler = FDeepseekRequestScheduler::Get();
+    if (Scheduler != nullptr && State->Ticket != 0)
+    {
+        Scheduler->Cancel(State->Ticket);
+    }
+    State->Ticket = 0;
+
+    ClearTimer(State->RetryTimer);
+
+    CompleteRequest(State, MakeErrorReply(TEXT("请求超时")));
 }
 
-FDeepseekOpenAIService::~FDeepseekOpenAIService()
+void FDeepseekOpenAIService::LaunchHedge(const FDeepseekChatRequestStateRef& State)
 {
+    FDeepseekHedgePolicy* HedgePolicy = FDeepseekHedgePolicy::Get();
+    if (State->bFinished || !State->HttpRequest.IsValid() || State->bFirstByteReceived || HedgePolicy == nullptr || !HedgePolicy->TryAcquireHedge())
+    {
+        return;
+    }
+
+    FDeepseekChatRequestStateRef Hedge = MakeShared<FDeepseekChatRequestState, ESPMode::ThreadSafe>();
+    Hedge->Url = State->HedgeUrl;
+    Hedge->Authorization = State->HedgeAuthorization;
+    Hedge->Body = State->HedgeBody.Num() > 0 ? State->HedgeBody : State->Body;
+    Hedge->Model = State->HedgeModel.IsEmpty() ? State->Model : State->HedgeModel;
+    Hedge->LedgerSessionId = State->LedgerSessionId;
+    Hedge->RequestStartTime = State->RequestStartTime;
+    Hedge->SerializeSeconds = State->SerializeSeconds;
+    Hedge->bStream = State->bStream;
+    Hedge->bKeepAlive = State->bKeepAlive;
+    Hedge->Priority = State->Priority;
+    Hedge->TotalTimeoutSeconds = State->TotalTimeoutSeconds;
+    Hedge->FirstByteTimeoutSeconds = State->FirstByteTimeoutSeconds;
+    Hedge->bIsHedge = true;
+    Hedge->HedgeOf = State;
+    State->Hedge = Hedge;
+
+    UE_LOG(LogDeepseek, Log, TEXT("%.1f 秒内没有收到首字节，向备用地址 %s 发出对冲请求"),
+        FPlatformTime::Seconds() - State->StartTime, *Hedge->Url);
+
+    // 不属于任何会话，不必排在主请求之后
+    StartAttempt(Hedge);
 }
 
-void FDeepseekOpenAIService::Initialize(const FString& InApiKey, const FString& InModel, const FString& InApiUrl)
+void FDeepseekOpenAIService::OnFirstByte(const FDeepseekChatRequestStateRef& State)
 {
-    ApiKey = InApiKey;
-    Model = InModel;
-    ApiUrl = InApiUrl;
+    if (!State->bIsHedge)
+    {
+        // 主请求的首字节耗时决定之后的对冲等待时间
+        FDeepseekHedgePolicy* HedgePolicy = FDeepseekHedgePolicy::Get();
+        if (HedgePolicy != nullptr && State->bStream && State->Attempt == 0 && !State->bReplaying)
+        {
+            HedgePolicy->AddFirstByteSample(State->FirstByteTime - State->StartTime);
+        }
+
+        // 主请求先开始输出，对冲请求不再需要
+        if (State->Hedge.IsValid() && !State->bFinished)
+        {
+            CancelRequest(State->Hedge.ToSharedRef());
+            State->Hedge.Reset();
+        }
+        ClearTimer(State->HedgeTimer);
+        return;
+    }
+
+    // 对冲请求先开始输出，取消主请求
+    TSharedPtr<FDeepseekChatRequestState, ESPMode::ThreadSafe> Primary = State->HedgeOf.Pin();
+    if (Primary.IsValid() && !Primary->bFinished && Primary->Hedge == State)
+    {
+        UE_LOG(LogDeepseek, Log, TEXT("备用地址先开始输出，取消主请求"));
+
+        FDeepseekHedgePolicy* HedgePolicy = FDeepseekHedgePolicy::Get();
+        if (HedgePolicy != nullptr)
+        {
+            HedgePolicy->OnHedgeWon();
+        }
+        HandOverToHedge(Primary.ToSharedRef());
+    }
 }
 
-void FDeepseekOpenAIService::SendChatRequest(const TArray<FOpenAIMessage>& Messages, TFunction<void(const FString&, bool)> OnCompleted)
+void FDeepseekOpenAIService::HandOverToHedge(const FDeepseekChatRequestStateRef& State)
 {
-    if (ApiKey.IsEmpty())
+    FDeepseekChatRequestStateRef Hedge = State->Hedge.ToSharedRef();
+    Hedge->OnDelta = MoveTemp(State->OnDelta);
+    Hedge->OnCompleted = MoveTemp(State->OnCompleted);
+    State->OnDelta = nullptr;
+    State->OnCompleted = nullptr;
+
+    // 分组改为指向对冲请求，调用方取消或停止时断开的是实际在输出的连接；
+    // 进行中请求表按合并键指向分组，相同的新请求仍会合并到对冲请求上
+    TSharedPtr<FDeepseekRequestGroup> Group = State->Group.Pin();
+    if (Group.IsValid())
+    {
+        Group->State = Hedge;
+    }
+    Hedge->Group = MoveTemp(State->Group);
+    State->Group.Reset();
+
+    // 主请求就此结束，仍保留对冲请求的引用，句柄的取消会转给它
+    State->bFinished = true;
+    State->bCancelled = true;
+    ClearTimer(State->TotalTimer);
+    ClearTimer(State->FirstByteTimer);
+    ClearTimer(State->RetryTimer);
+    ClearTimer(State->HedgeTimer);
+
+    if (State->HttpRequest.IsValid())
+    {
+        State->HttpRequest->CancelRequest();
+    }
+}
+
+void FDeepseekOpenAIService::Unsubscribe(const TSharedRef<FDeepseekRequestGroup>& Group, uint32 SubscriberId)
+{
+    check(IsInGameThread());
+
+    const int32 NumRemoved = Group->Subscribers.RemoveAll([SubscriberId](const FDeepseekRequestGroup::FSubscriber& Subscriber)
+    {
+        return Subscriber.Id == SubscriberId;
+    });
+
+    if (NumRemoved == 0 || Group->Subscribers.Num() > 0 || Group->bCompleted)
     {
-        OnCompleted(TEXT("API密钥未设置"), false);
         return;
     }
 
-    if (ApiUrl.IsEmpty())
+    // 最后一个调用方离开，取消实际的请求
+    UnregisterInFlight(*Group);
+
+    TSharedPtr<FDeepseekChatRequestState, ESPMode::ThreadSafe> PinnedState = Group->State.Pin();
+    if (PinnedState.IsValid())
+    {
+        CancelRequest(PinnedState.ToSharedRef());
+    }
+}
+
+FSHAHash FDeepseekOpenAIService::MakeCoalesceKey(const FDeepseekChatRequestState& State)
+{
+    // 请求体由RequestBodyCache按固定顺序序列化，相同的对话得到相同的字节；与响应缓存键使用同样的分隔方式
+    const FString HeaderFields[] = { State.Url, State.Authorization };
+    return FDeepseekResponseCache::HashRequest(HeaderFields, State.Body);
+}
+
+void FDeepseekOpenAIService::CancelRequest(const FDeepseekChatRequestStateRef& State)
+{
+    check(IsInGameThread());
+
+    if (State->Hedge.IsValid())
+    {
+        CancelRequest(State->Hedge.ToSharedRef());
+    }
+
+    if (State->bFinished)
     {
-        OnCompleted(TEXT("API地址未设置"), false);
         return;
     }
 
-    // 创建HTTP请求
-    TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = HttpModule->CreateRequest();
-    HttpRequest->SetVerb(TEXT("POST"));
-    HttpRequest->SetURL(ApiUrl);
-    HttpRequest->SetHeader(TEXT("Content-Type"), TEXT("application/json"));
-    HttpRequest->SetHeader(TEXT("Authorization"), FString::Printf(TEXT("Bearer %s"), *ApiKey));
+    State->bFinished = true;
+    State->bCancelled = true;
 
-    // 创建请求体
-    TSharedPtr<FJsonObject> RequestObj = MakeShared<FJsonObject>();
-    RequestObj->SetStringField(TEXT("model"), Model);
-    
-    TArray<TSharedPtr<FJsonValue>> MessagesArray;
-    for (const FOpenAIMessage& Message : Messages)
+    // 释放回调持有的对象
+    State->OnCompleted = nullptr;
+    State->OnDelta = nullptr;
+
+    ClearTimer(State->TotalTimer);
+    ClearTimer(State->FirstByteTimer);
+    ClearTimer(State->RetryTimer);
+    ClearTimer(State->HedgeTimer);
+
+    // 进行中的请求断开连接，服务端随之停止生成；完成回调到达时归还名额
+    if (State->HttpRequest.IsValid())
     {
-        TSharedPtr<FJsonObject> MessageObj = MakeShared<FJsonObject>();
-        MessageObj->SetStringField(TEXT("role"), Message.Role);
-        MessageObj->SetStringField(TEXT("content"), Message.Content);
-        MessagesArray.Add(MakeShared<FJsonValueObject>(MessageObj));
+        State->HttpRequest->CancelRequest();
+        return;
     }
-    RequestObj->SetArrayField(TEXT("messages"), MessagesArray);
-    
-    // 可选参数
-    RequestObj->SetNumberField(TEXT("temperature"), 0.7);
-    RequestObj->SetNumberField(TEXT("max_tokens"), 1000);
-    RequestObj->SetBoolField(TEXT("stream"), false);
 
-    // 将JSON对象转换为字符串
-    FString RequestBody;
-    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&RequestBody);
-    FJsonSerializer::Serialize(RequestObj.ToSharedRef(), Writer);
+    FDeepseekRequestScheduler* Scheduler = FDeepseekRequestScheduler::Get();
+    if (Scheduler != nullptr && State->Ticket != 0)
+    {
+        Scheduler->Cancel(State->Ticket);
+    }
+    State->Ticket = 0;
+}
 
-    // 设置请求体
-    HttpRequest->SetContentAsString(RequestBody);
+double FDeepseekOpenAIService::ComputeRetryDelay(int32 Attempt, double RetryAfterSeconds)
+{
+    // 1、2、4……秒，取一半固定加一半随机，避免多个会话同时重试
+    const double Backoff = FMath::Min(MaxRetryDelaySeconds, FMath::Pow(2.0, static_cast<double>(Attempt)));
+    const double Delay = Backoff * 0.5 + FMath::FRandRange(0.0, Backoff * 0.5);
+    return FMath::Max(Delay, RetryAfterSeconds);
+}
 
-    // 创建回调函数
-    TSharedPtr<TFunction<void(const FString&, bool)>> SharedOnCompleted = MakeShared<TFunction<void(const FString&, bool)>>(MoveTemp(OnCompleted));
+double FDeepseekOpenAIService::ParseRetryAfter(const FHttpResponsePtr& Response)
+{
+    if (!Response.IsValid())
+    {
+        return 0.0;
+    }
 
-    // 设置回调
-    HttpRequest->OnProcessRequestComplete().BindLambda(
-        [this, SharedOnCompleted](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bWasSuccessful)
+    const FString RetryAfter = Response->GetHeader(TEXT("Retry-After")).TrimStartAndEnd();
+    if (RetryAfter.IsEmpty())
+    {
+        return 0.0;
+    }
+
+    if (RetryAfter.IsNumeric())
+    {
+        return FMath::Max(0.0, FCString::Atod(*RetryAfter));
+    }
+
+    FDateTime RetryTime;
+    if (FDateTime::ParseHttpDate(RetryAfter, RetryTime))
+    {
+        return FMath::Max(0.0, (RetryTime - FDateTime::UtcNow()).GetTotalSeconds());
+    }
+
+    return 0.0;
+}
+
+bool FDeepseekOpenAIService::IsRetryableStatus(int32 ResponseCode)
+{
+    return ResponseCode == 408 || ResponseCode == 429 || ResponseCode == 500 || ResponseCode == 502 || ResponseCode == 503 || ResponseCode == 504;
+}
+
+bool FDeepseekOpenAIService::PrepareChatRequest(const TArray<FOpenAIMessage>& Messages, bool bStream, FDeepseekChatRequestState& OutState, FString& OutError)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(Deepseek_PrepareChatRequest);
+
+    if (ApiKey.IsEmpty())
+    {
+        OutError = TEXT("API密钥未设置");
+        return false;
+    }
+
+    if (ApiUrl.IsEmpty())
+    {
+        OutError = TEXT("API地址未设置");
+        return false;
+    }
+
+    OutState.Url = ApiUrl;
+    OutState.Model = Model;
+    OutState.Authorization = FString::Printf(TEXT("Bearer %s"), *ApiKey);
+    OutState.bStream = bStream;
+
+    // 按token预算选择上下文窗口
+    int32 NumPinned = 0;
+    UpdateContextWindow(Messages, NumPinned);
+
+    // 只序列化上次请求之后新增的消息，前缀直接复用；前缀被改写时服务端的前缀缓存也会失效
+    if (!RequestBodyCache.Update(Messages, NumPinned, WindowStart))
+    {
+        ++PrefixBreaks;
+        UE_LOG(LogDeepseek, Verbose, TEXT("请求的messages前缀已改变，窗口起点 %d"), WindowStart);
+    }
+
+    RequestBodyCache.BuildBody(Model, ChatTemperature, MaxTokens, bStream, OutState.Body);
+    OutState.EstimatedTokens = CountWindowTokens(Messages, NumPinned, WindowStart) + MaxTokens;
+
+    // 配置了备用地址时为流式请求准备对冲，备用地址使用不同模型时单独生成请求体；
+    // 备用地址没有单独的密钥时，只有与服务的地址同一主机才沿用服务的密钥，否则不对冲
+    FDeepseekHedgePolicy* HedgePolicy = FDeepseekHedgePolicy::Get();
+    if (bStream && HedgePolicy != nullptr && HedgePolicy->IsEnabled())
+    {
+        const FString& HedgeApiKey = HedgePolicy->GetSecondaryApiKey();
+        const FString& HedgeModel = HedgePolicy->GetSecondaryModel();
+        const FString& HedgeUrl = HedgePolicy->GetSecondaryApiUrl();
+        if (!HedgeApiKey.IsEmpty() || FPlatformHttp::GetUrlDomain(HedgeUrl).Equals(FPlatformHttp::GetUrlDomain(ApiUrl), ESearchCase::IgnoreCase))
         {
-            this->HandleResponse(Response, bWasSuccessful, *SharedOnCompleted);
+            OutState.HedgeUrl = HedgeUrl;
+            OutState.HedgeAuthorization = FString::Printf(TEXT("Bearer %s"), HedgeApiKey.IsEmpty() ? *ApiKey : *HedgeApiKey);
+            if (!HedgeModel.IsEmpty() && HedgeModel != Model)
+            {
+                RequestBodyCache.BuildBody(HedgeModel, ChatTemperature, MaxTokens, bStream, OutState.HedgeBody);
+                OutState.HedgeModel = HedgeModel;
+            }
         }
-    );
+    }
 
-    // 发送请求
-    HttpRequest->ProcessRequest();
+    return true;
+}
+
+bool FDeepseekOpenAIService::FindSimilarReply(const TArray<FOpenAIMessage>& Messages, FString& OutContent, int32& OutDistance) const
+{
+    // 回放时请求必须真正发往回放服务
+    FDeepseekHttpTrace* Trace = FDeepseekHttpTrace::Get();
+    if (Trace != nullptr && Trace->IsReplaying())
+    {
+        return false;
+    }
+
+    FDeepseekResponseCache* Cache = FDeepseekResponseCache::Get();
+    FDeepseekPromptSignature Signature;
+    if (Cache == nullptr || !FDeepseekSimilarPromptIndex::MakeSignature(Model, ApiUrl, ChatTemperature, Messages, Signature))
+    {
+        return false;
+    }
+
+    return Cache->LookupSimilar(Signature, OutContent, OutDistance);
 }
 
-void FDeepseekOpenAIService::HandleResponse(FHttpResponsePtr Response, bool bWasSuccessful, TFunction<void(const FString&, bool)> OnCompleted)
+bool FDeepseekOpenAIService::LookupCachedReply(const FDeepseekRequestOptions& Options, FSHAHash& OutKey, FString& OutContent) const
 {
+    FDeepseekResponseCache* Cache = FDeepseekResponseCache::Get();
+    if (Cache == nullptr)
+    {
+        return false;
+    }
+
+    // 请求体缓存中已是本次发送的窗口，直接对其取哈希
+    OutKey = FDeepseekResponseCache::MakeKey(Model, ApiUrl, ChatTemperature, RequestBodyCache.GetSerializedMessages());
+    return !Options.bBypassCache && !Options.bIsolated && Cache->Lookup(OutKey, OutContent);
+}
+
+FOnDeepseekChatCompleted FDeepseekOpenAIService::StoreReplyOnCompleted(const FSHAHash& Key, const TArray<FOpenAIMessage>& Messages, FOnDeepseekChatCompleted OnCompleted)
+{
+    // 签名在发送时计算，回调时历史可能已经变化
+    FDeepseekPromptSignature Signature;
+    const bool bHasSignature = FDeepseekSimilarPromptIndex::MakeSignature(Model, ApiUrl, ChatTemperature, Messages, Signature);
+
+    return [Key, Signature, bHasSignature, RequestModel = Model, OnCompleted = MoveTemp(OnCompleted)](const FDeepseekChatReplyRef& Reply)
+    {
+        // 被截断或出错的回复不缓存，对冲请求用备用模型回答的也不缓存，缓存键对应的是服务的模型；
+        // 完成回调总在游戏线程，缓存无需加锁
+        FDeepseekResponseCache* Cache = FDeepseekResponseCache::Get();
+        if (Cache != nullptr && Reply->bSuccess && Reply->FinishReason == TEXT("stop") && Reply->Model == RequestModel)
+        {
+            Cache->Store(Key, Reply->Content);
+            if (bHasSignature)
+            {
+                Cache->AddSimilar(Signature, Key);
+            }
+        }
+
+        if (OnCompleted)
+        {
+            OnCompleted(Reply);
+        }
+    };
+}
+
+FDeepseekChatReplyRef FDeepseekOpenAIService::DecodeResponse(FHttpResponsePtr Response, bool bWasSuccessful, const FString& Model, const FDeepseekRequestTimings& Timings)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(Deepseek_DecodeResponse);
+    const double DecodeStartTime = FPlatformTime::Seconds();
+
     if (!bWasSuccessful || !Response.IsValid())
     {
-        OnCompleted(TEXT("请求失败"), false);
-        return;
+        return MakeErrorReply(TEXT("请求失败"));
     }
 
     FString ResponseString = Response->GetContentAsString();
     
     if (Response->GetResponseCode() != 200)
     {
-        OnCompleted(FString::Printf(TEXT("API错误: %d\n%s"), Response->GetResponseCode(), *ResponseString), false);
-        return;
+        return MakeErrorReply(FString::Printf(TEXT("API错误: %d\n%s"), Response->GetResponseCode(), *ResponseString));
     }
 
     FOpenAIResponse OpenAIResponse;
-    if (!ParseResponse(ResponseString, OpenAIResponse))
+    if (!ParseResponse(MoveTemp(ResponseString), OpenAIResponse))
+    {
+        return MakeErrorReply(TEXT("解析响应失败"));
+    }
+
+    if (OpenAIResponse.Choices.Num() == 0)
+    {
+        return MakeErrorReply(TEXT("没有收到回复"));
+    }
+
+    TSharedRef<FDeepseekChatReply, ESPMode::ThreadSafe> Reply = MakeShared<FDeepseekChatReply, ESPMode::ThreadSafe>();
+    Reply->bSuccess = true;
+    Reply->Content = MoveTemp(OpenAIResponse.Choices[0].Message.Content);
+    Reply->Content.ReplaceInline(TEXT("\r\n"), TEXT("\n"), ESearchCase::CaseSensitive);
+    Reply->FinishReason = MoveTemp(OpenAIResponse.Choices[0].FinishReason);
+    Reply->Usage = OpenAIResponse.Usage;
+    Reply->Model = Model;
+    Reply->Timings = Timings;
+    Reply->Timings.FirstTokenSeconds = Timings.FirstByteSeconds + Timings.TransferSeconds;
+    Reply->Timings.DecodeSeconds = FPlatformTime::Seconds() - DecodeStartTime;
+    return Reply;
+}
+
+bool FDeepseekOpenAIService::ParseResponse(FString&& ResponseString, FOpenAIResponse& OutResponse)
+{
+    // 逐记号解码，不构建DOM，缺失的字段（如usage）保持默认值
+    return FDeepseekResponseDecoder::DecodeResponse(MoveTemp(ResponseString), OutResponse);
+}
+
+void FDeepseekOpenAIService::EnqueueStreamBytes(const FDeepseekChatRequestStateRef& State, FHttpResponsePtr Response)
+{
+    if (!Response.IsValid())
     {
-        OnCompleted(TEXT("解析响应失败"), false);
         return;
     }
 
-    if (OpenAIResponse.Choices.Num() > 0)
+    // 错误响应不是事件流，留给完成回调处理
+    const int32 ResponseCode = Response->GetResponseCode();
+    if (ResponseCode != 0 && ResponseCode != 200)
     {
-        OnCompleted(OpenAIResponse.Choices[0].Message.Content, true);
+        return;
     }
-    else
+
+    const TArray<uint8>& Content = Response->GetContent();
+    if (Content.Num() <= State->BytesConsumed)
+    {
+        return;
+    }
+
+    bool bStartWorker = false;
+    {
+        FScopeLock Lock(&State->Mutex);
+        State->PendingBytes.Append(Content.GetData() + State->BytesConsumed, Content.Num() - State->BytesConsumed);
+        bStartWorker = !State->bWorkerActive;
+        State->bWorkerActive = true;
+    }
+    if (State->TraceExchange.IsValid())
+    {
+        State->TraceExchange->AddChunk(Content.GetData() + State->BytesConsumed, Content.Num() - State->BytesConsumed);
+    }
+    State->BytesConsumed = Content.Num();
+
+    // 同一时刻只有一个后台任务在解析，保证增量顺序
+    if (bStartWorker)
+    {
+        AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [State]()
+        {
+            DrainStream(State);
+        });
+    }
+}
+
+void FDeepseekOpenAIService::DrainStream(const FDeepseekChatRequestStateRef& State)
+{
+    for (;;)
+    {
+        TArray<uint8> Bytes;
+        {
+            FScopeLock Lock(&State->Mutex);
+            if (State->PendingBytes.Num() == 0)
+            {
+                State->bWorkerActive = false;
+                if (!State->bRequestFinished)
+                {
+                    return;
+                }
+                break;
+            }
+
+            Bytes = MoveTemp(State->PendingBytes);
+            State->PendingBytes.Reset();
+        }
+
+        // 已取消的请求只需把数据取走
+        if (State->bCancelled)
+        {
+            continue;
+        }
+
+        TRACE_CPUPROFILER_EVENT_SCOPE(Deepseek_DecodeStream);
+        const double DecodeStartTime = FPlatformTime::Seconds();
+
+        TArray<FString> Events;
+        State->Parser.Feed(Bytes.GetData(), Bytes.Num(), Events);
+
+        // 一次解析出的增量合并后一起派发到游戏线程
+        FString Deltas;
+        for (const FString& Event : Events)
+        {
+            FString Delta;
+            if (ParseStreamEvent(Event, Delta, State->FinishReason, State->Usage) && !Delta.IsEmpty())
+            {
+                Deltas.Append(Delta);
+            }
+        }
+
+        const double DecodeEndTime = FPlatformTime::Seconds();
+        State->DecodeSeconds += DecodeEndTime - DecodeStartTime;
+
+        if (!Deltas.IsEmpty())
+        {
+            if (State->FirstTokenTime == 0.0)
+            {
+                State->FirstTokenTime = DecodeEndTime;
+            }
+
+            State->Content.Append(Deltas);
+            State->bDeltaDelivered = true;
+            AsyncTask(ENamedThreads::GameThread, [State, Deltas = MoveTemp(Deltas)]()
+            {
+                FDeepseekGameThreadScope GameThreadScope;
+                if (!State->bFinished)
+                {
+                    State->LastDeltaTime = FPlatformTime::Seconds();
+                }
+                if (!State->bFinished && State->OnDelta)
+                {
+                    TRACE_CPUPROFILER_EVENT_SCOPE(Deepseek_ApplyDelta);
+                    const double ApplyStartTime = FPlatformTime::Seconds();
+                    State->OnDelta(Deltas);
+                    State->UIApplySeconds += FPlatformTime::Seconds() - ApplyStartTime;
+                }
+            });
+        }
+    }
+
+    // 请求已结束且数据已全部解析，组装最终回复
+    FDeepseekChatReplyRef Reply = MakeErrorReply(TEXT("请求失败"));
+    if (State->bWasSuccessful && State->ResponseCode != 200)
+    {
+        Reply = MakeErrorReply(FString::Printf(TEXT("API错误: %d\n%s"), State->ResponseCode, *State->ErrorBody));
+    }
+    else if (State->bWasSuccessful && State->Content.IsEmpty())
+    {
+        Reply = MakeErrorReply(TEXT("没有收到回复"));
+    }
+    else if (State->bWasSuccessful)
     {
-        OnCompleted(TEXT("没有收到回复"), false);
+        TSharedRef<FDeepseekChatReply, ESPMode::ThreadSafe> SuccessReply = MakeShared<FDeepseekChatReply, ESPMode::ThreadSafe>();
+        SuccessReply->bSuccess = true;
+        SuccessReply->Content = MoveTemp(State->Content);
+        SuccessReply->FinishReason = State->FinishReason;
+        SuccessReply->Usage = State->Usage;
+        SuccessReply->Model = State->Model;
+        SuccessReply->Timings = State->Timings;
+        SuccessReply->Timings.FirstTokenSeconds = FMath::Max(0.0, State->FirstTokenTime - State->StartTime);
+        SuccessReply->Timings.DecodeSeconds = State->DecodeSeconds;
+        Reply = SuccessReply;
     }
+
+    AsyncTask(ENamedThreads::GameThread, [State, Reply]()
+    {
+        FDeepseekGameThreadScope GameThreadScope;
+        FinishAttempt(State, Reply);
+    });
 }
 
-bool FDeepseekOpenAIService::ParseResponse(const FString& ResponseString, FOpenAIResponse& OutResponse)
+bool FDeepseekOpenAIService::ParseStreamEvent(const FString& EventData, FString& OutDelta, FString& OutFinishReason, FOpenAIUsage& OutUsage)
 {
-    TSharedPtr<FJsonObject> JsonObject;
-    TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ResponseString);
-    if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+    FOpenAIResponse Chunk;
+    if (!FDeepseekResponseDecoder::DecodeStreamChunk(EventData, Chunk))
     {
         return false;
     }
 
-    // 解析基本信息
-    OutResponse.Id = JsonObject->GetStringField(TEXT("id"));
-    OutResponse.Object = JsonObject->GetStringField(TEXT("object"));
-    OutResponse.Created = JsonObject->GetIntegerField(TEXT("created"));
-    OutResponse.Model = JsonObject->GetStringField(TEXT("model"));
+    // 最后一个块携带usage
+    if (Chunk.Usage.TotalTokens > 0)
+    {
+        OutUsage = Chunk.Usage;
+    }
 
-    // 解析选择
-    TArray<TSharedPtr<FJsonValue>> ChoicesArray = JsonObject->GetArrayField(TEXT("choices"));
-    for (const TSharedPtr<FJsonValue>& ChoiceValue : ChoicesArray)
+    if (Chunk.Choices.Num() == 0)
     {
-        TSharedPtr<FJsonObject> ChoiceObject = ChoiceValue->AsObject();
-        FOpenAIChoice Choice;
-        
-        Choice.Index = ChoiceObject->GetIntegerField(TEXT("index"));
-        Choice.FinishReason = ChoiceObject->GetStringField(TEXT("finish_reason"));
-        
-        TSharedPtr<FJsonObject> MessageObject = ChoiceObject->GetObjectField(TEXT("message"));
-        Choice.Message.Role = MessageObject->GetStringField(TEXT("role"));
-        Choice.Message.Content = MessageObject->GetStringField(TEXT("content"));
-        
-        OutResponse.Choices.Add(Choice);
+        return false;
     }
 
-    // 解析使用情况
-    TSharedPtr<FJsonObject> UsageObject = JsonObject->GetObjectField(TEXT("usage"));
-    OutResponse.Usage.PromptTokens = UsageObject->GetIntegerField(TEXT("prompt_tokens"));
-    OutResponse.Usage.CompletionTokens = UsageObject->GetIntegerField(TEXT("completion_tokens"));
-    OutResponse.Usage.TotalTokens = UsageObject->GetIntegerField(TEXT("total_tokens"));
+    // finish_reason在中间的块里为null
+    FOpenAIChoice& Choice = Chunk.Choices[0];
+    if (!Choice.FinishReason.IsEmpty())
+    {
+        OutFinishReason = MoveTemp(Choice.FinishReason);
+    }
+    OutDelta = MoveTemp(Choice.Message.Content);
 
     return true;
-} 
\ No newline at end of file
+}
+
+FDeepseekChatReplyRef FDeepseekOpenAIService::MakeErrorReply(const FString& Error)
+{
+    TSharedRef<FDeepseekChatReply, ESPMode::ThreadSafe> Reply = MakeShared<FDeepseekChatReply, ESPMode::ThreadSafe>();
+    Reply->bSuccess = false;
+    Reply->Content = Error;
+    return Reply;
+}
+
+void FDeepseekOpenAIService::DeliverReply(const FOnDeepseekChatCompleted& OnCompleted, const FDeepseekChatReplyRef& Reply)
+{
+    if (!OnCompleted)
+    {
+        return;
+    }
+
+    if (IsInGameThread())
+    {
+        OnCompleted(Reply);
+        return;
+    }
+
+    AsyncTask(ENamedThreads::GameThread, [OnCompleted, Reply]()
+    {
+        FDeepseekGameThreadScope GameThreadScope;
+        OnCompleted(Reply);
+    });
+}
@@ -0,0 +1,248 @@
+#include "DeepseekProviderPool.h"
+#include "Deepseek.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+
+TUniquePtr<FDeepseekProviderPool> FDeepseekProviderPool::Instance;
+
+/**
+ * 从配置读取提供方，每行一个：
+ * +Providers=(Name="backup", ApiUrl="https://...", ApiKey="sk-...", Models="deepseek-chat,deepseek-reasoner", Weight=1.0)
+ * 地址与密钥都是必需的，服务自己的密钥不会发往提供方的地址
+ */
+static bool ParseProvider(const FString& Line, FDeepseekProvider& OutProvider)
+{
+	if (!FParse::Value(*Line, TEXT("ApiUrl="), OutProvider.ApiUrl) || OutProvider.ApiUrl.IsEmpty()
+		|| !FParse::Value(*Line, TEXT("ApiKey="), OutProvider.ApiKey) || OutProvider.ApiKey.IsEmpty())
+	{
+		return false;
+	}
+
+	FParse::Value(*Line, TEXT("Name="), OutProvider.Name);
+	FParse::Value(*Line, TEXT("Weight="), OutProvider.Weight);
+
+	FString Models;
+	if (FParse::Value(*Line, TEXT("Models="), Models, false))
+	{
+		Models.ParseIntoArray(OutProvider.Models, TEXT(","));
+		for (FString& Model : OutProvider.Models)
+		{
+			Model.TrimStartAndEndInline();
+		}
+	}
+
+	if (OutProvider.Name.IsEmpty())
+	{
+		OutProvider.Name = OutProvider.ApiUrl;
+	}
+	return true;
+}
+
+void FDeepseekProviderPool::Initialize()
+{
+	if (!Instance.IsValid())
+	{
+		Instance.Reset(new FDeepseekProviderPool());
+
+		TArray<FString> Lines;
+		GConfig->GetArray(TEXT("DeepseekAISettings"), TEXT("Providers"), Lines, GEngineIni);
+		for (const FString& Line : Lines)
+		{
+			FDeepseekProvider Provider;
+			if (ParseProvider(Line, Provider))
+			{
+				Instance->AddProvider(Provider);
+			}
+			else
+			{
+				UE_LOG(LogDeepseek, Warning, TEXT("忽略无效的提供方配置: %s"), *Line);
+			}
+		}
+
+		int32 FailureThreshold = 3;
+		float EjectSeconds = 30.0f;
+		float MaxEjectSeconds = 300.0f;
+		GConfig->GetInt(TEXT("DeepseekAISettings"), TEXT("ProviderFailureThreshold"), FailureThreshold, GEngineIni);
+		GConfig->GetFloat(TEXT("DeepseekAISettings"), TEXT("ProviderEjectSeconds"), EjectSeconds, GEngineIni);
+		GConfig->GetFloat(TEXT("DeepseekAISettings"), TEXT("ProviderMaxEjectSeconds"), MaxEjectSeconds, GEngineIni);
+		Instance->SetCircuitBreaker(FailureThreshold, EjectSeconds, MaxEjectSeconds);
+	}
+}
+
+void FDeepseekProviderPool::Shutdown()
+{
+	Instance.Reset();
+}
+
+FDeepseekProviderPool* FDeepseekProviderPool::Get()
+{
+	return Instance.Get();
+}
+
+FDeepseekProviderPool::FDeepseekProviderPool()
+	: FailureThreshold(3)
+	, EjectSeconds(30.0f)
+	, MaxEjectSeconds(300.0f)
+{
+}
+
+void FDeepseekProviderPool::AddProvider(const FDeepseekProvider& Provider)
+{
+	if (Provider.ApiKey.IsEmpty())
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("提供方 %s 没有设置密钥，已忽略"), *Provider.Name);
+		return;
+	}
+
+	FDeepseekProvider& Added = Providers.Add_GetRef(Provider);
+	Added.Weight = FMath::Max(0.01f, Added.Weight);
+}
+
+void FDeepseekProviderPool::SetCircuitBreaker(int32 InFailureThreshold, float InEjectSeconds, float InMaxEjectSeconds)
+{
+	FailureThreshold = FMath::Max(1, InFailureThreshold);
+	EjectSeconds = FMath::Max(1.0f, InEjectSeconds);
+	MaxEjectSeconds = FMath::Max(EjectSeconds, InMaxEjectSeconds);
+}
+
+int32 FDeepseekProviderPool::SelectProvider(const FString& Model, int32 ExcludeIndex)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	int32 BestIndex = INDEX_NONE;
+	double BestScore = 0.0;
+	int32 FallbackIndex = INDEX_NONE;
+
+	for (int32 Index = 0; Index < Providers.Num(); ++Index)
+	{
+		FDeepseekProvider& Provider = Providers[Index];
+		if (!Provider.SupportsModel(Model))
+		{
+			continue;
+		}
+
+		// 熔断中的地址不参与路由；到期后放行一个请求探测，探测没有结果时下一个周期再探测
+		if (Provider.EjectedUntil > 0.0)
+		{
+			if (Now < Provider.EjectedUntil)
+			{
+				continue;
+			}
+
+			Provider.bProbing = true;
+			Provider.EjectedUntil = Now + Provider.EjectSeconds;
+			++Provider.Requests;
+			UE_LOG(LogDeepseek, Log, TEXT("提供方 %s 熔断到期，发出探测请求"), *Provider.Name);
+			return Index;
+		}
+
+		if (Index == ExcludeIndex)
+		{
+			FallbackIndex = Index;
+			continue;
+		}
+
+		// 尚无样本的地址优先，使每个地址都能得到测量
+		const double Score = Provider.LatencyEwma / Provider.Weight;
+		if (BestIndex == INDEX_NONE || Score < BestScore)
+		{
+			BestIndex = Index;
+			BestScore = Score;
+		}
+	}
+
+	if (BestIndex == INDEX_NONE)
+	{
+		BestIndex = FallbackIndex;
+	}
+	if (BestIndex != INDEX_NONE)
+	{
+		++Providers[BestIndex].Requests;
+	}
+	return BestIndex;
+}
+
+bool FDeepseekProviderPool::HasAlternative(const FString& Model, int32 ExcludeIndex) const
+{
+	const double Now = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < Providers.Num(); ++Index)
+	{
+		const FDeepseekProvider& Provider = Providers[Index];
+		if (Index != ExcludeIndex && Provider.SupportsModel(Model) && Now >= Provider.EjectedUntil)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FDeepseekProviderPool::ReportSuccess(int32 Index, double FirstByteSeconds)
+{
+	if (!Providers.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	FDeepseekProvider& Provider = Providers[Index];
+	Provider.LatencyEwma = Provider.LatencyEwma > 0.0
+		? Provider.LatencyEwma + EwmaAlpha * (FirstByteSeconds - Provider.LatencyEwma)
+		: FirstByteSeconds;
+	Provider.ConsecutiveFailures = 0;
+
+	if (Provider.EjectedUntil > 0.0)
+	{
+		UE_LOG(LogDeepseek, Log, TEXT("提供方 %s 已恢复"), *Provider.Name);
+	}
+	Provider.EjectedUntil = 0.0;
+	Provider.EjectSeconds = 0.0;
+	Provider.bProbing = false;
+}
+
+void FDeepseekProviderPool::ReportFailure(int32 Index)
+{
+	if (!Providers.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	FDeepseekProvider& Provider = Providers[Index];
+	++Provider.Failures;
+	++Provider.ConsecutiveFailures;
+
+	// 探测失败时加倍熔断时长，否则连续失败达到阈值后开始熔断
+	if (Provider.bProbing || Provider.ConsecutiveFailures >= FailureThreshold)
+	{
+		Provider.EjectSeconds = Provider.bProbing ? FMath::Min(static_cast<double>(MaxEjectSeconds), Provider.EjectSeconds * 2.0) : EjectSeconds;
+		Provider.EjectedUntil = FPlatformTime::Seconds() + Provider.EjectSeconds;
+		Provider.bProbing = false;
+
+		UE_LOG(LogDeepseek, Warning, TEXT("提供方 %s 连续失败 %d 次，熔断 %.0f 秒"),
+			*Provider.Name, Provider.ConsecutiveFailures, Provider.EjectSeconds);
+	}
+}
+
+void FDeepseekProviderPool::DumpStatus() const
+{
+	const double Now = FPlatformTime::Seconds();
+	for (const FDeepseekProvider& Provider : Providers)
+	{
+		const double EjectedFor = FMath::Max(0.0, Provider.EjectedUntil - Now);
+		UE_LOG(LogDeepseek, Display, TEXT("%s  %s  首字节 %.0f ms  权重 %.2f  请求 %d  失败 %d  %s"),
+			*Provider.Name, *Provider.ApiUrl, Provider.LatencyEwma * 1000.0, Provider.Weight, Provider.Requests, Provider.Failures,
+			Provider.EjectedUntil <= 0.0 ? TEXT("正常") : Provider.bProbing ? TEXT("探测中") : *FString::Printf(TEXT("熔断 %.0f 秒"), EjectedFor));
+	}
+}
+
+static FAutoConsoleCommand DumpProvidersCommand(
+	TEXT("Deepseek.Providers"),
+	TEXT("输出提供方池中各地址的延迟与熔断状态"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FDeepseekProviderPool* Pool = FDeepseekProviderPool::Get();
+		if (Pool == nullptr || Pool->IsEmpty())
+		{
+			UE_LOG(LogDeepseek, Display, TEXT("没有配置提供方池，请求发往设置中的API地址"));
+			return;
+		}
+		Pool->DumpStatus();
+	}));
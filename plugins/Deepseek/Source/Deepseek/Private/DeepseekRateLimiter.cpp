@@ -0,0 +1,200 @@
+#include "DeepseekRateLimiter.h"
+#include "Deepseek.h"
+
+/** 429未带Retry-After时的暂停秒数 */
+static const double DefaultThrottleSeconds = 1.0;
+
+FDeepseekRateLimiter::FDeepseekRateLimiter()
+	: RequestsPerSecond(0.0f)
+	, TokensPerMinute(0)
+	, RequestBucket(0.0)
+	, TokenBucket(0.0)
+	, LastRefillTime(FPlatformTime::Seconds())
+	, PausedUntil(0.0)
+{
+}
+
+void FDeepseekRateLimiter::SetLimits(float InRequestsPerSecond, int32 InTokensPerMinute)
+{
+	RequestsPerSecond = FMath::Max(0.0f, InRequestsPerSecond);
+	TokensPerMinute = FMath::Max(0, InTokensPerMinute);
+
+	// 允许一秒的请求突发与一分钟的token突发
+	RequestBucket = FMath::Max(1.0, static_cast<double>(RequestsPerSecond));
+	TokenBucket = TokensPerMinute;
+	LastRefillTime = FPlatformTime::Seconds();
+}
+
+void FDeepseekRateLimiter::Refill(double Now)
+{
+	const double Elapsed = FMath::Max(0.0, Now - LastRefillTime);
+	LastRefillTime = Now;
+
+	if (RequestsPerSecond > 0.0f)
+	{
+		RequestBucket = FMath::Min(FMath::Max(1.0, static_cast<double>(RequestsPerSecond)), RequestBucket + Elapsed * RequestsPerSecond);
+	}
+	if (TokensPerMinute > 0)
+	{
+		TokenBucket = FMath::Min(static_cast<double>(TokensPerMinute), TokenBucket + Elapsed * TokensPerMinute / 60.0);
+	}
+}
+
+double FDeepseekRateLimiter::GetWaitSeconds(int32 Tokens)
+{
+	const double Now = FPlatformTime::Seconds();
+	Refill(Now);
+
+	double Wait = FMath::Max(0.0, PausedUntil - Now);
+
+	if (RequestsPerSecond > 0.0f && RequestBucket < 1.0)
+	{
+		Wait = FMath::Max(Wait, (1.0 - RequestBucket) / RequestsPerSecond);
+	}
+
+	// 超过整个桶的请求等到桶满即可发出，否则永远发不出
+	if (TokensPerMinute > 0)
+	{
+		const double Needed = FMath::Min(static_cast<double>(Tokens), static_cast<double>(TokensPerMinute));
+		if (TokenBucket < Needed)
+		{
+			Wait = FMath::Max(Wait, (Needed - TokenBucket) * 60.0 / TokensPerMinute);
+		}
+	}
+
+	return Wait;
+}
+
+void FDeepseekRateLimiter::Acquire(int32 Tokens)
+{
+	Refill(FPlatformTime::Seconds());
+
+	if (RequestsPerSecond > 0.0f)
+	{
+		RequestBucket -= 1.0;
+	}
+	if (TokensPerMinute > 0)
+	{
+		TokenBucket -= FMath::Min(Tokens, TokensPerMinute);
+	}
+}
+
+void FDeepseekRateLimiter::Reconcile(int32 EstimatedTokens, int32 ActualTokens)
+{
+	if (TokensPerMinute > 0 && ActualTokens > 0)
+	{
+		// 多扣的退回，少扣的补扣，允许余量暂时为负
+		TokenBucket = FMath::Min(static_cast<double>(TokensPerMinute), TokenBucket + EstimatedTokens - ActualTokens);
+	}
+}
+
+void FDeepseekRateLimiter::UpdateFromResponse(const FHttpResponsePtr& Response)
+{
+	if (!Response.IsValid())
+	{
+		return;
+	}
+
+	Refill(FPlatformTime::Seconds());
+
+	// 服务端公布的token限额比本地配置更准确
+	const FString LimitTokens = Response->GetHeader(TEXT("x-ratelimit-limit-tokens"));
+	if (LimitTokens.IsNumeric())
+	{
+		const int32 ServerTokensPerMinute = FCString::Atoi(*LimitTokens);
+		if (ServerTokensPerMinute > 0 && (TokensPerMinute == 0 || ServerTokensPerMinute < TokensPerMinute))
+		{
+			UE_LOG(LogDeepseek, Log, TEXT("按服务端限额把每分钟token数上限调整为 %d"), ServerTokensPerMinute);
+			TokenBucket = TokensPerMinute == 0 ? ServerTokensPerMinute : TokenBucket;
+			TokensPerMinute = ServerTokensPerMinute;
+		}
+	}
+
+	// 剩余额度以服务端为准，其他客户端也在消耗同一个密钥
+	const FString RemainingTokens = Response->GetHeader(TEXT("x-ratelimit-remaining-tokens"));
+	if (TokensPerMinute > 0 && RemainingTokens.IsNumeric())
+	{
+		TokenBucket = FMath::Min(TokenBucket, FCString::Atod(*RemainingTokens));
+	}
+
+	const FString RemainingRequests = Response->GetHeader(TEXT("x-ratelimit-remaining-requests"));
+	if (RemainingRequests.IsNumeric() && FCString::Atoi(*RemainingRequests) <= 0)
+	{
+		PauseFor(ParseDuration(Response->GetHeader(TEXT("x-ratelimit-reset-requests"))));
+	}
+	if (RemainingTokens.IsNumeric() && FCString::Atoi(*RemainingTokens) <= 0)
+	{
+		PauseFor(ParseDuration(Response->GetHeader(TEXT("x-ratelimit-reset-tokens"))));
+	}
+
+	if (Response->GetResponseCode() == 429)
+	{
+		const FString RetryAfter = Response->GetHeader(TEXT("Retry-After")).TrimStartAndEnd();
+		PauseFor(RetryAfter.IsNumeric() ? FCString::Atod(*RetryAfter) : DefaultThrottleSeconds);
+	}
+}
+
+void FDeepseekRateLimiter::PauseFor(double Seconds)
+{
+	if (Seconds > 0.0)
+	{
+		PausedUntil = FMath::Max(PausedUntil, FPlatformTime::Seconds() + Seconds);
+		UE_LOG(LogDeepseek, Log, TEXT("触及速率限制，暂停发出请求 %.1f 秒"), Seconds);
+	}
+}
+
+double FDeepseekRateLimiter::ParseDuration(const FString& Value)
+{
+	const FString Trimmed = Value.TrimStartAndEnd();
+	if (Trimmed.IsEmpty())
+	{
+		return -1.0;
+	}
+	if (Trimmed.IsNumeric())
+	{
+		return FCString::Atod(*Trimmed);
+	}
+
+	// 数字加单位的序列：h、m、s、ms
+	double Seconds = 0.0;
+	int32 Index = 0;
+	while (Index < Trimmed.Len())
+	{
+		const int32 NumberStart = Index;
+		while (Index < Trimmed.Len() && (FChar::IsDigit(Trimmed[Index]) || Trimmed[Index] == TEXT('.')))
+		{
+			++Index;
+		}
+		if (Index == NumberStart)
+		{
+			return -1.0;
+		}
+		const double Number = FCString::Atod(*Trimmed.Mid(NumberStart, Index - NumberStart));
+
+		if (Trimmed.Mid(Index, 2) == TEXT("ms"))
+		{
+			Seconds += Number / 1000.0;
+			Index += 2;
+		}
+		else if (Index < Trimmed.Len() && Trimmed[Index] == TEXT('h'))
+		{
+			Seconds += Number * 3600.0;
+			++Index;
+		}
+		else if (Index < Trimmed.Len() && Trimmed[Index] == TEXT('m'))
+		{
+			Seconds += Number * 60.0;
+			++Index;
+		}
+		else if (Index < Trimmed.Len() && Trimmed[Index] == TEXT('s'))
+		{
+			Seconds += Number;
+			++Index;
+		}
+		else
+		{
+			return -1.0;
+		}
+	}
+	return Seconds;
+}
@@ -0,0 +1,162 @@
+#include "DeepseekRequestBodyCache.h"
+#include "DeepseekOpenAIService.h"
+
+FDeepseekRequestBodyCache::FDeepseekRequestBodyCache()
+	: CachedNumPinned(0)
+	, CachedWindowStart(0)
+{
+}
+
+void FDeepseekRequestBodyCache::Reset()
+{
+	SerializedMessages.Reset();
+	CachedMessages.Reset();
+	CachedNumPinned = 0;
+	CachedWindowStart = 0;
+}
+
+int32 FDeepseekRequestBodyCache::ToMessageIndex(int32 SequenceIndex, int32 NumPinned, int32 WindowStart)
+{
+	return SequenceIndex < NumPinned ? SequenceIndex : WindowStart + (SequenceIndex - NumPinned);
+}
+
+bool FDeepseekRequestBodyCache::IsPrefixOf(const TArray<FOpenAIMessage>& Messages, int32 NumPinned, int32 WindowStart) const
+{
+	if (CachedMessages.Num() == 0)
+	{
+		return true;
+	}
+
+	if (NumPinned != CachedNumPinned || WindowStart != CachedWindowStart)
+	{
+		return false;
+	}
+
+	// 每条都比较内容：仍引用同一段文本时不逐字比较，被替换的消息即使长度相同也能发现
+	for (int32 Index = 0; Index < CachedMessages.Num(); ++Index)
+	{
+		const int32 MessageIndex = ToMessageIndex(Index, NumPinned, WindowStart);
+		if (!Messages.IsValidIndex(MessageIndex))
+		{
+			return false;
+		}
+
+		const FOpenAIMessage& Message = Messages[MessageIndex];
+		const FCachedMessage& Cached = CachedMessages[Index];
+		if (!Message.Role.Equals(Cached.Role, ESearchCase::CaseSensitive) || !Message.Content.Equals(Cached.Content))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FDeepseekRequestBodyCache::Update(const TArray<FOpenAIMessage>& Messages, int32 NumPinned, int32 WindowStart)
+{
+	NumPinned = FMath::Clamp(NumPinned, 0, Messages.Num());
+	WindowStart = FMath::Clamp(WindowStart, NumPinned, Messages.Num());
+
+	const bool bPrefixKept = IsPrefixOf(Messages, NumPinned, WindowStart);
+	if (!bPrefixKept)
+	{
+		Reset();
+	}
+	CachedNumPinned = NumPinned;
+	CachedWindowStart = WindowStart;
+
+	const int32 NumInWindow = NumPinned + (Messages.Num() - WindowStart);
+	for (int32 Index = CachedMessages.Num(); Index < NumInWindow; ++Index)
+	{
+		const FOpenAIMessage& Message = Messages[ToMessageIndex(Index, NumPinned, WindowStart)];
+		if (Index > 0)
+		{
+			SerializedMessages.Add(',');
+		}
+
+		AppendMessage(SerializedMessages, Message);
+		CachedMessages.Add({ Message.Role, Message.Content });
+	}
+
+	return bPrefixKept;
+}
+
+void FDeepseekRequestBodyCache::BuildBody(const FString& Model, double Temperature, int32 MaxTokens, bool bStream, TArray<uint8>& OutBody) const
+{
+	OutBody.Reset(SerializedMessages.Num() + 128);
+
+	AppendLiteral(OutBody, "{\"model\":");
+	AppendJsonString(OutBody, Model);
+	AppendLiteral(OutBody, ",\"messages\":[");
+	OutBody.Append(SerializedMessages);
+	AppendLiteral(OutBody, "],\"temperature\":");
+	AppendLiteral(OutBody, TCHAR_TO_UTF8(*FString::SanitizeFloat(Temperature)));
+	AppendLiteral(OutBody, ",\"max_tokens\":");
+	AppendLiteral(OutBody, TCHAR_TO_UTF8(*FString::FromInt(MaxTokens)));
+	AppendLiteral(OutBody, bStream ? ",\"stream\":true,\"stream_options\":{\"include_usage\":true}}" : ",\"stream\":false}");
+}
+
+void FDeepseekRequestBodyCache::AppendMessage(TArray<uint8>& Out, const FOpenAIMessage& Message)
+{
+	AppendLiteral(Out, "{\"role\":");
+	AppendJsonString(Out, Message.Role);
+	AppendLiteral(Out, ",\"content\":");
+	AppendJsonString(Out, Message.Content.View());
+	Out.Add('}');
+}
+
+void FDeepseekRequestBodyCache::AppendJsonString(TArray<uint8>& Out, FStringView Value)
+{
+	Out.Add('"');
+
+	const TCHAR* Chars = Value.GetData();
+	const int32 Len = Value.Len();
+	int32 RunStart = 0;
+
+	auto FlushRun = [&Out, Chars, &RunStart](int32 RunEnd)
+	{
+		if (RunEnd > RunStart)
+		{
+			// 只在ASCII转义字符处切分，代理对不会被拆开
+			FTCHARToUTF8 Converter(Chars + RunStart, RunEnd - RunStart);
+			Out.Append(reinterpret_cast<const uint8*>(Converter.Get()), Converter.Length());
+		}
+		RunStart = RunEnd + 1;
+	};
+
+	for (int32 Index = 0; Index < Len; ++Index)
+	{
+		const TCHAR Char = Chars[Index];
+		if (Char != TEXT('"') && Char != TEXT('\\') && Char >= 0x20)
+		{
+			continue;
+		}
+
+		FlushRun(Index);
+		switch (Char)
+		{
+		case TEXT('"'):  AppendLiteral(Out, "\\\""); break;
+		case TEXT('\\'): AppendLiteral(Out, "\\\\"); break;
+		case TEXT('\n'): AppendLiteral(Out, "\\n"); break;
+		case TEXT('\r'): AppendLiteral(Out, "\\r"); break;
+		case TEXT('\t'): AppendLiteral(Out, "\\t"); break;
+		case TEXT('\b'): AppendLiteral(Out, "\\b"); break;
+		case TEXT('\f'): AppendLiteral(Out, "\\f"); break;
+		default:
+			{
+				ANSICHAR Escaped[8];
+				FCStringAnsi::Sprintf(Escaped, "\\u%04x", static_cast<uint32>(Char));
+				AppendLiteral(Out, Escaped);
+			}
+			break;
+		}
+	}
+	FlushRun(Len);
+
+	Out.Add('"');
+}
+
+void FDeepseekRequestBodyCache::AppendLiteral(TArray<uint8>& Out, const ANSICHAR* Literal)
+{
+	Out.Append(reinterpret_cast<const uint8*>(Literal), FCStringAnsi::Strlen(Literal));
+}
@@ -0,0 +1,226 @@
+#include "DeepseekRequestScheduler.h"
+#include "Deepseek.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+TRACE_DECLARE_INT_COUNTER(DeepseekQueueDepth, TEXT("Deepseek/QueueDepth"));
+TRACE_DECLARE_INT_COUNTER(DeepseekActiveRequests, TEXT("Deepseek/ActiveRequests"));
+
+TUniquePtr<FDeepseekRequestScheduler> FDeepseekRequestScheduler::Instance;
+
+void FDeepseekRequestScheduler::Initialize()
+{
+	if (!Instance.IsValid())
+	{
+		Instance.Reset(new FDeepseekRequestScheduler());
+
+		int32 MaxConcurrentRequests = 4;
+		GConfig->GetInt(TEXT("DeepseekAISettings"), TEXT("MaxConcurrentRequests"), MaxConcurrentRequests, GEngineIni);
+		Instance->SetMaxConcurrent(MaxConcurrentRequests);
+
+		float RequestsPerSecond = 0.0f;
+		int32 TokensPerMinute = 0;
+		GConfig->GetFloat(TEXT("DeepseekAISettings"), TEXT("RateLimitRequestsPerSecond"), RequestsPerSecond, GEngineIni);
+		GConfig->GetInt(TEXT("DeepseekAISettings"), TEXT("RateLimitTokensPerMinute"), TokensPerMinute, GEngineIni);
+		Instance->RateLimiter.SetLimits(RequestsPerSecond, TokensPerMinute);
+	}
+}
+
+void FDeepseekRequestScheduler::Shutdown()
+{
+	Instance.Reset();
+}
+
+FDeepseekRequestScheduler* FDeepseekRequestScheduler::Get()
+{
+	return Instance.Get();
+}
+
+uint32 FDeepseekRequestScheduler::AllocateSessionId()
+{
+	static TAtomic<uint32> NextSessionId(1);
+	return NextSessionId++;
+}
+
+FDeepseekRequestScheduler::FDeepseekRequestScheduler()
+	: MaxConcurrent(4)
+	, NextTicket(1)
+	, bPumping(false)
+{
+}
+
+FDeepseekRequestScheduler::~FDeepseekRequestScheduler()
+{
+	if (WakeUpTimer.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(WakeUpTimer);
+	}
+}
+
+uint64 FDeepseekRequestScheduler::Enqueue(uint32 SessionId, EDeepseekRequestPriority Priority, int32 EstimatedTokens, TFunction<void()> Start)
+{
+	check(IsInGameThread());
+
+	FQueuedRequest& Request = Queue.AddDefaulted_GetRef();
+	Request.Ticket = NextTicket++;
+	Request.SessionId = SessionId;
+	Request.Priority = Priority;
+	Request.EstimatedTokens = EstimatedTokens;
+	Request.EnqueueTime = FPlatformTime::Seconds();
+	Request.Start = MoveTemp(Start);
+	Stats.MaxQueueDepth = FMath::Max(Stats.MaxQueueDepth, Queue.Num());
+
+	const uint64 Ticket = Request.Ticket;
+	Pump();
+	return Ticket;
+}
+
+void FDeepseekRequestScheduler::Finish(uint64 Ticket)
+{
+	check(IsInGameThread());
+
+	uint32 SessionId = 0;
+	if (Active.RemoveAndCopyValue(Ticket, SessionId))
+	{
+		BusySessions.Remove(SessionId);
+		Pump();
+	}
+}
+
+bool FDeepseekRequestScheduler::Cancel(uint64 Ticket)
+{
+	check(IsInGameThread());
+
+	const int32 Index = Queue.IndexOfByPredicate([Ticket](const FQueuedRequest& Request)
+	{
+		return Request.Ticket == Ticket;
+	});
+
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// 保持其余请求的先后顺序
+	Queue.RemoveAt(Index);
+	return true;
+}
+
+void FDeepseekRequestScheduler::SetMaxConcurrent(int32 InMaxConcurrent)
+{
+	MaxConcurrent = FMath::Max(1, InMaxConcurrent);
+	Pump();
+}
+
+void FDeepseekRequestScheduler::Pump()
+{
+	if (bPumping)
+	{
+		return;
+	}
+
+	TGuardValue<bool> PumpingGuard(bPumping, true);
+	while (Active.Num() < MaxConcurrent)
+	{
+		const int32 Index = SelectNext();
+		if (Index == INDEX_NONE)
+		{
+			break;
+		}
+
+		// 超出速率限制时整个队列等待，不让低优先级的小请求插到前面
+		const double RateLimitWait = RateLimiter.GetWaitSeconds(Queue[Index].EstimatedTokens);
+		if (RateLimitWait > 0.0)
+		{
+			ScheduleWakeUp(RateLimitWait);
+			break;
+		}
+
+		FQueuedRequest Request = MoveTemp(Queue[Index]);
+		Queue.RemoveAt(Index);
+
+		RateLimiter.Acquire(Request.EstimatedTokens);
+
+		const double WaitSeconds = FPlatformTime::Seconds() - Request.EnqueueTime;
+		++Stats.Started;
+		Stats.TotalWaitSeconds += WaitSeconds;
+		Stats.MaxWaitSeconds = FMath::Max(Stats.MaxWaitSeconds, WaitSeconds);
+
+		Active.Add(Request.Ticket, Request.SessionId);
+		if (Request.SessionId != 0)
+		{
+			BusySessions.Add(Request.SessionId);
+		}
+
+		Request.Start();
+	}
+
+	TRACE_COUNTER_SET(DeepseekQueueDepth, Queue.Num());
+	TRACE_COUNTER_SET(DeepseekActiveRequests, Active.Num());
+}
+
+void FDeepseekRequestScheduler::ScheduleWakeUp(double Seconds)
+{
+	// 已有定时器时等它到期再重新计算
+	if (WakeUpTimer.IsValid())
+	{
+		return;
+	}
+
+	++Stats.RateLimited;
+	WakeUpTimer = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this](float DeltaTime)
+	{
+		WakeUpTimer.Reset();
+		Pump();
+		return false;
+	}), static_cast<float>(Seconds));
+}
+
+int32 FDeepseekRequestScheduler::SelectNext() const
+{
+	// 每个会话只看排在最前面的请求，且该会话没有正在进行的请求
+	TSet<uint32, DefaultKeyFuncs<uint32>, TInlineSetAllocator<16>> SeenSessions;
+	int32 BestIndex = INDEX_NONE;
+	for (int32 Index = 0; Index < Queue.Num(); ++Index)
+	{
+		const FQueuedRequest& Request = Queue[Index];
+		if (Request.SessionId != 0)
+		{
+			bool bAlreadySeen = false;
+			SeenSessions.Add(Request.SessionId, &bAlreadySeen);
+			if (bAlreadySeen || BusySessions.Contains(Request.SessionId))
+			{
+				continue;
+			}
+		}
+
+		// 同优先级保留较早的请求
+		if (BestIndex == INDEX_NONE || Request.Priority > Queue[BestIndex].Priority)
+		{
+			BestIndex = Index;
+		}
+	}
+
+	return BestIndex;
+}
+
+static FAutoConsoleCommand DumpSchedulerCommand(
+	TEXT("Deepseek.Scheduler"),
+	TEXT("输出请求调度器的队列深度、排队时间与速率限制"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FDeepseekRequestScheduler* Scheduler = FDeepseekRequestScheduler::Get();
+		if (Scheduler == nullptr)
+		{
+			return;
+		}
+
+		const FDeepseekRequestScheduler::FStats& Stats = Scheduler->GetStats();
+		FDeepseekRateLimiter& RateLimiter = Scheduler->GetRateLimiter();
+		UE_LOG(LogDeepseek, Display, TEXT("进行中 %d/%d，排队 %d（最多 %d），已发出 %d，平均排队 %.0f ms，最长 %.0f ms，限流推迟 %d 次"),
+			Scheduler->GetNumActive(), Scheduler->GetMaxConcurrent(), Scheduler->GetNumQueued(), Stats.MaxQueueDepth, Stats.Started,
+			Stats.GetAverageWaitSeconds() * 1000.0, Stats.MaxWaitSeconds * 1000.0, Stats.RateLimited);
+		UE_LOG(LogDeepseek, Display, TEXT("速率限制：每秒 %.1f 个请求，每分钟 %d 个token（0表示不限制）"),
+			RateLimiter.GetRequestsPerSecond(), RateLimiter.GetTokensPerMinute());
+	}));
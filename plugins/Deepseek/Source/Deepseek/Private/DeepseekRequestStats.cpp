@@ -0,0 +1,217 @@
+#include "DeepseekRequestStats.h"
+#include "Deepseek.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CountersTrace.h"
+
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekQueueMs, TEXT("Deepseek/QueueMs"));
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekSerializeMs, TEXT("Deepseek/SerializeMs"));
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekConnectMs, TEXT("Deepseek/ConnectMs"));
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekFirstByteMs, TEXT("Deepseek/FirstByteMs"));
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekFirstTokenMs, TEXT("Deepseek/FirstTokenMs"));
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekDecodeMs, TEXT("Deepseek/DecodeMs"));
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekUIApplyMs, TEXT("Deepseek/UIApplyMs"));
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekTotalMs, TEXT("Deepseek/TotalMs"));
+TRACE_DECLARE_FLOAT_COUNTER(DeepseekTokensPerSecond, TEXT("Deepseek/TokensPerSecond"));
+
+TUniquePtr<FDeepseekRequestStats> FDeepseekRequestStats::Instance;
+
+double FDeepseekRequestSample::GetPhaseSeconds(EDeepseekRequestPhase Phase) const
+{
+	switch (Phase)
+	{
+	case EDeepseekRequestPhase::Queue:		return Timings.QueueSeconds;
+	case EDeepseekRequestPhase::Serialize:	return Timings.SerializeSeconds;
+	case EDeepseekRequestPhase::Connect:	return Timings.ConnectSeconds;
+	case EDeepseekRequestPhase::FirstByte:	return Timings.FirstByteSeconds;
+	case EDeepseekRequestPhase::FirstToken:	return Timings.FirstTokenSeconds;
+	case EDeepseekRequestPhase::Decode:		return Timings.DecodeSeconds;
+	case EDeepseekRequestPhase::UIApply:	return Timings.UIApplySeconds;
+	case EDeepseekRequestPhase::Total:		return Timings.TotalSeconds;
+	default:								return 0.0;
+	}
+}
+
+double FDeepseekRequestSample::GetTokensPerSecond() const
+{
+	// 非流式请求看不到生成过程，用服务端处理与传输的总时间
+	const double Seconds = bStream ? Timings.TransferSeconds : Timings.ServerSeconds + Timings.TransferSeconds;
+	return CompletionTokens > 0 && Seconds > 0.0 ? CompletionTokens / Seconds : 0.0;
+}
+
+void FDeepseekRequestStats::Initialize()
+{
+	if (!Instance.IsValid())
+	{
+		Instance.Reset(new FDeepseekRequestStats());
+	}
+}
+
+void FDeepseekRequestStats::Shutdown()
+{
+	Instance.Reset();
+}
+
+FDeepseekRequestStats* FDeepseekRequestStats::Get()
+{
+	return Instance.Get();
+}
+
+FDeepseekRequestStats::FDeepseekRequestStats()
+	: NextSample(0)
+	, Generation(0)
+{
+	Samples.Reserve(MaxSamples);
+}
+
+const TCHAR* FDeepseekRequestStats::GetPhaseName(EDeepseekRequestPhase Phase)
+{
+	switch (Phase)
+	{
+	case EDeepseekRequestPhase::Queue:		return TEXT("排队");
+	case EDeepseekRequestPhase::Serialize:	return TEXT("序列化");
+	case EDeepseekRequestPhase::Connect:	return TEXT("连接");
+	case EDeepseekRequestPhase::FirstByte:	return TEXT("首字节");
+	case EDeepseekRequestPhase::FirstToken:	return TEXT("首token");
+	case EDeepseekRequestPhase::Decode:		return TEXT("解码");
+	case EDeepseekRequestPhase::UIApply:	return TEXT("界面");
+	case EDeepseekRequestPhase::Total:		return TEXT("总计");
+	default:								return TEXT("");
+	}
+}
+
+void FDeepseekRequestStats::AddSample(const FDeepseekRequestSample& Sample)
+{
+	check(IsInGameThread());
+
+	if (Samples.Num() < MaxSamples)
+	{
+		Samples.Add(Sample);
+	}
+	else
+	{
+		Samples[NextSample] = Sample;
+	}
+	NextSample = (NextSample + 1) % MaxSamples;
+	++Generation;
+
+	const FDeepseekRequestTimings& Timings = Sample.Timings;
+	TRACE_COUNTER_SET(DeepseekQueueMs, Timings.QueueSeconds * 1000.0);
+	TRACE_COUNTER_SET(DeepseekSerializeMs, Timings.SerializeSeconds * 1000.0);
+	TRACE_COUNTER_SET(DeepseekConnectMs, Timings.ConnectSeconds * 1000.0);
+	TRACE_COUNTER_SET(DeepseekFirstByteMs, Timings.FirstByteSeconds * 1000.0);
+	TRACE_COUNTER_SET(DeepseekFirstTokenMs, Timings.FirstTokenSeconds * 1000.0);
+	TRACE_COUNTER_SET(DeepseekDecodeMs, Timings.DecodeSeconds * 1000.0);
+	TRACE_COUNTER_SET(DeepseekUIApplyMs, Timings.UIApplySeconds * 1000.0);
+	TRACE_COUNTER_SET(DeepseekTotalMs, Timings.TotalSeconds * 1000.0);
+	TRACE_COUNTER_SET(DeepseekTokensPerSecond, Sample.GetTokensPerSecond());
+}
+
+template <typename GetterType>
+FDeepseekRequestStats::FPercentiles FDeepseekRequestStats::ComputePercentiles(GetterType&& Getter) const
+{
+	TArray<double> Values;
+	Values.Reserve(Samples.Num());
+	for (const FDeepseekRequestSample& Sample : Samples)
+	{
+		if (Sample.bSuccess)
+		{
+			Values.Add(Getter(Sample));
+		}
+	}
+
+	FPercentiles Result;
+	if (Values.Num() == 0)
+	{
+		return Result;
+	}
+
+	Values.Sort();
+	auto At = [&Values](double Percentile)
+	{
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Values.Num() * Percentile) - 1, 0, Values.Num() - 1);
+		return Values[Index];
+	};
+	Result.P50 = At(0.50);
+	Result.P95 = At(0.95);
+	Result.P99 = At(0.99);
+	return Result;
+}
+
+FDeepseekRequestStats::FPercentiles FDeepseekRequestStats::GetPhasePercentiles(EDeepseekRequestPhase Phase) const
+{
+	return ComputePercentiles([Phase](const FDeepseekRequestSample& Sample) { return Sample.GetPhaseSeconds(Phase); });
+}
+
+FDeepseekRequestStats::FPercentiles FDeepseekRequestStats::GetTokensPerSecondPercentiles() const
+{
+	return ComputePercentiles([](const FDeepseekRequestSample& Sample) { return Sample.GetTokensPerSecond(); });
+}
+
+void FDeepseekRequestStats::Reset()
+{
+	Samples.Reset();
+	NextSample = 0;
+	++Generation;
+}
+
+/** CSV列名，与EDeepseekRequestPhase的顺序一致 */
+static const TCHAR* PhaseColumnNames[] =
+{
+	TEXT("Queue"), TEXT("Serialize"), TEXT("Connect"), TEXT("FirstByte"), TEXT("FirstToken"), TEXT("Decode"), TEXT("UIApply"), TEXT("Total"),
+};
+static_assert(UE_ARRAY_COUNT(PhaseColumnNames) == static_cast<int32>(EDeepseekRequestPhase::Num), "每个阶段都需要列名");
+
+bool FDeepseekRequestStats::ExportCsv(const FString& FilePath) const
+{
+	FString Csv = TEXT("Time,Model,Stream,Success,Retries");
+	for (int32 Phase = 0; Phase < static_cast<int32>(EDeepseekRequestPhase::Num); ++Phase)
+	{
+		Csv += FString::Printf(TEXT(",%sMs"), PhaseColumnNames[Phase]);
+	}
+	Csv += TEXT(",ServerMs,TransferMs,PromptTokens,CompletionTokens,TokensPerSecond\n");
+
+	ForEachSample([&Csv](const FDeepseekRequestSample& Sample)
+	{
+		Csv += FString::Printf(TEXT("%s,%s,%d,%d,%d"), *Sample.Time.ToIso8601(), *Sample.Model,
+			Sample.bStream ? 1 : 0, Sample.bSuccess ? 1 : 0, Sample.Timings.Retries);
+		for (int32 Phase = 0; Phase < static_cast<int32>(EDeepseekRequestPhase::Num); ++Phase)
+		{
+			Csv += FString::Printf(TEXT(",%.1f"), Sample.GetPhaseSeconds(static_cast<EDeepseekRequestPhase>(Phase)) * 1000.0);
+		}
+		Csv += FString::Printf(TEXT(",%.1f,%.1f,%d,%d,%.1f\n"), Sample.Timings.ServerSeconds * 1000.0, Sample.Timings.TransferSeconds * 1000.0,
+			Sample.PromptTokens, Sample.CompletionTokens, Sample.GetTokensPerSecond());
+	});
+
+	return FFileHelper::SaveStringToFile(Csv, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8);
+}
+
+FString FDeepseekRequestStats::GetDefaultExportPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Deepseek") / FString::Printf(TEXT("RequestStats-%s.csv"), *FDateTime::Now().ToString());
+}
+
+static void ExportRequestStats(const TArray<FString>& Args)
+{
+	FDeepseekRequestStats* Stats = FDeepseekRequestStats::Get();
+	if (Stats == nullptr)
+	{
+		return;
+	}
+
+	const FString FilePath = Args.Num() > 0 ? Args[0] : FDeepseekRequestStats::GetDefaultExportPath();
+	if (Stats->ExportCsv(FilePath))
+	{
+		UE_LOG(LogDeepseek, Display, TEXT("已导出 %d 条请求记录到 %s"), Stats->GetNumSamples(), *FilePath);
+	}
+	else
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("导出请求记录失败: %s"), *FilePath);
+	}
+}
+
+static FAutoConsoleCommand ExportRequestStatsCommand(
+	TEXT("Deepseek.ExportStats"),
+	TEXT("把最近的请求耗时记录导出为CSV。用法: Deepseek.ExportStats [文件路径]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&ExportRequestStats));
@@ -0,0 +1,330 @@
+#include "DeepseekResponseCache.h"
+#include "Deepseek.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+TUniquePtr<FDeepseekResponseCache> FDeepseekResponseCache::Instance;
+
+namespace DeepseekResponseCacheFormat
+{
+	/** 索引文件标识 'DSRC' */
+	static const uint32 Magic = 0x43525344;
+	static const uint32 Version = 1;
+
+	/** 文件头：标识、版本、条目数、保留 */
+	static const int32 HeaderSize = 16;
+
+	/** 条目：SHA1、内容大小、最近访问时间 */
+	static const int32 RecordSize = 32;
+
+	/** 累计这么多次写入后写回索引 */
+	static const int32 StoresPerSave = 8;
+}
+
+void FDeepseekResponseCache::Initialize()
+{
+	if (!Instance.IsValid())
+	{
+		Instance.Reset(new FDeepseekResponseCache(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Deepseek"), TEXT("ResponseCache"))));
+	}
+}
+
+void FDeepseekResponseCache::Shutdown()
+{
+	if (Instance.IsValid())
+	{
+		Instance->SaveIndex();
+		Instance.Reset();
+	}
+}
+
+FDeepseekResponseCache* FDeepseekResponseCache::Get()
+{
+	return Instance.Get();
+}
+
+FDeepseekResponseCache::FDeepseekResponseCache(const FString& InCacheDir)
+	: CacheDir(InCacheDir)
+	, MaxTotalBytes(256ll * 1024 * 1024)
+	, MaxEntries(20000)
+	, bIndexDirty(false)
+	, bSimilarIndexDirty(false)
+	, StoresSinceSave(0)
+{
+	IFileManager::Get().MakeDirectory(*CacheDir, true);
+	LoadIndex();
+	SimilarIndex.Load(GetSimilarIndexPath());
+}
+
+FSHAHash FDeepseekResponseCache::MakeKey(const FString& Model, const FString& ApiUrl, double Temperature, const TArray<uint8>& SerializedMessages)
+{
+	const FString HeaderFields[] = { Model, ApiUrl, FString::SanitizeFloat(Temperature) };
+	return HashRequest(HeaderFields, SerializedMessages);
+}
+
+FSHAHash FDeepseekResponseCache::HashRequest(TArrayView<const FString> HeaderFields, TArrayView<const uint8> Body)
+{
+	FSHA1 Hasher;
+
+	// 字段中不会出现换行，以换行分隔；字段与请求体之间再以一个0字节分隔，避免拼接产生歧义
+	const FString Header = FString::Join(HeaderFields, TEXT("\n"));
+	FTCHARToUTF8 HeaderUtf8(*Header);
+	const uint8 Separator = 0;
+	Hasher.Update(reinterpret_cast<const uint8*>(HeaderUtf8.Get()), HeaderUtf8.Length());
+	Hasher.Update(&Separator, 1);
+	Hasher.Update(Body.GetData(), Body.Num());
+	Hasher.Final();
+
+	FSHAHash Key;
+	Hasher.GetHash(Key.Hash);
+	return Key;
+}
+
+bool FDeepseekResponseCache::Lookup(const FSHAHash& Key, FString& OutContent)
+{
+	FEntry* Entry = Entries.Find(Key);
+	if (Entry == nullptr || !FFileHelper::LoadFileToString(OutContent, *GetBlobPath(Key)))
+	{
+		// 索引中有记录但文件已丢失时一并移除
+		if (Entry != nullptr)
+		{
+			RemoveEntry(Key);
+		}
+		++Stats.Misses;
+		return false;
+	}
+
+	Entry->LastAccessTicks = FDateTime::UtcNow().GetTicks();
+	bIndexDirty = true;
+	++Stats.Hits;
+	return true;
+}
+
+void FDeepseekResponseCache::Store(const FSHAHash& Key, const FString& Content)
+{
+	const FString BlobPath = GetBlobPath(Key);
+	if (!FFileHelper::SaveStringToFile(Content, *BlobPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("无法写入响应缓存: %s"), *BlobPath);
+		return;
+	}
+
+	FEntry& Entry = Entries.FindOrAdd(Key);
+	Stats.TotalBytes -= Entry.Size;
+	Entry.Size = static_cast<uint32>(FMath::Max<int64>(0, IFileManager::Get().FileSize(*BlobPath)));
+	Entry.LastAccessTicks = FDateTime::UtcNow().GetTicks();
+	Stats.TotalBytes += Entry.Size;
+	Stats.NumEntries = Entries.Num();
+	bIndexDirty = true;
+
+	EvictIfNeeded();
+
+	if (++StoresSinceSave >= DeepseekResponseCacheFormat::StoresPerSave)
+	{
+		SaveIndex();
+	}
+}
+
+void FDeepseekResponseCache::AddSimilar(const FDeepseekPromptSignature& Signature, const FSHAHash& Key)
+{
+	if (Entries.Contains(Key))
+	{
+		SimilarIndex.Add(Signature, Key);
+		bSimilarIndexDirty = true;
+	}
+}
+
+bool FDeepseekResponseCache::LookupSimilar(const FDeepseekPromptSignature& Signature, FString& OutContent, int32& OutDistance)
+{
+	FSHAHash Key;
+	if (!SimilarIndex.FindNearest(Signature, FDeepseekSimilarPromptIndex::DefaultMaxDistance, Key, OutDistance))
+	{
+		return false;
+	}
+
+	// 被淘汰的回复在近似索引中留有签名，找不到内容时视为未命中
+	FEntry* Entry = Entries.Find(Key);
+	if (Entry == nullptr || !FFileHelper::LoadFileToString(OutContent, *GetBlobPath(Key)))
+	{
+		return false;
+	}
+
+	Entry->LastAccessTicks = FDateTime::UtcNow().GetTicks();
+	bIndexDirty = true;
+	++Stats.SimilarHits;
+	return true;
+}
+
+void FDeepseekResponseCache::Clear()
+{
+	IFileManager::Get().DeleteDirectory(*CacheDir, false, true);
+	IFileManager::Get().MakeDirectory(*CacheDir, true);
+
+	Entries.Reset();
+	SimilarIndex.Reset();
+	Stats = FStats();
+	bIndexDirty = false;
+	bSimilarIndexDirty = false;
+	StoresSinceSave = 0;
+}
+
+void FDeepseekResponseCache::SetLimits(int64 InMaxTotalBytes, int32 InMaxEntries)
+{
+	MaxTotalBytes = FMath::Max<int64>(0, InMaxTotalBytes);
+	MaxEntries = FMath::Max(0, InMaxEntries);
+	EvictIfNeeded();
+}
+
+void FDeepseekResponseCache::LoadIndex()
+{
+	using namespace DeepseekResponseCacheFormat;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString IndexPath = GetIndexPath();
+	if (!PlatformFile.FileExists(*IndexPath))
+	{
+		return;
+	}
+
+	// 索引直接映射到内存中读取，不经过额外的读缓冲
+	TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*IndexPath));
+	if (!MappedFile.IsValid() || MappedFile->GetFileSize() < HeaderSize)
+	{
+		return;
+	}
+
+	TUniquePtr<IMappedFileRegion> Region(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	if (!Region.IsValid())
+	{
+		return;
+	}
+
+	const uint8* Data = Region->GetMappedPtr();
+	const int64 Size = Region->GetMappedSize();
+
+	uint32 Header[4];
+	FMemory::Memcpy(Header, Data, HeaderSize);
+	if (Header[0] != Magic || Header[1] != Version)
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("响应缓存索引版本不匹配，已忽略"));
+		return;
+	}
+
+	const int64 NumRecords = FMath::Min<int64>(Header[2], (Size - HeaderSize) / RecordSize);
+	Entries.Reserve(NumRecords);
+	for (int64 RecordIndex = 0; RecordIndex < NumRecords; ++RecordIndex)
+	{
+		const uint8* Record = Data + HeaderSize + RecordIndex * RecordSize;
+
+		FSHAHash Key;
+		FMemory::Memcpy(Key.Hash, Record, sizeof(Key.Hash));
+
+		FEntry Entry;
+		FMemory::Memcpy(&Entry.Size, Record + 20, sizeof(Entry.Size));
+		FMemory::Memcpy(&Entry.LastAccessTicks, Record + 24, sizeof(Entry.LastAccessTicks));
+
+		Entries.Add(Key, Entry);
+		Stats.TotalBytes += Entry.Size;
+	}
+	Stats.NumEntries = Entries.Num();
+}
+
+void FDeepseekResponseCache::SaveIndex()
+{
+	using namespace DeepseekResponseCacheFormat;
+
+	if (bSimilarIndexDirty && SimilarIndex.Save(GetSimilarIndexPath()))
+	{
+		bSimilarIndexDirty = false;
+	}
+
+	if (!bIndexDirty)
+	{
+		return;
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(HeaderSize + Entries.Num() * RecordSize);
+
+	const uint32 Header[4] = { Magic, Version, static_cast<uint32>(Entries.Num()), 0 };
+	FMemory::Memcpy(Buffer.GetData(), Header, HeaderSize);
+
+	uint8* Record = Buffer.GetData() + HeaderSize;
+	for (const TPair<FSHAHash, FEntry>& Pair : Entries)
+	{
+		FMemory::Memcpy(Record, Pair.Key.Hash, sizeof(Pair.Key.Hash));
+		FMemory::Memcpy(Record + 20, &Pair.Value.Size, sizeof(Pair.Value.Size));
+		FMemory::Memcpy(Record + 24, &Pair.Value.LastAccessTicks, sizeof(Pair.Value.LastAccessTicks));
+		Record += RecordSize;
+	}
+
+	// 先写临时文件再替换，避免中途退出留下损坏的索引
+	const FString IndexPath = GetIndexPath();
+	const FString TempPath = IndexPath + TEXT(".tmp");
+	if (FFileHelper::SaveArrayToFile(Buffer, *TempPath) && IFileManager::Get().Move(*IndexPath, *TempPath, true, true))
+	{
+		bIndexDirty = false;
+		StoresSinceSave = 0;
+	}
+}
+
+void FDeepseekResponseCache::EvictIfNeeded()
+{
+	if (Stats.TotalBytes <= MaxTotalBytes && Entries.Num() <= MaxEntries)
+	{
+		return;
+	}
+
+	// 一次淘汰到上限的90%，避免每次写入都排序
+	TArray<TPair<int64, FSHAHash>> ByAccess;
+	ByAccess.Reserve(Entries.Num());
+	for (const TPair<FSHAHash, FEntry>& Pair : Entries)
+	{
+		ByAccess.Emplace(Pair.Value.LastAccessTicks, Pair.Key);
+	}
+	ByAccess.Sort([](const TPair<int64, FSHAHash>& A, const TPair<int64, FSHAHash>& B)
+	{
+		return A.Key < B.Key;
+	});
+
+	const int64 TargetBytes = MaxTotalBytes * 9 / 10;
+	const int32 TargetEntries = MaxEntries * 9 / 10;
+	for (const TPair<int64, FSHAHash>& Oldest : ByAccess)
+	{
+		if (Stats.TotalBytes <= TargetBytes && Entries.Num() <= TargetEntries)
+		{
+			break;
+		}
+		RemoveEntry(Oldest.Value);
+	}
+}
+
+void FDeepseekResponseCache::RemoveEntry(const FSHAHash& Key)
+{
+	FEntry Entry;
+	if (Entries.RemoveAndCopyValue(Key, Entry))
+	{
+		Stats.TotalBytes -= Entry.Size;
+		Stats.NumEntries = Entries.Num();
+		bIndexDirty = true;
+		IFileManager::Get().Delete(*GetBlobPath(Key), false, true, true);
+	}
+}
+
+FString FDeepseekResponseCache::GetBlobPath(const FSHAHash& Key) const
+{
+	return FPaths::Combine(CacheDir, Key.ToString() + TEXT(".txt"));
+}
+
+FString FDeepseekResponseCache::GetIndexPath() const
+{
+	return FPaths::Combine(CacheDir, TEXT("index.bin"));
+}
+
+FString FDeepseekResponseCache::GetSimilarIndexPath() const
+{
+	return FPaths::Combine(CacheDir, TEXT("similar.bin"));
+}
@@ -0,0 +1,226 @@
+#include "DeepseekResponseDecoder.h"
+#include "DeepseekOpenAIService.h"
+#include "Serialization/JsonReader.h"
+
+bool FDeepseekResponseDecoder::DecodeResponse(FString&& ResponseString, FOpenAIResponse& OutResponse)
+{
+	TSharedRef<TJsonReader<TCHAR>> Reader = TJsonReaderFactory<TCHAR>::Create(MoveTemp(ResponseString));
+	return ReadResponse(*Reader, OutResponse);
+}
+
+bool FDeepseekResponseDecoder::DecodeStreamChunk(const FString& EventData, FOpenAIResponse& OutChunk)
+{
+	TSharedRef<TJsonReader<TCHAR>> Reader = TJsonReaderFactory<TCHAR>::Create(EventData);
+	return ReadResponse(*Reader, OutChunk);
+}
+
+bool FDeepseekResponseDecoder::ReadResponse(TJsonReader<TCHAR>& Reader, FOpenAIResponse& OutResponse)
+{
+	EJsonNotation Notation;
+	if (!Reader.ReadNext(Notation) || Notation != EJsonNotation::ObjectStart)
+	{
+		return false;
+	}
+
+	while (Reader.ReadNext(Notation))
+	{
+		if (Notation == EJsonNotation::ObjectEnd)
+		{
+			return true;
+		}
+
+		const FString& Key = Reader.GetIdentifier();
+		if (Notation == EJsonNotation::String)
+		{
+			if (Key == TEXT("id"))
+			{
+				OutResponse.Id = Reader.GetValueAsString();
+			}
+			else if (Key == TEXT("object"))
+			{
+				OutResponse.Object = Reader.GetValueAsString();
+			}
+			else if (Key == TEXT("model"))
+			{
+				OutResponse.Model = Reader.GetValueAsString();
+			}
+		}
+		else if (Notation == EJsonNotation::Number && Key == TEXT("created"))
+		{
+			OutResponse.Created = static_cast<int32>(Reader.GetValueAsNumber());
+		}
+		else if (Notation == EJsonNotation::ArrayStart && Key == TEXT("choices"))
+		{
+			if (!ReadChoices(Reader, OutResponse.Choices))
+			{
+				return false;
+			}
+		}
+		else if (Notation == EJsonNotation::ObjectStart && Key == TEXT("usage"))
+		{
+			if (!ReadUsage(Reader, OutResponse.Usage))
+			{
+				return false;
+			}
+		}
+		else if (!SkipValue(Reader, Notation))
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool FDeepseekResponseDecoder::ReadChoices(TJsonReader<TCHAR>& Reader, TArray<FOpenAIChoice>& OutChoices)
+{
+	EJsonNotation Notation;
+	while (Reader.ReadNext(Notation))
+	{
+		if (Notation == EJsonNotation::ArrayEnd)
+		{
+			return true;
+		}
+
+		if (Notation == EJsonNotation::ObjectStart)
+		{
+			if (!ReadChoice(Reader, OutChoices.AddDefaulted_GetRef()))
+			{
+				return false;
+			}
+		}
+		else if (!SkipValue(Reader, Notation))
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool FDeepseekResponseDecoder::ReadChoice(TJsonReader<TCHAR>& Reader, FOpenAIChoice& OutChoice)
+{
+	EJsonNotation Notation;
+	while (Reader.ReadNext(Notation))
+	{
+		if (Notation == EJsonNotation::ObjectEnd)
+		{
+			return true;
+		}
+
+		const FString& Key = Reader.GetIdentifier();
+		if (Notation == EJsonNotation::ObjectStart && (Key == TEXT("message") || Key == TEXT("delta")))
+		{
+			if (!ReadMessage(Reader, OutChoice))
+			{
+				return false;
+			}
+		}
+		else if (Notation == EJsonNotation::String && Key == TEXT("finish_reason"))
+		{
+			OutChoice.FinishReason = Reader.GetValueAsString();
+		}
+		else if (Notation == EJsonNotation::Number && Key == TEXT("index"))
+		{
+			OutChoice.Index = static_cast<int32>(Reader.GetValueAsNumber());
+		}
+		else if (!SkipValue(Reader, Notation))
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool FDeepseekResponseDecoder::ReadMessage(TJsonReader<TCHAR>& Reader, FOpenAIChoice& OutChoice)
+{
+	EJsonNotation Notation;
+	while (Reader.ReadNext(Notation))
+	{
+		if (Notation == EJsonNotation::ObjectEnd)
+		{
+			return true;
+		}
+
+		const FString& Key = Reader.GetIdentifier();
+		if (Notation == EJsonNotation::String)
+		{
+			// 内容只从读取器拷贝这一次，之后沿调用链移动
+			if (Key == TEXT("content"))
+			{
+				OutChoice.Message.Content = Reader.GetValueAsString();
+			}
+			else if (Key == TEXT("role"))
+			{
+				OutChoice.Message.Role = Reader.GetValueAsString();
+			}
+		}
+		else if (!SkipValue(Reader, Notation))
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool FDeepseekResponseDecoder::ReadUsage(TJsonReader<TCHAR>& Reader, FOpenAIUsage& OutUsage)
+{
+	EJsonNotation Notation;
+	while (Reader.ReadNext(Notation))
+	{
+		if (Notation == EJsonNotation::ObjectEnd)
+		{
+			return true;
+		}
+
+		const FString& Key = Reader.GetIdentifier();
+		if (Notation == EJsonNotation::Number)
+		{
+			const int32 Value = static_cast<int32>(Reader.GetValueAsNumber());
+			if (Key == TEXT("prompt_tokens"))
+			{
+				OutUsage.PromptTokens = Value;
+			}
+			else if (Key == TEXT("completion_tokens"))
+			{
+				OutUsage.CompletionTokens = Value;
+			}
+			else if (Key == TEXT("total_tokens"))
+			{
+				OutUsage.TotalTokens = Value;
+			}
+			else if (Key == TEXT("prompt_cache_hit_tokens"))
+			{
+				OutUsage.PromptCacheHitTokens = Value;
+			}
+			else if (Key == TEXT("prompt_cache_miss_tokens"))
+			{
+				OutUsage.PromptCacheMissTokens = Value;
+			}
+		}
+		else if (!SkipValue(Reader, Notation))
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool FDeepseekResponseDecoder::SkipValue(TJsonReader<TCHAR>& Reader, EJsonNotation Notation)
+{
+	switch (Notation)
+	{
+	case EJsonNotation::ObjectStart:
+		return Reader.SkipObject();
+	case EJsonNotation::ArrayStart:
+		return Reader.SkipArray();
+	case EJsonNotation::Error:
+		return false;
+	default:
+		// 标量值（包括null）已经被读取完毕
+		return true;
+	}
+}
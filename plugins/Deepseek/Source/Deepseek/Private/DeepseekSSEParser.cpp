@@ -0,0 +1,114 @@
+#include "DeepseekSSEParser.h"
+
+FDeepseekSSEParser::FDeepseekSSEParser()
+	: bHasEventData(false)
+	, bDone(false)
+{
+}
+
+void FDeepseekSSEParser::Reset()
+{
+	PendingBytes.Reset();
+	EventData.Reset();
+	bHasEventData = false;
+	bDone = false;
+}
+
+void FDeepseekSSEParser::Feed(const uint8* Data, int32 Num, TArray<FString>& OutEvents)
+{
+	if (bDone || Num <= 0)
+	{
+		return;
+	}
+
+	PendingBytes.Append(Data, Num);
+
+	// 换行符是ASCII字符，按字节切分不会截断UTF-8多字节序列
+	int32 LineStart = 0;
+	for (int32 Index = 0; Index < PendingBytes.Num() && !bDone; ++Index)
+	{
+		if (PendingBytes[Index] != '\n')
+		{
+			continue;
+		}
+
+		int32 LineLen = Index - LineStart;
+		if (LineLen > 0 && PendingBytes[LineStart + LineLen - 1] == '\r')
+		{
+			--LineLen;
+		}
+
+		ProcessLine(PendingBytes.GetData() + LineStart, LineLen, OutEvents);
+		LineStart = Index + 1;
+	}
+
+	// 只保留不完整的行，等待下一块数据
+	if (bDone)
+	{
+		PendingBytes.Reset();
+	}
+	else if (LineStart > 0)
+	{
+		PendingBytes.RemoveAt(0, LineStart, false);
+	}
+}
+
+void FDeepseekSSEParser::ProcessLine(const uint8* Line, int32 Len, TArray<FString>& OutEvents)
+{
+	// 空行表示事件结束
+	if (Len == 0)
+	{
+		DispatchEvent(OutEvents);
+		return;
+	}
+
+	// 以冒号开头的是注释（如服务端的keep-alive心跳）
+	if (Line[0] == ':')
+	{
+		return;
+	}
+
+	static const uint8 DataField[] = { 'd', 'a', 't', 'a', ':' };
+	const int32 DataFieldLen = UE_ARRAY_COUNT(DataField);
+	if (Len < DataFieldLen || FMemory::Memcmp(Line, DataField, DataFieldLen) != 0)
+	{
+		// 只关心data字段，event/id/retry忽略
+		return;
+	}
+
+	int32 ValueStart = DataFieldLen;
+	if (ValueStart < Len && Line[ValueStart] == ' ')
+	{
+		++ValueStart;
+	}
+
+	// 同一事件的多个data行以换行连接
+	if (bHasEventData)
+	{
+		EventData.Add('\n');
+	}
+	EventData.Append(Line + ValueStart, Len - ValueStart);
+	bHasEventData = true;
+}
+
+void FDeepseekSSEParser::DispatchEvent(TArray<FString>& OutEvents)
+{
+	if (!bHasEventData)
+	{
+		return;
+	}
+
+	FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(EventData.GetData()), EventData.Num());
+	FString Event(Converter.Length(), Converter.Get());
+
+	EventData.Reset();
+	bHasEventData = false;
+
+	if (Event == TEXT("[DONE]"))
+	{
+		bDone = true;
+		return;
+	}
+
+	OutEvents.Add(MoveTemp(Event));
+}
@@ -0,0 +1,509 @@
+#include "DeepseekSessionLog.h"
+#include "Deepseek.h"
+#include "Async/Async.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Memory/MemoryView.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace DeepseekSessionLogFormat
+{
+	/** 日志文件标识 'DSSL' 与索引文件标识 'DSSI' */
+	static const uint32 LogMagic = 0x4C535344;
+	static const uint32 IndexMagic = 0x49535344;
+	static const uint32 Version = 1;
+
+	/** 文件头：标识、版本 */
+	static const int32 HeaderSize = 8;
+
+	/** 记录头：uint32负载大小，uint8记录类型 */
+	static const int32 RecordHeaderSize = 5;
+
+	/** 记录类型 */
+	enum ERecordType : uint8
+	{
+		/** 消息：uint8角色，发送者，内容 */
+		Message = 0,
+
+		/** 清空聊天记录，无负载 */
+		Clear = 1,
+	};
+
+	/** 已清空的记录至少这么大且占日志一半以上时才压缩 */
+	static const int64 MinCompactBytes = 64 * 1024;
+
+	static FString GetSessionDir()
+	{
+		return FPaths::ProjectSavedDir() / TEXT("Deepseek") / TEXT("Sessions");
+	}
+
+	static TArray<uint8> MakeHeader(uint32 Magic)
+	{
+		TArray<uint8> Bytes;
+		FMemoryWriter Writer(Bytes);
+		uint32 HeaderMagic = Magic;
+		uint32 HeaderVersion = Version;
+		Writer << HeaderMagic << HeaderVersion;
+		return Bytes;
+	}
+
+	static bool CheckHeader(TArrayView<const uint8> Bytes, uint32 Magic)
+	{
+		if (Bytes.Num() < HeaderSize)
+		{
+			return false;
+		}
+
+		uint32 Header[2];
+		FMemory::Memcpy(Header, Bytes.GetData(), HeaderSize);
+		return Header[0] == Magic && Header[1] == Version;
+	}
+
+	static bool AppendToFile(const FString& Path, const TArray<uint8>& Bytes)
+	{
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Path, FILEWRITE_Append | FILEWRITE_AllowRead));
+		if (!Writer.IsValid())
+		{
+			return false;
+		}
+
+		Writer->Serialize(const_cast<uint8*>(Bytes.GetData()), Bytes.Num());
+		return Writer->Close();
+	}
+}
+
+TSharedRef<FDeepseekSessionLog, ESPMode::ThreadSafe> FDeepseekSessionLog::Create(const FString& LogPath)
+{
+	FString Path = LogPath;
+	if (Path.IsEmpty())
+	{
+		// 文件名以创建时间开头，按文件名排序即为创建顺序
+		Path = DeepseekSessionLogFormat::GetSessionDir() / FString::Printf(TEXT("%s-%s.dslog"),
+			*FDateTime::UtcNow().ToString(TEXT("%Y%m%d-%H%M%S")), *FGuid::NewGuid().ToString(EGuidFormats::Digits).Left(8));
+	}
+
+	return MakeShareable(new FDeepseekSessionLog(Path));
+}
+
+TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> FDeepseekSessionLog::Open(const FString& LogPath)
+{
+	TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = MakeShareable(new FDeepseekSessionLog(LogPath));
+	if (!Log->Load())
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("无法读取会话记录 %s"), *LogPath);
+		return nullptr;
+	}
+	return Log;
+}
+
+TArray<FString> FDeepseekSessionLog::FindLogs()
+{
+	const FString SessionDir = DeepseekSessionLogFormat::GetSessionDir();
+
+	TArray<FString> FileNames;
+	IFileManager::Get().FindFiles(FileNames, *(SessionDir / TEXT("*.dslog")), true, false);
+	FileNames.Sort();
+
+	TArray<FString> Paths;
+	Paths.Reserve(FileNames.Num());
+	for (const FString& FileName : FileNames)
+	{
+		Paths.Add(SessionDir / FileName);
+	}
+	return Paths;
+}
+
+FDeepseekSessionLog::FDeepseekSessionLog(const FString& InLogPath)
+	: LogPath(InLogPath)
+	, IndexPath(FPaths::ChangeExtension(InLogPath, TEXT("dsidx")))
+	, FirstLive(0)
+	, LogSize(0)
+	, bCompacting(false)
+	, bDeleted(false)
+{
+}
+
+bool FDeepseekSessionLog::Load()
+{
+	using namespace DeepseekSessionLogFormat;
+
+	LogSize = IFileManager::Get().FileSize(*LogPath);
+	if (LogSize < HeaderSize)
+	{
+		return false;
+	}
+
+	bool bValidLog = false;
+	ReadRegion(0, HeaderSize, [&bValidLog](TArrayView<const uint8> Bytes)
+	{
+		bValidLog = CheckHeader(Bytes, LogMagic);
+		return true;
+	});
+	if (!bValidLog)
+	{
+		return false;
+	}
+
+	// 索引每项8字节，即使有几十万条消息也只有几MB，整体读入
+	TArray<uint8> IndexBytes;
+	if (FFileHelper::LoadFileToArray(IndexBytes, *IndexPath, FILEREAD_Silent) && CheckHeader(IndexBytes, IndexMagic))
+	{
+		const int32 NumEntries = (IndexBytes.Num() - HeaderSize) / sizeof(uint64);
+		Entries.SetNumUninitialized(NumEntries);
+		FMemory::Memcpy(Entries.GetData(), IndexBytes.GetData() + HeaderSize, NumEntries * sizeof(uint64));
+	}
+
+	// 最后一条记录必须恰好结束在日志末尾，否则写入中途退出过，以日志为准重建索引
+	bool bIndexValid = Entries.Num() == 0 && LogSize == HeaderSize;
+	if (Entries.Num() > 0)
+	{
+		const int64 LastOffset = GetOffset(Entries.Last());
+		if (LastOffset >= HeaderSize && LastOffset + RecordHeaderSize <= LogSize)
+		{
+			ReadRegion(LastOffset, RecordHeaderSize, [this, LastOffset, &bIndexValid](TArrayView<const uint8> Bytes)
+			{
+				uint32 PayloadSize = 0;
+				FMemory::Memcpy(&PayloadSize, Bytes.GetData(), sizeof(uint32));
+				bIndexValid = Bytes[4] == GetType(Entries.Last()) && LastOffset + RecordHeaderSize + PayloadSize == LogSize;
+				return true;
+			});
+		}
+	}
+
+	if (!bIndexValid && !RebuildIndex())
+	{
+		return false;
+	}
+
+	// 当前消息从最后一条清空记录之后开始
+	FirstLive = 0;
+	for (int32 Index = Entries.Num() - 1; Index >= 0; --Index)
+	{
+		if (GetType(Entries[Index]) == Clear)
+		{
+			FirstLive = Index + 1;
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool FDeepseekSessionLog::RebuildIndex()
+{
+	using namespace DeepseekSessionLogFormat;
+
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*LogPath, FILEREAD_Silent));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	// 只读记录头，跳过负载
+	Entries.Reset();
+	int64 ValidSize = HeaderSize;
+	while (ValidSize + RecordHeaderSize <= LogSize)
+	{
+		uint32 PayloadSize = 0;
+		uint8 Type = 0;
+		Reader->Seek(ValidSize);
+		*Reader << PayloadSize << Type;
+		if (Reader->IsError() || Type > Clear || ValidSize + RecordHeaderSize + PayloadSize > LogSize)
+		{
+			break;
+		}
+
+		Entries.Add(MakeEntry(ValidSize, Type));
+		ValidSize += RecordHeaderSize + PayloadSize;
+	}
+	Reader.Reset();
+
+	// 写入中途退出会留下半条记录，截掉后再追加
+	if (ValidSize < LogSize)
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("会话记录 %s 末尾有 %lld 字节不完整的记录，已截掉"), *LogPath, LogSize - ValidSize);
+		TUniquePtr<IFileHandle> Handle(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*LogPath, true, true));
+		if (!Handle.IsValid() || !Handle->Truncate(ValidSize))
+		{
+			return false;
+		}
+		LogSize = ValidSize;
+	}
+
+	UE_LOG(LogDeepseek, Log, TEXT("重建会话记录索引 %s：%d 条记录"), *LogPath, Entries.Num());
+	return SaveIndex(IndexPath, Entries);
+}
+
+bool FDeepseekSessionLog::SaveIndex(const FString& Path, const TArray<uint64>& InEntries) const
+{
+	TArray<uint8> Bytes = DeepseekSessionLogFormat::MakeHeader(DeepseekSessionLogFormat::IndexMagic);
+	Bytes.Append(reinterpret_cast<const uint8*>(InEntries.GetData()), InEntries.Num() * sizeof(uint64));
+	return FFileHelper::SaveArrayToFile(Bytes, *Path);
+}
+
+void FDeepseekSessionLog::Append(ERole Role, const FString& Sender, const FString& Text)
+{
+	TArray<uint8> Payload;
+	FMemoryWriter Writer(Payload);
+	uint8 RoleValue = static_cast<uint8>(Role);
+	Writer << RoleValue << const_cast<FString&>(Sender) << const_cast<FString&>(Text);
+
+	AppendRecord(DeepseekSessionLogFormat::Message, Payload);
+}
+
+void FDeepseekSessionLog::AppendClear()
+{
+	if (Num() > 0)
+	{
+		AppendRecord(DeepseekSessionLogFormat::Clear, TArray<uint8>());
+		FirstLive = Entries.Num();
+	}
+}
+
+void FDeepseekSessionLog::AppendRecord(uint8 Type, const TArray<uint8>& Payload)
+{
+	using namespace DeepseekSessionLogFormat;
+
+	if (bDeleted)
+	{
+		return;
+	}
+
+	// 第一条记录时创建文件
+	const bool bNewFile = LogSize == 0;
+	TArray<uint8> Bytes;
+	if (bNewFile)
+	{
+		Bytes = MakeHeader(LogMagic);
+	}
+
+	const int64 Offset = LogSize + Bytes.Num();
+	FMemoryWriter Writer(Bytes, false, true);
+	uint32 PayloadSize = Payload.Num();
+	uint8 RecordType = Type;
+	Writer << PayloadSize << RecordType;
+	Bytes.Append(Payload);
+
+	// 先写日志再写索引，两者不一致时打开时以日志为准
+	if (!AppendToFile(LogPath, Bytes))
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("无法写入会话记录 %s"), *LogPath);
+		return;
+	}
+	LogSize = Offset + RecordHeaderSize + Payload.Num();
+
+	const uint64 Entry = MakeEntry(Offset, Type);
+	Entries.Add(Entry);
+
+	TArray<uint8> IndexBytes;
+	if (bNewFile)
+	{
+		IndexBytes = MakeHeader(IndexMagic);
+	}
+	IndexBytes.Append(reinterpret_cast<const uint8*>(&Entry), sizeof(uint64));
+	AppendToFile(IndexPath, IndexBytes);
+}
+
+bool FDeepseekSessionLog::ReadMessages(int32 First, int32 Count, TArray<FRecord>& OutRecords) const
+{
+	using namespace DeepseekSessionLogFormat;
+
+	if (First < 0 || Count <= 0 || First + Count > Num())
+	{
+		return false;
+	}
+
+	// 连续的记录在文件中也是连续的，一次映射整段
+	const int32 FirstEntry = FirstLive + First;
+	const int32 EndEntry = FirstEntry + Count;
+	const int64 Begin = GetOffset(Entries[FirstEntry]);
+	const int64 End = EndEntry < Entries.Num() ? GetOffset(Entries[EndEntry]) : LogSize;
+
+	OutRecords.Reserve(OutRecords.Num() + Count);
+	return ReadRegion(Begin, End - Begin, [&OutRecords, Count](TArrayView<const uint8> Bytes)
+	{
+		FMemoryReaderView Reader(MakeMemoryView(Bytes));
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			uint32 PayloadSize = 0;
+			uint8 Type = 0;
+			uint8 Role = 0;
+			FRecord& Record = OutRecords.AddDefaulted_GetRef();
+			Reader << PayloadSize << Type << Role << Record.Sender << Record.Text;
+			if (Reader.IsError() || Type != Message)
+			{
+				OutRecords.Pop();
+				return false;
+			}
+			Record.Role = static_cast<ERole>(Role);
+		}
+		return true;
+	});
+}
+
+bool FDeepseekSessionLog::ReadRegion(int64 Offset, int64 Size, TFunctionRef<bool(TArrayView<const uint8>)> Visit) const
+{
+	if (Size <= 0)
+	{
+		return Visit(TArrayView<const uint8>());
+	}
+
+	// 只映射需要的区域，文件的其余部分不会读入内存
+	TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*LogPath));
+	if (MappedFile.IsValid() && Offset + Size <= MappedFile->GetFileSize())
+	{
+		TUniquePtr<IMappedFileRegion> Region(MappedFile->MapRegion(Offset, Size));
+		if (Region.IsValid())
+		{
+			return Visit(TArrayView<const uint8>(Region->GetMappedPtr(), Size));
+		}
+	}
+
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*LogPath, FILEREAD_Silent));
+	if (!Reader.IsValid() || Offset + Size > Reader->TotalSize())
+	{
+		return false;
+	}
+
+	TArray<uint8> Bytes;
+	Bytes.SetNumUninitialized(Size);
+	Reader->Seek(Offset);
+	Reader->Serialize(Bytes.GetData(), Size);
+	return !Reader->IsError() && Visit(Bytes);
+}
+
+void FDeepseekSessionLog::CompactIfNeeded()
+{
+	using namespace DeepseekSessionLogFormat;
+
+	if (bCompacting || bDeleted || FirstLive == 0)
+	{
+		return;
+	}
+
+	const int64 LiveBegin = FirstLive < Entries.Num() ? GetOffset(Entries[FirstLive]) : LogSize;
+	const int64 DeadBytes = LiveBegin - HeaderSize;
+	if (DeadBytes < MinCompactBytes || DeadBytes * 2 < LogSize)
+	{
+		return;
+	}
+
+	// 已写入的记录不会再改动，后台复制快照范围内的当前消息，期间的新记录在完成时补上
+	bCompacting = true;
+	const int32 SnapshotFirstLive = FirstLive;
+	const int32 SnapshotNum = Entries.Num();
+	const int64 SnapshotSize = LogSize;
+	TArray<uint64> LiveEntries(Entries.GetData() + FirstLive, Entries.Num() - FirstLive);
+
+	TSharedRef<FDeepseekSessionLog, ESPMode::ThreadSafe> This = AsShared();
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [This, SnapshotFirstLive, SnapshotNum, SnapshotSize, LiveBegin, LiveEntries = MoveTemp(LiveEntries)]() mutable
+	{
+		const FString TempPath = This->LogPath + TEXT(".tmp");
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+
+		bool bSuccess = false;
+		{
+			TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath));
+			if (Writer.IsValid())
+			{
+				TArray<uint8> Header = MakeHeader(LogMagic);
+				Writer->Serialize(Header.GetData(), Header.Num());
+				bSuccess = This->ReadRegion(LiveBegin, SnapshotSize - LiveBegin, [&Writer](TArrayView<const uint8> Bytes)
+				{
+					Writer->Serialize(const_cast<uint8*>(Bytes.GetData()), Bytes.Num());
+					return !Writer->IsError();
+				});
+				bSuccess = Writer->Close() && bSuccess;
+			}
+		}
+
+		for (uint64& Entry : LiveEntries)
+		{
+			Entry = MakeEntry(GetOffset(Entry) - LiveBegin + HeaderSize, GetType(Entry));
+		}
+		const int64 CompactedSize = bSuccess ? HeaderSize + SnapshotSize - LiveBegin : -1;
+
+		AsyncTask(ENamedThreads::GameThread, [This, SnapshotFirstLive, SnapshotNum, SnapshotSize, LiveEntries = MoveTemp(LiveEntries), CompactedSize]()
+		{
+			This->FinishCompaction(SnapshotFirstLive, SnapshotNum, SnapshotSize, LiveEntries, CompactedSize);
+		});
+	});
+}
+
+void FDeepseekSessionLog::FinishCompaction(int32 SnapshotFirstLive, int32 SnapshotNum, int64 SnapshotSize, const TArray<uint64>& CompactedEntries, int64 CompactedSize)
+{
+	bCompacting = false;
+
+	const FString TempPath = LogPath + TEXT(".tmp");
+	if (bDeleted || CompactedSize < 0)
+	{
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+
+		// 压缩期间删除时文件可能还在被读取，这里再删一次
+		if (bDeleted)
+		{
+			IFileManager::Get().Delete(*LogPath, false, false, true);
+			IFileManager::Get().Delete(*IndexPath, false, false, true);
+		}
+		return;
+	}
+
+	// 补上压缩期间追加的记录
+	if (LogSize > SnapshotSize)
+	{
+		const bool bCopied = ReadRegion(SnapshotSize, LogSize - SnapshotSize, [&TempPath](TArrayView<const uint8> Bytes)
+		{
+			TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath, FILEWRITE_Append));
+			if (!Writer.IsValid())
+			{
+				return false;
+			}
+			Writer->Serialize(const_cast<uint8*>(Bytes.GetData()), Bytes.Num());
+			return Writer->Close();
+		});
+		if (!bCopied)
+		{
+			IFileManager::Get().Delete(*TempPath, false, false, true);
+			return;
+		}
+	}
+
+	TArray<uint64> NewEntries = CompactedEntries;
+	NewEntries.Reserve(CompactedEntries.Num() + Entries.Num() - SnapshotNum);
+	for (int32 Index = SnapshotNum; Index < Entries.Num(); ++Index)
+	{
+		NewEntries.Add(MakeEntry(GetOffset(Entries[Index]) - SnapshotSize + CompactedSize, GetType(Entries[Index])));
+	}
+
+	// 替换日志后重写索引，中途退出时下次打开会按日志重建索引
+	if (!IFileManager::Get().Move(*LogPath, *TempPath, true, true))
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("无法替换会话记录 %s"), *LogPath);
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return;
+	}
+
+	const int64 OldSize = LogSize;
+	LogSize = CompactedSize + (LogSize - SnapshotSize);
+	FirstLive -= SnapshotFirstLive;
+	Entries = MoveTemp(NewEntries);
+	SaveIndex(IndexPath, Entries);
+
+	UE_LOG(LogDeepseek, Log, TEXT("压缩会话记录 %s：%lld -> %lld 字节"), *LogPath, OldSize, LogSize);
+}
+
+void FDeepseekSessionLog::Delete()
+{
+	// 正在进行的压缩完成时会删除临时文件
+	bDeleted = true;
+	IFileManager::Get().Delete(*LogPath, false, false, true);
+	IFileManager::Get().Delete(*IndexPath, false, false, true);
+	Entries.Empty();
+	FirstLive = 0;
+	LogSize = 0;
+}
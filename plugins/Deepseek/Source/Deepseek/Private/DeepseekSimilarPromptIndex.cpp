@@ -0,0 +1,321 @@
+#include "DeepseekSimilarPromptIndex.h"
+#include "DeepseekOpenAIService.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace DeepseekSimilarPromptFormat
+{
+	/** 索引文件标识 'DSSP' */
+	static const uint32 Magic = 0x50535344;
+	static const uint32 Version = 2;
+
+	/** 签名分段数，每段16位 */
+	static const int32 NumBands = 4;
+	static const int32 BandBits = 16;
+
+	/** 字符shingle长度 */
+	static const int32 ShingleLength = 3;
+}
+
+FDeepseekSimilarPromptIndex::FDeepseekSimilarPromptIndex()
+	: MaxEntries(200000)
+{
+}
+
+bool FDeepseekSimilarPromptIndex::MakeSignature(const FString& Model, const FString& ApiUrl, double Temperature, const TArray<FOpenAIMessage>& Messages, FDeepseekPromptSignature& OutSignature)
+{
+	if (Messages.Num() == 0 || Messages.Last().Role != TEXT("user"))
+	{
+		return false;
+	}
+
+	const int32 PromptIndex = Messages.Num() - 1;
+	OutSignature.SimHash = ComputeSimHash(NormalizePrompt(Messages[PromptIndex].Content.View()));
+	OutSignature.PromptHash = FCrc::StrCrc32(*Messages[PromptIndex].Content);
+
+	// 不同模型、接口或温度下的回答不能互相替代，与FDeepseekResponseCache::MakeKey一样计入这几项
+	const FString Header = FString::Printf(TEXT("%s\n%s\n%s"), *Model, *ApiUrl, *FString::SanitizeFloat(Temperature));
+	uint32 ContextHash = FCrc::StrCrc32(*Header);
+
+	// 上下文还包括系统提示词和提问之前的几条消息，同样先规范化
+	const int32 FirstContextIndex = FMath::Max(0, PromptIndex - ContextMessages);
+	for (int32 Index = 0; Index < PromptIndex; ++Index)
+	{
+		if (Index >= FirstContextIndex || (Index == 0 && Messages[0].Role == TEXT("system")))
+		{
+			ContextHash = FCrc::StrCrc32(*Messages[Index].Role, ContextHash);
+			ContextHash = FCrc::StrCrc32(*NormalizePrompt(Messages[Index].Content.View()), ContextHash);
+		}
+	}
+	OutSignature.ContextHash = ContextHash;
+
+	return true;
+}
+
+FString FDeepseekSimilarPromptIndex::NormalizePrompt(FStringView Prompt)
+{
+	FString Normalized;
+	Normalized.Reserve(Prompt.Len());
+
+	// 行号、时间戳、地址等数字只保留位置，不区分具体值
+	bool bPendingSpace = false;
+	bool bInNumber = false;
+	for (const TCHAR Char : Prompt)
+	{
+		if (FChar::IsWhitespace(Char))
+		{
+			bPendingSpace = Normalized.Len() > 0;
+			bInNumber = false;
+			continue;
+		}
+
+		if (bPendingSpace)
+		{
+			Normalized.AppendChar(TEXT(' '));
+			bPendingSpace = false;
+		}
+
+		if (FChar::IsDigit(Char))
+		{
+			if (!bInNumber)
+			{
+				Normalized.AppendChar(TEXT('#'));
+				bInNumber = true;
+			}
+			continue;
+		}
+
+		bInNumber = false;
+		Normalized.AppendChar(FChar::ToLower(Char));
+	}
+
+	return Normalized;
+}
+
+uint64 FDeepseekSimilarPromptIndex::ComputeSimHash(const FString& NormalizedText)
+{
+	using namespace DeepseekSimilarPromptFormat;
+
+	const int32 Len = NormalizedText.Len();
+	if (Len == 0)
+	{
+		return 0;
+	}
+
+	// 字符三元组同时适用于中文和英文，不需要分词
+	int32 Weights[64] = {};
+	const int32 NumShingles = FMath::Max(1, Len - ShingleLength + 1);
+	for (int32 Start = 0; Start < NumShingles; ++Start)
+	{
+		// FNV-1a，按码点计算，保存的签名与平台的TCHAR宽度无关
+		uint64 Hash = 0xcbf29ce484222325ull;
+		const int32 End = FMath::Min(Len, Start + ShingleLength);
+		for (int32 Index = Start; Index < End; ++Index)
+		{
+			Hash ^= static_cast<uint32>(NormalizedText[Index]);
+			Hash *= 0x100000001b3ull;
+		}
+
+		for (int32 Bit = 0; Bit < 64; ++Bit)
+		{
+			Weights[Bit] += ((Hash >> Bit) & 1) ? 1 : -1;
+		}
+	}
+
+	uint64 SimHash = 0;
+	for (int32 Bit = 0; Bit < 64; ++Bit)
+	{
+		if (Weights[Bit] > 0)
+		{
+			SimHash |= 1ull << Bit;
+		}
+	}
+	return SimHash;
+}
+
+uint64 FDeepseekSimilarPromptIndex::MakeBucketKey(uint32 ContextHash, int32 Band, uint64 SimHash)
+{
+	using namespace DeepseekSimilarPromptFormat;
+
+	const uint64 BandValue = (SimHash >> (Band * BandBits)) & 0xffff;
+	return (static_cast<uint64>(ContextHash) << 32) | (static_cast<uint64>(Band) << BandBits) | BandValue;
+}
+
+void FDeepseekSimilarPromptIndex::Add(const FDeepseekPromptSignature& Signature, const FSHAHash& Key)
+{
+	if (Keys.Contains(Key))
+	{
+		return;
+	}
+
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.SimHash = Signature.SimHash;
+	Entry.ContextHash = Signature.ContextHash;
+	Entry.PromptHash = Signature.PromptHash;
+	Entry.Key = Key;
+	Keys.Add(Key);
+	AddToBuckets(Entries.Num() - 1);
+
+	if (Entries.Num() > MaxEntries)
+	{
+		Trim();
+	}
+}
+
+bool FDeepseekSimilarPromptIndex::FindNearest(const FDeepseekPromptSignature& Signature, int32 MaxDistance, FSHAHash& OutKey, int32& OutDistance) const
+{
+	using namespace DeepseekSimilarPromptFormat;
+
+	// 距离不超过段数减一时，至少有一段完全相同，只需检查这几个桶
+	MaxDistance = FMath::Min(MaxDistance, NumBands - 1);
+
+	int32 BestIndex = INDEX_NONE;
+	int32 BestDistance = MaxDistance + 1;
+	for (int32 Band = 0; Band < NumBands; ++Band)
+	{
+		const TArray<int32>* Bucket = Buckets.Find(MakeBucketKey(Signature.ContextHash, Band, Signature.SimHash));
+		if (Bucket == nullptr)
+		{
+			continue;
+		}
+
+		for (const int32 EntryIndex : *Bucket)
+		{
+			const FEntry& Entry = Entries[EntryIndex];
+			if (Entry.ContextHash != Signature.ContextHash || Entry.PromptHash == Signature.PromptHash)
+			{
+				continue;
+			}
+
+			// 距离相同时取较新的条目
+			const int32 Distance = static_cast<int32>(FPlatformMath::CountBits(Entry.SimHash ^ Signature.SimHash));
+			if (Distance < BestDistance || (Distance == BestDistance && EntryIndex > BestIndex))
+			{
+				BestDistance = Distance;
+				BestIndex = EntryIndex;
+			}
+		}
+	}
+
+	if (BestIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutKey = Entries[BestIndex].Key;
+	OutDistance = BestDistance;
+	return true;
+}
+
+void FDeepseekSimilarPromptIndex::Reset()
+{
+	Entries.Reset();
+	Buckets.Reset();
+	Keys.Reset();
+}
+
+void FDeepseekSimilarPromptIndex::SetMaxEntries(int32 InMaxEntries)
+{
+	MaxEntries = FMath::Max(1, InMaxEntries);
+	if (Entries.Num() > MaxEntries)
+	{
+		Trim();
+	}
+}
+
+void FDeepseekSimilarPromptIndex::AddToBuckets(int32 EntryIndex)
+{
+	using namespace DeepseekSimilarPromptFormat;
+
+	const FEntry& Entry = Entries[EntryIndex];
+	for (int32 Band = 0; Band < NumBands; ++Band)
+	{
+		Buckets.FindOrAdd(MakeBucketKey(Entry.ContextHash, Band, Entry.SimHash)).Add(EntryIndex);
+	}
+}
+
+void FDeepseekSimilarPromptIndex::Trim()
+{
+	// 一次丢弃四分之一，重建桶的开销分摊到之后的多次添加
+	const int32 NumToKeep = FMath::Min(Entries.Num(), MaxEntries - MaxEntries / 4);
+	Entries.RemoveAt(0, Entries.Num() - NumToKeep);
+
+	Buckets.Reset();
+	Keys.Reset();
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+	{
+		Keys.Add(Entries[EntryIndex].Key);
+		AddToBuckets(EntryIndex);
+	}
+}
+
+bool FDeepseekSimilarPromptIndex::Save(const FString& Path) const
+{
+	using namespace DeepseekSimilarPromptFormat;
+
+	TArray<uint8> Buffer;
+	FMemoryWriter Writer(Buffer);
+
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	int32 NumEntries = Entries.Num();
+	Writer << FileMagic << FileVersion << NumEntries;
+	for (const FEntry& Entry : Entries)
+	{
+		uint64 SimHash = Entry.SimHash;
+		uint32 ContextHash = Entry.ContextHash;
+		uint32 PromptHash = Entry.PromptHash;
+		FSHAHash Key = Entry.Key;
+		Writer << SimHash << ContextHash << PromptHash << Key;
+	}
+
+	return FFileHelper::SaveArrayToFile(Buffer, *Path);
+}
+
+void FDeepseekSimilarPromptIndex::Load(const FString& Path)
+{
+	using namespace DeepseekSimilarPromptFormat;
+
+	Reset();
+
+	TArray<uint8> Buffer;
+	if (!FFileHelper::LoadFileToArray(Buffer, *Path, FILEREAD_Silent))
+	{
+		return;
+	}
+
+	FMemoryReader Reader(Buffer);
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	int32 NumEntries = 0;
+	Reader << FileMagic << FileVersion << NumEntries;
+	if (Reader.IsError() || FileMagic != Magic || FileVersion != Version || NumEntries < 0)
+	{
+		return;
+	}
+
+	Entries.Reserve(NumEntries);
+	for (int32 EntryIndex = 0; EntryIndex < NumEntries && !Reader.AtEnd(); ++EntryIndex)
+	{
+		FEntry Entry;
+		Reader << Entry.SimHash << Entry.ContextHash << Entry.PromptHash << Entry.Key;
+		if (Reader.IsError())
+		{
+			break;
+		}
+
+		if (!Keys.Contains(Entry.Key))
+		{
+			Keys.Add(Entry.Key);
+			Entries.Add(Entry);
+			AddToBuckets(Entries.Num() - 1);
+		}
+	}
+
+	if (Entries.Num() > MaxEntries)
+	{
+		Trim();
+	}
+}
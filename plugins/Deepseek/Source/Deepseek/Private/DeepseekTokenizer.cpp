@@ -0,0 +1,100 @@
+#include "DeepseekTokenizer.h"
+#include "DeepseekOpenAIService.h"
+
+int32 FDeepseekTokenizer::CountTokens(FStringView Text)
+{
+	const TCHAR* Chars = Text.GetData();
+	const int32 Len = Text.Len();
+
+	int32 Tokens = 0;
+	int32 Index = 0;
+	while (Index < Len)
+	{
+		const ECharClass Class = Classify(Chars[Index]);
+
+		int32 PieceEnd = Index + 1;
+		while (PieceEnd < Len && Classify(Chars[PieceEnd]) == Class)
+		{
+			++PieceEnd;
+		}
+
+		// 单个空格与后面的单词合并为一个token（" the"），不单独计数
+		const bool bLeadingSpace = Class == ECharClass::Space && PieceEnd - Index == 1 && PieceEnd < Len && Classify(Chars[PieceEnd]) == ECharClass::Letter;
+		if (!bLeadingSpace)
+		{
+			Tokens += CountPieceTokens(Class, PieceEnd - Index);
+		}
+
+		Index = PieceEnd;
+	}
+
+	return Tokens;
+}
+
+int32 FDeepseekTokenizer::CountMessageTokens(const FOpenAIMessage& Message)
+{
+	if (Message.CachedTokenCount == INDEX_NONE)
+	{
+		Message.CachedTokenCount = CountTokens(Message.Content.View()) + MessageOverheadTokens;
+	}
+
+	return Message.CachedTokenCount;
+}
+
+FDeepseekTokenizer::ECharClass FDeepseekTokenizer::Classify(TCHAR Char)
+{
+	if ((Char >= TEXT('a') && Char <= TEXT('z')) || (Char >= TEXT('A') && Char <= TEXT('Z')) || Char == TEXT('_'))
+	{
+		return ECharClass::Letter;
+	}
+	if (Char >= TEXT('0') && Char <= TEXT('9'))
+	{
+		return ECharClass::Digit;
+	}
+	if (Char == TEXT('\n') || Char == TEXT('\r'))
+	{
+		return ECharClass::Newline;
+	}
+	if (Char == TEXT(' ') || Char == TEXT('\t'))
+	{
+		return ECharClass::Space;
+	}
+	// 中日韩统一表意文字、假名、谚文与全角标点
+	if ((Char >= 0x4E00 && Char <= 0x9FFF) || (Char >= 0x3400 && Char <= 0x4DBF) || (Char >= 0x3000 && Char <= 0x30FF)
+		|| (Char >= 0xAC00 && Char <= 0xD7AF) || (Char >= 0xFF00 && Char <= 0xFFEF))
+	{
+		return ECharClass::CJK;
+	}
+	if (Char < 0x80)
+	{
+		return ECharClass::Punctuation;
+	}
+	return ECharClass::Other;
+}
+
+int32 FDeepseekTokenizer::CountPieceTokens(ECharClass Class, int32 Length)
+{
+	switch (Class)
+	{
+	case ECharClass::Letter:
+		// 常见单词整体在词表中，长标识符按约4个字符一个token合并
+		return Length <= 6 ? 1 : FMath::DivideAndRoundUp(Length, 4);
+	case ECharClass::Digit:
+		// 数字按最多3位一组切分
+		return FMath::DivideAndRoundUp(Length, 3);
+	case ECharClass::Space:
+		// 代码缩进等连续空白通常合并为少量token
+		return FMath::DivideAndRoundUp(Length, 4);
+	case ECharClass::Newline:
+		return 1;
+	case ECharClass::CJK:
+		// DeepSeek文档给出的换算：1个中文字符约0.6个token
+		return FMath::DivideAndRoundUp(Length * 3, 5);
+	case ECharClass::Punctuation:
+		// 成对的运算符（->、::、==）常合并为一个token
+		return FMath::DivideAndRoundUp(Length, 2);
+	default:
+		// 其余字符按UTF-8字节回退，通常每个字符1到2个token
+		return Length + Length / 2;
+	}
+}
@@ -0,0 +1,353 @@
+#include "DeepseekUsageLedger.h"
+#include "Deepseek.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+TUniquePtr<FDeepseekUsageLedger> FDeepseekUsageLedger::Instance;
+
+/** 文件头 */
+static const uint32 LedgerMagic = 0x4C555344;	// "DSUL"
+static const uint32 LedgerVersion = 1;
+
+/** 记录类型 */
+enum class ELedgerRecord : uint8
+{
+	/** 模型编号：uint16编号，模型名 */
+	Model = 0,
+
+	/** 用量：int64 UTC时间戳，uint16模型编号，int32提示、回复与缓存命中token数 */
+	Usage = 1,
+};
+
+/**
+ * 从配置读取单价，每行一个模型：
+ * +ModelPrices=(Model="deepseek-chat", Prompt=0.27, CacheHit=0.07, Completion=1.10)
+ */
+static void LoadPrices(TMap<FString, FDeepseekUsageLedger::FPrice>& OutPrices)
+{
+	// 未配置时使用DeepSeek公布的美元标准价
+	OutPrices.Add(TEXT("deepseek-chat"), { 0.27, 0.07, 1.10 });
+	OutPrices.Add(TEXT("deepseek-reasoner"), { 0.55, 0.14, 2.19 });
+
+	TArray<FString> Lines;
+	GConfig->GetArray(TEXT("DeepseekAISettings"), TEXT("ModelPrices"), Lines, GEngineIni);
+	for (const FString& Line : Lines)
+	{
+		FString Model;
+		if (!FParse::Value(*Line, TEXT("Model="), Model) || Model.IsEmpty())
+		{
+			continue;
+		}
+
+		FDeepseekUsageLedger::FPrice& Price = OutPrices.FindOrAdd(Model);
+		FParse::Value(*Line, TEXT("Prompt="), Price.PromptPerMillion);
+		FParse::Value(*Line, TEXT("CacheHit="), Price.CacheHitPerMillion);
+		FParse::Value(*Line, TEXT("Completion="), Price.CompletionPerMillion);
+	}
+}
+
+void FDeepseekUsageLedger::Initialize()
+{
+	if (!Instance.IsValid())
+	{
+		Instance.Reset(new FDeepseekUsageLedger());
+		Instance->Load();
+	}
+}
+
+void FDeepseekUsageLedger::Shutdown()
+{
+	Instance.Reset();
+}
+
+FDeepseekUsageLedger* FDeepseekUsageLedger::Get()
+{
+	return Instance.Get();
+}
+
+FDeepseekUsageLedger::FDeepseekUsageLedger()
+	: FilePath(FPaths::ProjectSavedDir() / TEXT("Deepseek") / TEXT("UsageLedger.bin"))
+	, DailyBudget(0.0f)
+	, LargeRequestTokens(32000)
+	, Generation(0)
+{
+	LoadPrices(Prices);
+	GConfig->GetFloat(TEXT("DeepseekAISettings"), TEXT("DailyBudget"), DailyBudget, GEngineIni);
+	GConfig->GetInt(TEXT("DeepseekAISettings"), TEXT("LargeRequestTokens"), LargeRequestTokens, GEngineIni);
+}
+
+int32 FDeepseekUsageLedger::GetDayNumber(const FDateTime& LocalTime)
+{
+	return static_cast<int32>(LocalTime.GetTicks() / ETimespan::TicksPerDay);
+}
+
+void FDeepseekUsageLedger::Load()
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FilePath, FILEREAD_Silent))
+	{
+		return;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic << Version;
+	if (Reader.IsError() || Magic != LedgerMagic || Version != LedgerVersion)
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("用量账本 %s 格式不符，重新开始记录"), *FilePath);
+		IFileManager::Get().Move(*(FilePath + TEXT(".bad")), *FilePath);
+		return;
+	}
+
+	// 时间戳按UTC保存，按本地日期归入每天的累计
+	const FTimespan LocalOffset = FDateTime::Now() - FDateTime::UtcNow();
+	int64 ValidSize = Reader.Tell();
+	int32 NumRecords = 0;
+	while (!Reader.AtEnd())
+	{
+		uint8 Kind = 0;
+		Reader << Kind;
+
+		if (Kind == static_cast<uint8>(ELedgerRecord::Model))
+		{
+			uint16 ModelId = 0;
+			FString Model;
+			Reader << ModelId << Model;
+			if (Reader.IsError() || ModelId != ModelNames.Num())
+			{
+				break;
+			}
+			ModelNames.Add(MoveTemp(Model));
+		}
+		else if (Kind == static_cast<uint8>(ELedgerRecord::Usage))
+		{
+			int64 Timestamp = 0;
+			uint16 ModelId = 0;
+			int32 PromptTokens = 0;
+			int32 CompletionTokens = 0;
+			int32 CacheHitTokens = 0;
+			Reader << Timestamp << ModelId << PromptTokens << CompletionTokens << CacheHitTokens;
+			if (Reader.IsError() || !ModelNames.IsValidIndex(ModelId))
+			{
+				break;
+			}
+
+			const FDateTime LocalTime = FDateTime::FromUnixTimestamp(Timestamp) + LocalOffset;
+			Accumulate(ModelNames[ModelId], GetDayNumber(LocalTime), 0, PromptTokens, CompletionTokens, CacheHitTokens);
+			++NumRecords;
+		}
+		else
+		{
+			break;
+		}
+
+		ValidSize = Reader.Tell();
+	}
+
+	// 写入中途退出会留下半条记录，截掉后再追加
+	if (ValidSize < Bytes.Num())
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("用量账本末尾有 %lld 字节不完整的记录，已截掉"), Bytes.Num() - ValidSize);
+		Bytes.SetNum(ValidSize);
+		FFileHelper::SaveArrayToFile(Bytes, *FilePath);
+	}
+
+	UE_LOG(LogDeepseek, Log, TEXT("读取用量账本：%d 条记录，%d 个模型"), NumRecords, ModelNames.Num());
+}
+
+void FDeepseekUsageLedger::Accumulate(const FString& Model, int32 DayNumber, uint32 SessionId, int32 PromptTokens, int32 CompletionTokens, int32 CacheHitTokens)
+{
+	auto Add = [PromptTokens, CompletionTokens, CacheHitTokens](FTotals& Totals)
+	{
+		++Totals.Requests;
+		Totals.PromptTokens += PromptTokens;
+		Totals.CompletionTokens += CompletionTokens;
+		Totals.CacheHitTokens += CacheHitTokens;
+	};
+
+	Add(ModelTotals.FindOrAdd(Model));
+	Add(DayTotals.FindOrAdd(DayNumber));
+	Add(DayModelTotals.FindOrAdd(DayNumber).FindOrAdd(Model));
+	if (SessionId != 0)
+	{
+		Add(SessionTotals.FindOrAdd(SessionId));
+	}
+	++Generation;
+}
+
+uint16 FDeepseekUsageLedger::GetModelId(const FString& Model, TArray<uint8>& OutBytes)
+{
+	const int32 Existing = ModelNames.IndexOfByKey(Model);
+	if (Existing != INDEX_NONE)
+	{
+		return static_cast<uint16>(Existing);
+	}
+
+	uint16 ModelId = static_cast<uint16>(ModelNames.Num());
+	ModelNames.Add(Model);
+
+	FMemoryWriter Writer(OutBytes, false, true);
+	uint8 Kind = static_cast<uint8>(ELedgerRecord::Model);
+	FString ModelName = Model;
+	Writer << Kind << ModelId << ModelName;
+	return ModelId;
+}
+
+void FDeepseekUsageLedger::Record(const FString& Model, uint32 SessionId, const FOpenAIUsage& Usage)
+{
+	check(IsInGameThread());
+
+	TArray<uint8> Bytes;
+	if (IFileManager::Get().FileSize(*FilePath) <= 0)
+	{
+		FMemoryWriter Writer(Bytes);
+		uint32 Magic = LedgerMagic;
+		uint32 Version = LedgerVersion;
+		Writer << Magic << Version;
+		ModelNames.Reset();
+	}
+
+	const int32 NumKnownModels = ModelNames.Num();
+	uint16 ModelId = GetModelId(Model, Bytes);
+	int64 Timestamp = FDateTime::UtcNow().ToUnixTimestamp();
+	int32 PromptTokens = Usage.PromptTokens;
+	int32 CompletionTokens = Usage.CompletionTokens;
+	int32 CacheHitTokens = Usage.PromptCacheHitTokens;
+
+	FMemoryWriter Writer(Bytes, false, true);
+	uint8 Kind = static_cast<uint8>(ELedgerRecord::Usage);
+	Writer << Kind << Timestamp << ModelId << PromptTokens << CompletionTokens << CacheHitTokens;
+	if (!Append(Bytes))
+	{
+		// 模型记录没有写进文件，下次重新写
+		ModelNames.SetNum(NumKnownModels);
+	}
+
+	Accumulate(Model, GetDayNumber(FDateTime::Now()), SessionId, PromptTokens, CompletionTokens, CacheHitTokens);
+}
+
+bool FDeepseekUsageLedger::Append(const TArray<uint8>& Bytes)
+{
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*FilePath, FILEWRITE_Append | FILEWRITE_AllowRead));
+	if (!Writer.IsValid())
+	{
+		UE_LOG(LogDeepseek, Warning, TEXT("无法写入用量账本 %s"), *FilePath);
+		return false;
+	}
+
+	Writer->Serialize(const_cast<uint8*>(Bytes.GetData()), Bytes.Num());
+	return Writer->Close();
+}
+
+FDeepseekUsageLedger::FTotals FDeepseekUsageLedger::GetDayTotals(const FDateTime& Day) const
+{
+	const FTotals* Totals = DayTotals.Find(GetDayNumber(Day));
+	return Totals != nullptr ? *Totals : FTotals();
+}
+
+FDeepseekUsageLedger::FTotals FDeepseekUsageLedger::GetSessionTotals(uint32 SessionId) const
+{
+	const FTotals* Totals = SessionTotals.Find(SessionId);
+	return Totals != nullptr ? *Totals : FTotals();
+}
+
+double FDeepseekUsageLedger::GetDayCost(const FDateTime& Day) const
+{
+	double Cost = 0.0;
+	if (const TMap<FString, FTotals>* Models = DayModelTotals.Find(GetDayNumber(Day)))
+	{
+		for (const TPair<FString, FTotals>& Pair : *Models)
+		{
+			Cost += ComputeCost(Pair.Key, Pair.Value);
+		}
+	}
+	return Cost;
+}
+
+double FDeepseekUsageLedger::ComputeCost(const FString& Model, const FTotals& Totals) const
+{
+	const FPrice* Price = Prices.Find(Model);
+	if (Price == nullptr)
+	{
+		return 0.0;
+	}
+
+	const int64 CacheMissTokens = Totals.PromptTokens - Totals.CacheHitTokens;
+	return (CacheMissTokens * Price->PromptPerMillion + Totals.CacheHitTokens * Price->CacheHitPerMillion
+		+ Totals.CompletionTokens * Price->CompletionPerMillion) / 1000000.0;
+}
+
+bool FDeepseekUsageLedger::CheckRequest(const FString& Model, int32 PromptTokens, int32 MaxTokens, FString& OutWarning) const
+{
+	// 按全部提示未命中缓存、回复用满上限估算，偏高但不会漏报
+	FTotals Request;
+	Request.PromptTokens = PromptTokens;
+	Request.CompletionTokens = MaxTokens;
+	const double RequestCost = ComputeCost(Model, Request);
+
+	if (LargeRequestTokens > 0 && PromptTokens >= LargeRequestTokens)
+	{
+		OutWarning = FString::Printf(TEXT("本次请求约 %d 个提示token，最多约 $%.4f"), PromptTokens, RequestCost);
+		return true;
+	}
+
+	const double TodayCost = GetDayCost(FDateTime::Now());
+	if (DailyBudget > 0.0f && TodayCost + RequestCost > DailyBudget)
+	{
+		OutWarning = FString::Printf(TEXT("今日已用 $%.4f，本次最多约 $%.4f，将超出每日预算 $%.2f"), TodayCost, RequestCost, DailyBudget);
+		return true;
+	}
+
+	return false;
+}
+
+FString FDeepseekUsageLedger::BuildSummary() const
+{
+	const FDateTime Today = FDateTime::Now();
+	const FTotals TodayTotals = GetDayTotals(Today);
+
+	FString Summary = FString::Printf(TEXT("今日 %d 次请求，%lld tokens（提示 %lld，其中缓存命中 %lld；回复 %lld），约 $%.4f"),
+		TodayTotals.Requests, TodayTotals.GetTotalTokens(), TodayTotals.PromptTokens, TodayTotals.CacheHitTokens,
+		TodayTotals.CompletionTokens, GetDayCost(Today));
+	if (DailyBudget > 0.0f)
+	{
+		Summary += FString::Printf(TEXT("，每日预算 $%.2f"), DailyBudget);
+	}
+
+	Summary += TEXT("\n近7天：");
+	for (int32 DaysAgo = 6; DaysAgo >= 0; --DaysAgo)
+	{
+		const FDateTime Day = Today - FTimespan::FromDays(DaysAgo);
+		Summary += FString::Printf(TEXT(" %d/%d $%.3f"), Day.GetMonth(), Day.GetDay(), GetDayCost(Day));
+	}
+
+	for (const TPair<FString, FTotals>& Pair : ModelTotals)
+	{
+		Summary += FString::Printf(TEXT("\n%s：累计 %d 次请求，%lld tokens，约 $%.4f"),
+			*Pair.Key, Pair.Value.Requests, Pair.Value.GetTotalTokens(), ComputeCost(Pair.Key, Pair.Value));
+	}
+
+	return Summary;
+}
+
+static FAutoConsoleCommand DumpUsageCommand(
+	TEXT("Deepseek.Usage"),
+	TEXT("输出今日、近7天与各模型的token用量与费用"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		if (FDeepseekUsageLedger* Ledger = FDeepseekUsageLedger::Get())
+		{
+			TArray<FString> Lines;
+			Ledger->BuildSummary().ParseIntoArrayLines(Lines);
+			for (const FString& Line : Lines)
+			{
+				UE_LOG(LogDeepseek, Display, TEXT("%s"), *Line);
+			}
+		}
+	}));
@@ -1,13 +1,16 @@
 #include "SDeepseekAIChat.h"
 #include "SlateOptMacros.h"
-#include "Widgets/Layout/SScrollBox.h"
 #include "Widgets/Layout/SBox.h"
 #include "Widgets/Layout/SBorder.h"
 #include "Widgets/Text/STextBlock.h"
-#include "Widgets/Views/STableRow.h"
+#include "DeepseekResponseCache.h"
+#include "DeepseekProviderPool.h"
+#include "SDeepseekRequestStatsPanel.h"
+#include "SDeepseekUsagePanel.h"
 #include "Styling/SlateTypes.h"
 #include "EditorStyleSet.h"
 #include "Framework/Application/SlateApplication.h"
+#include "Misc/MessageDialog.h"
 
 BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
 
@@ -15,15 +18,14 @@ const FString SDeepseekAIChat::ConfigFileName = TEXT("DeepseekAI");
 
 void SDeepseekAIChat::Construct(const FArguments& InArgs)
 {
-	// 初始化变量
-	bIsWaiting = false;
-	WaitingMessageIndex = -1;
-
 	// 初始化当前设置
-	CurrentApiKey = InArgs._ApiKey;
-	CurrentApiUrl = InArgs._ApiUrl;
-	CurrentModel = InArgs._Model;
-	CurrentSystemPrompt = TEXT("你是一个有用的AI助手，由Deepseek团队开发。请用中文回答问题，保持回答简洁明了。");
+	Settings = MakeShared<FDeepseekChatSettings>();
+	Settings->ApiKey = InArgs._ApiKey;
+	Settings->ApiUrl = InArgs._ApiUrl;
+	Settings->Model = InArgs._Model;
+	bPersistSessions = InArgs._PersistSessions;
+	Settings->SystemPrompt = TEXT("你是一个有用的AI助手，由Deepseek团队开发。请用中文回答问题，保持回答简洁明了。");
+	CurrentResponseCacheMaxMB = 256;
 
 	// 初始化模型列表
 	ModelList.Add(MakeShared<FModelInfo>(TEXT("deepseek-chat"), TEXT("deepseek-chat")));
@@ -34,7 +36,7 @@ void SDeepseekAIChat::Construct(const FArguments& InArgs)
 	// 设置当前选择的模型
 	for (TSharedPtr<FModelInfo> ModelInfo : ModelList)
 	{
-		if (ModelInfo->Id == CurrentModel)
+		if (ModelInfo->Id == Settings->Model)
 		{
 			SelectedModel = ModelInfo;
 			break;
@@ -44,24 +46,29 @@ void SDeepseekAIChat::Construct(const FArguments& InArgs)
 	if (!SelectedModel.IsValid() && ModelList.Num() > 0)
 	{
 		SelectedModel = ModelList[0];
-		CurrentModel = SelectedModel->Id;
+		Settings->Model = SelectedModel->Id;
 	}
 
-	// 创建OpenAI服务
-	OpenAIService = MakeShared<FDeepseekOpenAIService>();
-	OpenAIService->Initialize(CurrentApiKey, CurrentModel, CurrentApiUrl);
-
-	// 创建聊天列表视图
-	ChatListView = SNew(SListView<TSharedPtr<FChatMessage>>)
-		.ListItemsSource(&ChatMessages)
-		.OnGenerateRow(this, &SDeepseekAIChat::OnGenerateRow)
-		.SelectionMode(ESelectionMode::None);
+	// 响应缓存由模块创建，这里只应用容量配置
+	if (FDeepseekResponseCache* ResponseCache = FDeepseekResponseCache::Get())
+	{
+		ResponseCache->SetLimits(static_cast<int64>(CurrentResponseCacheMaxMB) * 1024 * 1024, 20000);
+	}
 
-	// 添加欢迎消息
-	ChatMessages.Add(MakeShared<FChatMessage>(TEXT("AI助手"), TEXT("您好！我是Deepseek AI助手，请问有什么可以帮助您的？"), false));
+	// 在用户输入第一个问题的同时完成握手
+	if (Settings->bPrewarmConnection)
+	{
+		FDeepseekOpenAIService::PrewarmConnection(Settings->ApiUrl);
 
-	// 添加系统消息到聊天历史
-	ChatHistory.Add(FOpenAIMessage(TEXT("system"), CurrentSystemPrompt));
+		// 提供方池中的地址随时可能被选中，一并预热
+		if (FDeepseekProviderPool* ProviderPool = FDeepseekProviderPool::Get())
+		{
+			for (const FDeepseekProvider& Provider : ProviderPool->GetProviders())
+			{
+				FDeepseekOpenAIService::PrewarmConnection(Provider.ApiUrl);
+			}
+		}
+	}
 
 	ChildSlot
 	[
@@ -98,220 +105,282 @@ void SDeepseekAIChat::Construct(const FArguments& InArgs)
 				]
 			]
 
-			// 聊天记录区域
-			+ SVerticalBox::Slot()
-			.FillHeight(1.0f)
-			.Padding(0, 0, 0, 10)
-			[
-				SNew(SBorder)
-				.BorderImage(FEditorStyle::GetBrush("ToolPanel.DarkGroupBorder"))
-				.Padding(FMargin(4.0f))
-				[
-					SNew(SScrollBox)
-					.ScrollBarAlwaysVisible(true)
-					+ SScrollBox::Slot()
-					[
-						ChatListView.ToSharedRef()
-					]
-				]
-			]
-
-			// 输入区域
+			// 会话标签栏
 			+ SVerticalBox::Slot()
 			.AutoHeight()
+			.Padding(0, 0, 0, 5)
 			[
 				SNew(SHorizontalBox)
 
-				// 输入框
 				+ SHorizontalBox::Slot()
 				.FillWidth(1.0f)
-				.Padding(0, 0, 5, 0)
 				[
-					SAssignNew(InputTextBox, SEditableTextBox)
-					.HintText(FText::FromString(TEXT("请输入您的问题...")))
-					.IsEnabled(!bIsWaiting)
-					.OnTextCommitted_Lambda([this](const FText& Text, ETextCommit::Type CommitType)
-					{
-						if (CommitType == ETextCommit::OnEnter && !Text.IsEmpty() && !bIsWaiting)
-						{
-							OnSendMessage();
-						}
-					})
+					SAssignNew(SessionTabBar, SHorizontalBox)
 				]
 
-				// 发送按钮
+				// 新建会话按钮
 				+ SHorizontalBox::Slot()
 				.AutoWidth()
-				.Padding(0, 0, 5, 0)
 				[
 					SNew(SButton)
-					.Text(FText::FromString(TEXT("发送")))
-					.IsEnabled(!bIsWaiting)
-					.OnClicked(this, &SDeepseekAIChat::OnSendMessage)
+					.Text(FText::FromString(TEXT("新会话")))
+					.OnClicked(this, &SDeepseekAIChat::OnNewSession)
 				]
 
-				// 清空按钮
+				// 删除会话按钮
 				+ SHorizontalBox::Slot()
 				.AutoWidth()
+				.Padding(4, 0, 0, 0)
 				[
 					SNew(SButton)
-					.Text(FText::FromString(TEXT("清空")))
-					.IsEnabled(!bIsWaiting)
-					.OnClicked(this, &SDeepseekAIChat::OnClearChat)
+					.Text(FText::FromString(TEXT("删除会话")))
+					.IsEnabled_Lambda([this]() { return bPersistSessions; })
+					.OnClicked(this, &SDeepseekAIChat::OnDeleteActiveSession)
 				]
 			]
+
+			// 当前会话
+			+ SVerticalBox::Slot()
+			.FillHeight(1.0f)
+			[
+				SAssignNew(SessionSwitcher, SWidgetSwitcher)
+			]
+
+			// 请求统计
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(0, 5, 0, 0)
+			[
+				SNew(SDeepseekRequestStatsPanel)
+			]
+
+			// 用量与费用
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(0, 5, 0, 0)
+			[
+				SNew(SDeepseekUsagePanel)
+			]
 		]
 	];
-}
 
-FReply SDeepseekAIChat::OnSendMessage()
-{
-	if (bIsWaiting)
+	if (RestoreSessions() > 0)
 	{
-		return FReply::Handled();
+		RefreshSessionTabs();
 	}
-
-	FString UserMessage = InputTextBox->GetText().ToString();
-
-	if (!UserMessage.IsEmpty())
+	else
 	{
-		// 添加用户消息
-		ChatMessages.Add(MakeShared<FChatMessage>(TEXT("用户"), UserMessage, true));
-
-		// 清空输入框
-		InputTextBox->SetText(FText::GetEmpty());
-
-		// 刷新列表
-		ChatListView->RequestListRefresh();
+		OnNewSession();
+	}
+}
 
-		// 发送AI请求
-		SendAIRequest(UserMessage);
+FReply SDeepseekAIChat::OnNewSession()
+{
+	// 新会话的记录文件在第一条消息时才创建
+	TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log;
+	if (bPersistSessions)
+	{
+		Log = FDeepseekSessionLog::Create();
 	}
 
+	AddSession(CreateSession(Log));
+	RefreshSessionTabs();
 	return FReply::Handled();
 }
 
-FReply SDeepseekAIChat::OnClearChat()
+void SDeepseekAIChat::AddSession(TSharedRef<SDeepseekChatSession> Session)
+{
+	Sessions.Add(Session);
+	SessionSwitcher->AddSlot()
+	[
+		Session
+	];
+	SessionSwitcher->SetActiveWidget(Session);
+}
+
+int32 SDeepseekAIChat::RestoreSessions()
 {
-	if (bIsWaiting)
+	if (!bPersistSessions)
 	{
-		return FReply::Handled();
+		return 0;
 	}
 
-	// 清空聊天记录，保留欢迎消息
-	ChatMessages.Empty();
-	ChatMessages.Add(MakeShared<FChatMessage>(TEXT("AI助手"), TEXT("您好！我是Deepseek AI助手，请问有什么可以帮助您的？"), false));
-
-	// 清空聊天历史，保留系统消息
-	ChatHistory.Empty();
-	ChatHistory.Add(FOpenAIMessage(TEXT("system"), CurrentSystemPrompt));
-
-	// 刷新列表
-	ChatListView->RequestListRefresh();
+	// 每个会话只读取索引和最后一页消息，最后一个会话处于选中状态
+	int32 NumRestored = 0;
+	for (const FString& LogPath : FDeepseekSessionLog::FindLogs())
+	{
+		TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = FDeepseekSessionLog::Open(LogPath);
+		if (Log.IsValid())
+		{
+			Log->CompactIfNeeded();
+			AddSession(CreateSession(Log));
+			++NumRestored;
+		}
+	}
+	return NumRestored;
+}
 
+FReply SDeepseekAIChat::OnSelectSession(TSharedRef<SDeepseekChatSession> Session)
+{
+	SessionSwitcher->SetActiveWidget(Session);
+	RefreshSessionTabs();
 	return FReply::Handled();
 }
 
-void SDeepseekAIChat::SendAIRequest(const FString& UserMessage)
+FReply SDeepseekAIChat::OnCloseSession(TSharedRef<SDeepseekChatSession> Session)
 {
-	// 添加用户消息到聊天历史
-	ChatHistory.Add(FOpenAIMessage(TEXT("user"), UserMessage));
+	// 关闭只卸载会话，记录保留在磁盘上，下次打开时恢复
+	RemoveSession(Session);
+	return FReply::Handled();
+}
 
-	// 添加等待消息
-	AddWaitingMessage();
+FReply SDeepseekAIChat::OnDeleteActiveSession()
+{
+	TSharedPtr<SDeepseekChatSession> Session = GetActiveSession();
+	if (!Session.IsValid())
+	{
+		return FReply::Handled();
+	}
 
-	// 发送请求
-	OpenAIService->SendChatRequest(ChatHistory, [this](const FString& Response, bool bSuccess)
+	// 删除不可恢复，先确认
+	const FText Message = FText::Format(FText::FromString(TEXT("永久删除会话“{0}”的聊天记录？此操作无法撤销。")), Session->GetTitle());
+	if (FMessageDialog::Open(EAppMsgType::YesNo, Message) != EAppReturnType::Yes)
 	{
-		// 在游戏线程中处理响应
-		AsyncTask(ENamedThreads::GameThread, [this, Response, bSuccess]()
-		{
-			HandleAIResponse(Response, bSuccess);
-		});
-	});
+		return FReply::Handled();
+	}
+
+	Session->DeleteLog();
+	RemoveSession(Session.ToSharedRef());
+	return FReply::Handled();
 }
 
-void SDeepseekAIChat::HandleAIResponse(const FString& Response, bool bSuccess)
+void SDeepseekAIChat::RemoveSession(TSharedRef<SDeepseekChatSession> Session)
 {
-	// 移除等待消息
-	RemoveWaitingMessage();
-
-	if (bSuccess)
+	// 会话销毁时其服务会取消未结束的请求
+	const bool bWasActive = SessionSwitcher->GetActiveWidget() == Session;
+	const int32 Index = Sessions.IndexOfByKey(Session);
+	Sessions.RemoveAt(Index);
+	SessionSwitcher->RemoveSlot(Session);
+
+	// 至少保留一个会话
+	if (Sessions.Num() == 0)
 	{
-		// 添加AI回复
-		ChatMessages.Add(MakeShared<FChatMessage>(TEXT("AI助手"), Response, false));
-
-		// 添加AI回复到聊天历史
-		ChatHistory.Add(FOpenAIMessage(TEXT("assistant"), Response));
+		OnNewSession();
+		return;
 	}
-	else
+
+	if (bWasActive)
 	{
-		// 添加错误消息
-		ChatMessages.Add(MakeShared<FChatMessage>(TEXT("系统"), FString::Printf(TEXT("错误: %s"), *Response), false));
+		SessionSwitcher->SetActiveWidget(Sessions[FMath::Min(Index, Sessions.Num() - 1)].ToSharedRef());
 	}
 
-	// 刷新列表
-	ChatListView->RequestListRefresh();
+	RefreshSessionTabs();
 }
 
-void SDeepseekAIChat::AddWaitingMessage()
+TSharedPtr<SDeepseekChatSession> SDeepseekAIChat::GetActiveSession() const
 {
-	bIsWaiting = true;
-
-	// 添加等待消息
-	TSharedPtr<FChatMessage> WaitingMessage = MakeShared<FChatMessage>(TEXT("AI助手"), TEXT("正在思考..."), false);
-	ChatMessages.Add(WaitingMessage);
-	WaitingMessageIndex = ChatMessages.Num() - 1;
+	const TSharedPtr<SWidget> ActiveWidget = SessionSwitcher->GetActiveWidget();
+	for (const TSharedPtr<SDeepseekChatSession>& Session : Sessions)
+	{
+		if (Session == ActiveWidget)
+		{
+			return Session;
+		}
+	}
+	return nullptr;
+}
 
-	// 刷新列表
-	ChatListView->RequestListRefresh();
+TSharedRef<SDeepseekChatSession> SDeepseekAIChat::CreateSession(TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log)
+{
+	return SNew(SDeepseekChatSession)
+		.Settings(Settings)
+		.Log(Log)
+		.OnStateChanged(this, &SDeepseekAIChat::RefreshSessionTabs);
 }
 
-void SDeepseekAIChat::RemoveWaitingMessage()
+void SDeepseekAIChat::RefreshSessionTabs()
 {
-	if (WaitingMessageIndex >= 0 && WaitingMessageIndex < ChatMessages.Num())
+	if (!SessionTabBar.IsValid())
 	{
-		ChatMessages.RemoveAt(WaitingMessageIndex);
-		WaitingMessageIndex = -1;
+		return;
 	}
 
-	bIsWaiting = false;
+	SessionTabBar->ClearChildren();
+
+	const TSharedPtr<SWidget> ActiveWidget = SessionSwitcher->GetActiveWidget();
+	for (const TSharedPtr<SDeepseekChatSession>& SessionPtr : Sessions)
+	{
+		TSharedRef<SDeepseekChatSession> Session = SessionPtr.ToSharedRef();
+		const bool bIsActive = ActiveWidget == SessionPtr;
+
+		// 等待回复的会话在标题后加标记
+		FString Title = Session->GetTitle().ToString();
+		if (Session->IsWaiting())
+		{
+			Title += TEXT(" …");
+		}
+
+		SessionTabBar->AddSlot()
+		.AutoWidth()
+		.Padding(0, 0, 4, 0)
+		[
+			SNew(SBorder)
+			.BorderImage(FEditorStyle::GetBrush(bIsActive ? "ToolPanel.DarkGroupBorder" : "NoBorder"))
+			.Padding(FMargin(2.0f))
+			[
+				SNew(SHorizontalBox)
+
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				[
+					SNew(SButton)
+					.Text(FText::FromString(Title))
+					.OnClicked(this, &SDeepseekAIChat::OnSelectSession, Session)
+				]
+
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				[
+					SNew(SButton)
+					.Text(FText::FromString(TEXT("×")))
+					.OnClicked(this, &SDeepseekAIChat::OnCloseSession, Session)
+				]
+			]
+		];
+	}
 }
 
 FReply SDeepseekAIChat::OnShowSettings()
 {
-	if (!bIsWaiting)
+	// 创建并显示设置窗口
+	TSharedRef<SWindow> SettingsWindowRef = CreateSettingsWindow();
+	SettingsWindow = SettingsWindowRef;
+
+	// 设置临时变量
+	TempApiKey = Settings->ApiKey;
+	TempApiUrl = Settings->ApiUrl;
+	TempModel = Settings->Model;
+	TempSystemPrompt = Settings->SystemPrompt;
+
+	// 更新设置窗口的值
+	ApiKeyTextBox->SetText(FText::FromString(TempApiKey));
+	ApiUrlTextBox->SetText(FText::FromString(TempApiUrl));
+	SystemPromptTextBox->SetText(FText::FromString(TempSystemPrompt));
+
+	// 更新模型选择
+	for (TSharedPtr<FModelInfo> ModelInfo : ModelList)
 	{
-		// 创建并显示设置窗口
-		TSharedRef<SWindow> SettingsWindowRef = CreateSettingsWindow();
-		SettingsWindow = SettingsWindowRef;
-
-		// 设置临时变量
-		TempApiKey = CurrentApiKey;
-		TempApiUrl = CurrentApiUrl;
-		TempModel = CurrentModel;
-		TempSystemPrompt = CurrentSystemPrompt;
-
-		// 更新设置窗口的值
-		ApiKeyTextBox->SetText(FText::FromString(TempApiKey));
-		ApiUrlTextBox->SetText(FText::FromString(TempApiUrl));
-		SystemPromptTextBox->SetText(FText::FromString(TempSystemPrompt));
-
-		// 更新模型选择
-		for (TSharedPtr<FModelInfo> ModelInfo : ModelList)
+		if (ModelInfo->Id == TempModel)
 		{
-			if (ModelInfo->Id == TempModel)
-			{
-				SelectedModel = ModelInfo;
-				ModelComboBox->SetSelectedItem(SelectedModel);
-				break;
-			}
+			SelectedModel = ModelInfo;
+			ModelComboBox->SetSelectedItem(SelectedModel);
+			break;
 		}
-
-		// 显示窗口
-		FSlateApplication::Get().AddModalWindow(SettingsWindow.ToSharedRef(), AsShared());
 	}
 
+	// 显示窗口
+	FSlateApplication::Get().AddModalWindow(SettingsWindow.ToSharedRef(), AsShared());
+
 	return FReply::Handled();
 }
 
@@ -496,36 +565,31 @@ FReply SDeepseekAIChat::OnApplySettings()
 	FString NewSystemPrompt = SystemPromptTextBox->GetText().ToString();
 
 	// 检查是否有变化
-	bool bHasChanges = (NewApiKey != CurrentApiKey) || (NewApiUrl != CurrentApiUrl) || (NewModel != CurrentModel) || (
-		NewSystemPrompt != CurrentSystemPrompt);
+	bool bHasChanges = (NewApiKey != Settings->ApiKey) || (NewApiUrl != Settings->ApiUrl) || (NewModel != Settings->Model) || (
+		NewSystemPrompt != Settings->SystemPrompt);
 
 	if (bHasChanges)
 	{
+		const bool bSystemPromptChanged = NewSystemPrompt != Settings->SystemPrompt;
+
 		// 更新当前设置
-		CurrentApiKey = NewApiKey;
-		CurrentApiUrl = NewApiUrl;
-		CurrentModel = NewModel;
-		CurrentSystemPrompt = NewSystemPrompt;
+		Settings->ApiKey = NewApiKey;
+		Settings->ApiUrl = NewApiUrl;
+		Settings->Model = NewModel;
+		Settings->SystemPrompt = NewSystemPrompt;
 
-		// 重新初始化OpenAI服务
-		OpenAIService->Initialize(CurrentApiKey, CurrentModel, CurrentApiUrl);
+		SaveSettings();
 
-		// 更新聊天历史中的系统消息
-		if (ChatHistory.Num() > 0 && ChatHistory[0].Role == TEXT("system"))
+		if (Settings->bPrewarmConnection)
 		{
-			ChatHistory[0].Content = CurrentSystemPrompt;
+			FDeepseekOpenAIService::PrewarmConnection(Settings->ApiUrl);
 		}
-		else
+
+		// 所有会话共用设置，逐个重新初始化
+		for (const TSharedPtr<SDeepseekChatSession>& Session : Sessions)
 		{
-			// 如果没有系统消息，添加一个
-			ChatHistory.Insert(FOpenAIMessage(TEXT("system"), CurrentSystemPrompt), 0);
+			Session->ApplySettings(bSystemPromptChanged);
 		}
-
-		SaveSettings();
-
-		// 添加系统消息
-		ChatMessages.Add(MakeShared<FChatMessage>(TEXT("系统"), TEXT("设置已更新并保存"), false));
-		ChatListView->RequestListRefresh();
 	}
 
 	// 关闭设置窗口
@@ -565,60 +629,6 @@ TSharedRef<SWidget> SDeepseekAIChat::GenerateModelComboItem(TSharedPtr<FModelInf
 		.Text(FText::FromString(InItem->Name));
 }
 
-TSharedRef<ITableRow> SDeepseekAIChat::OnGenerateRow(TSharedPtr<FChatMessage> Message,
-                                                     const TSharedRef<STableViewBase>& OwnerTable)
-{
-	// 根据消息发送者设置不同的样式
-	const FSlateBrush* BubbleBrush = Message->bIsUser
-		                                 ? FEditorStyle::GetBrush("ToolPanel.GroupBorder")
-		                                 : FEditorStyle::GetBrush("ToolPanel.DarkGroupBorder");
-
-	EHorizontalAlignment HAlign = Message->bIsUser ? HAlign_Right : HAlign_Left;
-
-	return SNew(STableRow<TSharedPtr<FChatMessage>>, OwnerTable)
-		.Padding(FMargin(4.0f))
-		.ShowSelection(false)
-		[
-			SNew(SHorizontalBox)
-
-			// 用户消息靠右，AI消息靠左
-			+ SHorizontalBox::Slot()
-			.FillWidth(1.0f)
-			.HAlign(HAlign)
-			[
-				SNew(SBox)
-				.MaxDesiredWidth(500.0f)
-				[
-					SNew(SBorder)
-					.BorderImage(BubbleBrush)
-					.Padding(FMargin(10.0f))
-					[
-						SNew(SVerticalBox)
-
-						// 发送者名称
-						+ SVerticalBox::Slot()
-						.AutoHeight()
-						.Padding(0, 0, 0, 5)
-						[
-							SNew(STextBlock)
-							.Text(FText::FromString(Message->Sender))
-							.Font(FEditorStyle::GetFontStyle("BoldFont"))
-						]
-
-						// 消息内容
-						+ SVerticalBox::Slot()
-						.AutoHeight()
-						[
-							SNew(STextBlock)
-							.Text(FText::FromString(Message->Message))
-							.AutoWrapText(true)
-						]
-					]
-				]
-			]
-		];
-}
-
 void SDeepseekAIChat::OnSettingsWindowClosed(const TSharedRef<SWindow>& Window)
 {
 	SettingsWindow.Reset();
@@ -630,28 +640,42 @@ void SDeepseekAIChat::SaveSettings()
 	GConfig->SetString(
 		TEXT("DeepseekAISettings"),
 		TEXT("ApiKey"),
-		*CurrentApiKey,
+		*Settings->ApiKey,
 		GEngineIni
 	);
 
 	GConfig->SetString(
 		TEXT("DeepseekAISettings"),
 		TEXT("ApiUrl"),
-		*CurrentApiUrl,
+		*Settings->ApiUrl,
 		GEngineIni
 	);
 
 	GConfig->SetString(
 		TEXT("DeepseekAISettings"),
 		TEXT("Model"),
-		*CurrentModel,
+		*Settings->Model,
 		GEngineIni
 	);
 
 	GConfig->SetString(
 		TEXT("DeepseekAISettings"),
 		TEXT("SystemPrompt"),
-		*CurrentSystemPrompt,
+		*Settings->SystemPrompt,
+		GEngineIni
+	);
+
+	GConfig->SetInt(
+		TEXT("DeepseekAISettings"),
+		TEXT("MaxContextTokens"),
+		Settings->MaxContextTokens,
+		GEngineIni
+	);
+
+	GConfig->SetInt(
+		TEXT("DeepseekAISettings"),
+		TEXT("MaxTokens"),
+		Settings->MaxTokens,
 		GEngineIni
 	);
 
@@ -670,7 +694,7 @@ void SDeepseekAIChat::LoadSettings()
 		GEngineIni
 	))
 	{
-		CurrentApiKey = LoadedApiKey;
+		Settings->ApiKey = LoadedApiKey;
 	}
 
 	FString LoadedApiUrl;
@@ -681,12 +705,12 @@ void SDeepseekAIChat::LoadSettings()
 		GEngineIni
 	))
 	{
-		CurrentApiUrl = LoadedApiUrl;
+		Settings->ApiUrl = LoadedApiUrl;
 	}
-	else if (CurrentApiUrl.IsEmpty())
+	else if (Settings->ApiUrl.IsEmpty())
 	{
 		// 如果没有保存过且当前为空，设置默认值
-		CurrentApiUrl = TEXT("https://api.deepseek.com/chat/completions");
+		Settings->ApiUrl = TEXT("https://api.deepseek.com/chat/completions");
 	}
 
 	FString LoadedModel;
@@ -697,12 +721,12 @@ void SDeepseekAIChat::LoadSettings()
 		GEngineIni
 	))
 	{
-		CurrentModel = LoadedModel;
+		Settings->Model = LoadedModel;
 	}
-	else if (CurrentModel.IsEmpty())
+	else if (Settings->Model.IsEmpty())
 	{
 		// 如果没有保存过且当前为空，设置默认值
-		CurrentModel = TEXT("deepseek-chat");
+		Settings->Model = TEXT("deepseek-chat");
 	}
 
 	FString LoadedSystemPrompt;
@@ -713,13 +737,96 @@ void SDeepseekAIChat::LoadSettings()
 		GEngineIni
 	))
 	{
-		CurrentSystemPrompt = LoadedSystemPrompt;
+		Settings->SystemPrompt = LoadedSystemPrompt;
 	}
-	else if (CurrentSystemPrompt.IsEmpty())
+	else if (Settings->SystemPrompt.IsEmpty())
 	{
 		// 如果没有保存过且当前为空，设置默认值
-		CurrentSystemPrompt = TEXT("你是一个有用的AI助手，由Deepseek团队开发。请用中文回答问题，保持回答简洁明了。");
+		Settings->SystemPrompt = TEXT("你是一个有用的AI助手，由Deepseek团队开发。请用中文回答问题，保持回答简洁明了。");
 	}
+
+	// 上下文预算只在配置文件中调整
+	GConfig->GetInt(
+		TEXT("DeepseekAISettings"),
+		TEXT("MaxContextTokens"),
+		Settings->MaxContextTokens,
+		GEngineIni
+	);
+
+	GConfig->GetInt(
+		TEXT("DeepseekAISettings"),
+		TEXT("MaxTokens"),
+		Settings->MaxTokens,
+		GEngineIni
+	);
+
+	// 历史压缩的阈值与模型，阈值为0时关闭压缩
+	GConfig->GetInt(
+		TEXT("DeepseekAISettings"),
+		TEXT("CompactThresholdTokens"),
+		Settings->CompactThresholdTokens,
+		GEngineIni
+	);
+
+	GConfig->GetString(
+		TEXT("DeepseekAISettings"),
+		TEXT("CompactModel"),
+		Settings->CompactModel,
+		GEngineIni
+	);
+
+	// 前缀稳定模式
+	GConfig->GetBool(
+		TEXT("DeepseekAISettings"),
+		TEXT("PrefixStableHistory"),
+		Settings->bPrefixStableHistory,
+		GEngineIni
+	);
+
+	// 超时与重试
+	GConfig->GetFloat(
+		TEXT("DeepseekAISettings"),
+		TEXT("RequestTimeoutSeconds"),
+		Settings->RequestTimeoutSeconds,
+		GEngineIni
+	);
+
+	GConfig->GetFloat(
+		TEXT("DeepseekAISettings"),
+		TEXT("FirstByteTimeoutSeconds"),
+		Settings->FirstByteTimeoutSeconds,
+		GEngineIni
+	);
+
+	GConfig->GetInt(
+		TEXT("DeepseekAISettings"),
+		TEXT("MaxRetries"),
+		Settings->MaxRetries,
+		GEngineIni
+	);
+
+	// 连接复用与预热
+	GConfig->GetBool(
+		TEXT("DeepseekAISettings"),
+		TEXT("KeepAlive"),
+		Settings->bKeepAlive,
+		GEngineIni
+	);
+
+	GConfig->GetBool(
+		TEXT("DeepseekAISettings"),
+		TEXT("PrewarmConnection"),
+		Settings->bPrewarmConnection,
+		GEngineIni
+	);
+
+	// 响应缓存容量
+	GConfig->GetInt(
+		TEXT("DeepseekAISettings"),
+		TEXT("ResponseCacheMaxMB"),
+		CurrentResponseCacheMaxMB,
+		GEngineIni
+	);
 }
 
 END_SLATE_FUNCTION_BUILD_OPTIMIZATION
@@ -0,0 +1,1044 @@
+#include "SDeepseekChatSession.h"
+#include "SlateOptMacros.h"
+#include "Widgets/Layout/SBox.h"
+#include "Widgets/Layout/SBorder.h"
+#include "Widgets/Text/STextBlock.h"
+#include "Widgets/Views/STableRow.h"
+#include "SDeepseekStreamingText.h"
+#include "DeepseekHistoryCompactor.h"
+#include "DeepseekTokenizer.h"
+#include "DeepseekResponseCache.h"
+#include "DeepseekUsageLedger.h"
+#include "Styling/SlateTypes.h"
+#include "EditorStyleSet.h"
+
+BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
+
+/** 欢迎消息 */
+static const TCHAR* WelcomeMessage = TEXT("您好！我是Deepseek AI助手，请问有什么可以帮助您的？");
+
+/** 从会话记录中每次载入的消息数 */
+static const int32 LogPageSize = 50;
+
+/**
+ * 历史压缩的阈值
+ * 摘要替换旧轮次会改写已发送的前缀，前缀稳定模式下推迟到历史接近上下文预算时才压缩：
+ * 此时窗口本来就要丢弃开头的消息，摘要在窗口移动之前替换它们，前缀在每次填满预算时只改变一次
+ */
+static int32 GetCompactThreshold(const FDeepseekChatSettings& Settings)
+{
+	if (!Settings.bPrefixStableHistory || Settings.CompactThresholdTokens <= 0)
+	{
+		return Settings.CompactThresholdTokens;
+	}
+
+	const int32 Budget = FMath::Max(0, Settings.MaxContextTokens - Settings.MaxTokens);
+	return FMath::Max(Settings.CompactThresholdTokens, Budget * 9 / 10);
+}
+
+void SDeepseekChatSession::Construct(const FArguments& InArgs)
+{
+	Settings = InArgs._Settings;
+	OnStateChanged = InArgs._OnStateChanged;
+	Log = InArgs._Log;
+	check(Settings.IsValid());
+
+	// 初始化变量
+	bIsWaiting = false;
+	WaitingMessageIndex = -1;
+	bAutoScrollToBottom = true;
+	bSystemPromptPending = false;
+	bBypassCache = false;
+	LogLoadedFirst = 0;
+	LastPromptCacheHitTokens = 0;
+	LastPromptCacheMissTokens = 0;
+	TotalPromptCacheHitTokens = 0;
+	TotalPromptCacheMissTokens = 0;
+
+	// 创建OpenAI服务，每个会话一个实例，请求在调度器中按会话排队
+	OpenAIService = MakeShared<FDeepseekOpenAIService>();
+	OpenAIService->Initialize(Settings->ApiKey, Settings->Model, Settings->ApiUrl);
+	OpenAIService->SetContextBudget(Settings->MaxContextTokens, Settings->MaxTokens);
+	OpenAIService->SetTimeouts(Settings->RequestTimeoutSeconds, Settings->FirstByteTimeoutSeconds);
+	OpenAIService->SetMaxRetries(Settings->MaxRetries);
+	OpenAIService->SetKeepAlive(Settings->bKeepAlive);
+
+	// 创建历史压缩器，使用单独的低成本模型
+	HistoryCompactor = MakeShared<FDeepseekHistoryCompactor>();
+	HistoryCompactor->Initialize(Settings->ApiKey, Settings->CompactModel, Settings->ApiUrl);
+	HistoryCompactor->SetThreshold(GetCompactThreshold(*Settings));
+
+	// 创建聊天列表视图
+	ChatListView = SNew(SListView<TSharedPtr<FChatMessage>>)
+		.ListItemsSource(&ChatMessages)
+		.OnGenerateRow(this, &SDeepseekChatSession::OnGenerateRow)
+		.OnListViewScrolled(this, &SDeepseekChatSession::OnChatListScrolled)
+		.SelectionMode(ESelectionMode::None)
+		.AlwaysShowScrollbar(true);
+
+	// 添加欢迎消息
+	ChatMessages.Add(MakeShared<FChatMessage>(TEXT("AI助手"), MessageStore.Add(WelcomeMessage), false));
+
+	// 添加系统消息到聊天历史
+	ChatHistory.Add(FOpenAIMessage(TEXT("system"), MessageStore.Add(Settings->SystemPrompt)));
+
+	// 恢复上次保存的消息
+	if (Log.IsValid())
+	{
+		RestoreFromLog();
+	}
+
+	ChildSlot
+	[
+		SNew(SVerticalBox)
+
+		// 聊天记录区域
+		+ SVerticalBox::Slot()
+		.FillHeight(1.0f)
+		.Padding(0, 0, 0, 10)
+		[
+			SNew(SBorder)
+			.BorderImage(FEditorStyle::GetBrush("ToolPanel.DarkGroupBorder"))
+			.Padding(FMargin(4.0f))
+			[
+				// 列表视图自身负责滚动，只为可见的消息生成行
+				ChatListView.ToSharedRef()
+			]
+		]
+
+		// 输入区域
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		[
+			SNew(SHorizontalBox)
+
+			// 输入框
+			+ SHorizontalBox::Slot()
+			.FillWidth(1.0f)
+			.Padding(0, 0, 5, 0)
+			[
+				SAssignNew(InputTextBox, SEditableTextBox)
+				.HintText(FText::FromString(TEXT("请输入您的问题...")))
+				.OnTextCommitted_Lambda([this](const FText& Text, ETextCommit::Type CommitType)
+				{
+					if (CommitType == ETextCommit::OnEnter && !Text.IsEmpty() && !bIsWaiting)
+					{
+						OnSendMessage();
+					}
+				})
+				.OnTextChanged_Lambda([this](const FText& Text)
+				{
+					BudgetConfirmedMessage.Reset();
+					UpdateTokenEstimate();
+				})
+			]
+
+			// 发送按钮
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(0, 0, 5, 0)
+			[
+				SNew(SButton)
+				.Text(FText::FromString(TEXT("发送")))
+				.IsEnabled_Lambda([this]() { return !bIsWaiting; })
+				.OnClicked(this, &SDeepseekChatSession::OnSendMessage)
+			]
+
+			// 停止按钮
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(0, 0, 5, 0)
+			[
+				SNew(SButton)
+				.Text(FText::FromString(TEXT("停止")))
+				.IsEnabled_Lambda([this]() { return ActiveRequest.IsActive(); })
+				.OnClicked(this, &SDeepseekChatSession::OnStopRequest)
+			]
+
+			// 清空按钮
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			[
+				SNew(SButton)
+				.Text(FText::FromString(TEXT("清空")))
+				.IsEnabled_Lambda([this]() { return !bIsWaiting; })
+				.OnClicked(this, &SDeepseekChatSession::OnClearChat)
+			]
+		]
+
+		// 发送前预估的token数
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(0, 4, 0, 0)
+		[
+			SNew(STextBlock)
+			.Text(this, &SDeepseekChatSession::GetTokenEstimateText)
+			.ColorAndOpacity(FSlateColor::UseSubduedForeground())
+		]
+
+		// 响应缓存开关与命中统计
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(0, 4, 0, 0)
+		[
+			SNew(SHorizontalBox)
+
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(0, 0, 10, 0)
+			[
+				SNew(SCheckBox)
+				.IsChecked_Lambda([this]()
+				{
+					return bBypassCache ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+				})
+				.OnCheckStateChanged_Lambda([this](ECheckBoxState NewState)
+				{
+					bBypassCache = NewState == ECheckBoxState::Checked;
+				})
+				[
+					SNew(STextBlock)
+					.Text(FText::FromString(TEXT("跳过缓存")))
+				]
+			]
+
+			+ SHorizontalBox::Slot()
+			.FillWidth(1.0f)
+			.VAlign(VAlign_Center)
+			[
+				SNew(STextBlock)
+				.Text(this, &SDeepseekChatSession::GetCacheStatsText)
+				.ColorAndOpacity(FSlateColor::UseSubduedForeground())
+			]
+		]
+	];
+
+	UpdateTokenEstimate();
+	UpdateCacheStats();
+}
+
+void SDeepseekChatSession::ApplySettings(bool bSystemPromptChanged)
+{
+	// 重新初始化OpenAI服务
+	OpenAIService->Initialize(Settings->ApiKey, Settings->Model, Settings->ApiUrl);
+	OpenAIService->SetTimeouts(Settings->RequestTimeoutSeconds, Settings->FirstByteTimeoutSeconds);
+	OpenAIService->SetMaxRetries(Settings->MaxRetries);
+	OpenAIService->SetKeepAlive(Settings->bKeepAlive);
+	HistoryCompactor->Initialize(Settings->ApiKey, Settings->CompactModel, Settings->ApiUrl);
+	HistoryCompactor->SetThreshold(GetCompactThreshold(*Settings));
+
+	// 等待回复期间不改动历史，回复到达后再写入
+	if (bSystemPromptChanged)
+	{
+		bSystemPromptPending = true;
+		if (!bIsWaiting)
+		{
+			ApplySystemPromptToHistory();
+		}
+	}
+
+	// 添加系统消息
+	ChatMessages.Add(MakeShared<FChatMessage>(TEXT("系统"), MessageStore.Add(TEXT("设置已更新并保存")), false));
+	ChatListView->RequestListRefresh();
+	ScrollChatToBottom();
+	UpdateTokenEstimate();
+}
+
+void SDeepseekChatSession::ApplySystemPromptToHistory()
+{
+	if (!bSystemPromptPending)
+	{
+		return;
+	}
+	bSystemPromptPending = false;
+
+	// 前缀稳定模式下已有对话时追加一条系统消息，已发送的前缀保持不变，服务端前缀缓存继续有效
+	if (Settings->bPrefixStableHistory && ChatHistory.Num() > 1 && ChatHistory[0].Role == TEXT("system"))
+	{
+		ChatHistory.Add(FOpenAIMessage(TEXT("system"), MessageStore.Add(FString::Printf(TEXT("系统提示词已更新，之后的回答请遵循：\n%s"), *Settings->SystemPrompt))));
+	}
+	// 更新聊天历史中的系统消息，整体替换以清除缓存的token数
+	else if (ChatHistory.Num() > 0 && ChatHistory[0].Role == TEXT("system"))
+	{
+		ChatHistory[0] = FOpenAIMessage(TEXT("system"), MessageStore.Add(Settings->SystemPrompt));
+	}
+	else
+	{
+		// 如果没有系统消息，添加一个
+		ChatHistory.Insert(FOpenAIMessage(TEXT("system"), MessageStore.Add(Settings->SystemPrompt)), 0);
+	}
+}
+
+FText SDeepseekChatSession::GetTitle() const
+{
+	// 聊天历史只有最近的部分，标题单独保存
+	if (!TitleSource.IsEmpty())
+	{
+		const FString Title = TitleSource.Replace(TEXT("\n"), TEXT(" ")).TrimStartAndEnd();
+		return FText::FromString(Title.Len() > 12 ? Title.Left(12) + TEXT("...") : Title);
+	}
+
+	return FText::FromString(TEXT("新会话"));
+}
+
+void SDeepseekChatSession::AppendMessages(const TArray<TSharedPtr<FChatMessage>>& Messages)
+{
+	ChatMessages.Reserve(ChatMessages.Num() + Messages.Num());
+	for (const TSharedPtr<FChatMessage>& Message : Messages)
+	{
+		ChatMessages.Add(Message);
+		if (!Message->bIsSuggestion)
+		{
+			ChatHistory.Add(FOpenAIMessage(Message->bIsUser ? TEXT("user") : TEXT("assistant"), Message->Message));
+		}
+		if (Message->bIsUser && TitleSource.IsEmpty())
+		{
+			TitleSource = Message->Message.ToString();
+		}
+	}
+
+	ChatListView->RequestListRefresh();
+	ScrollChatToBottom();
+	UpdateTokenEstimate();
+	OnStateChanged.ExecuteIfBound();
+}
+
+void SDeepseekChatSession::BeginSimulatedReply()
+{
+	if (!bIsWaiting)
+	{
+		AddWaitingMessage();
+	}
+}
+
+void SDeepseekChatSession::AppendSimulatedDelta(const FString& Delta)
+{
+	HandleAIDelta(Delta);
+}
+
+void SDeepseekChatSession::EndSimulatedReply()
+{
+	if (!ChatMessages.IsValidIndex(WaitingMessageIndex))
+	{
+		return;
+	}
+
+	// 与完整收到流式回复时相同：等待消息转为回复，显示中的文本保留
+	ChatMessages[WaitingMessageIndex]->Message = MessageStore.Add(StreamingContent);
+	WaitingMessageIndex = -1;
+	RemoveWaitingMessage();
+	ScrollChatToBottom();
+}
+
+FReply SDeepseekChatSession::OnSendMessage()
+{
+	if (bIsWaiting)
+	{
+		return FReply::Handled();
+	}
+
+	FString UserMessage = InputTextBox->GetText().ToString();
+
+	if (!UserMessage.IsEmpty())
+	{
+		// 请求过大或将超出每日预算时先提醒，再次点击发送才发出
+		FString BudgetWarning;
+		FDeepseekUsageLedger* Ledger = FDeepseekUsageLedger::Get();
+		if (Ledger != nullptr && UserMessage != BudgetConfirmedMessage
+			&& Ledger->CheckRequest(Settings->Model, OpenAIService->EstimatePromptTokens(ChatHistory, UserMessage), Settings->MaxTokens, BudgetWarning))
+		{
+			BudgetConfirmedMessage = UserMessage;
+			TokenEstimateText = FText::FromString(BudgetWarning + TEXT("，再次点击发送以确认"));
+			return FReply::Handled();
+		}
+		BudgetConfirmedMessage.Reset();
+
+		// 添加用户消息，聊天记录与聊天历史引用同一份文本
+		const FDeepseekMessageText UserText = MessageStore.Add(UserMessage);
+		ChatMessages.Add(MakeShared<FChatMessage>(TEXT("用户"), UserText, true));
+		LogMessage(FDeepseekSessionLog::ERole::User, *ChatMessages.Last());
+		if (TitleSource.IsEmpty())
+		{
+			TitleSource = UserMessage;
+		}
+
+		// 清空输入框
+		InputTextBox->SetText(FText::GetEmpty());
+
+		// 刷新列表，用户发送消息后总是回到底部
+		ChatListView->RequestListRefresh();
+		bAutoScrollToBottom = true;
+		ScrollChatToBottom();
+
+		// 发送AI请求
+		SendAIRequest(UserText);
+	}
+
+	return FReply::Handled();
+}
+
+FReply SDeepseekChatSession::OnStopRequest()
+{
+	if (!ActiveRequest.IsActive())
+	{
+		return FReply::Handled();
+	}
+
+	// 断开连接，之后不会再收到回调
+	ActiveRequest.Cancel();
+	RemoveWaitingMessage();
+
+	// 未得到回答的提问从历史中移除，避免连续两条用户消息
+	if (ChatHistory.Num() > 0 && ChatHistory.Last().Role == TEXT("user"))
+	{
+		ChatHistory.Pop();
+	}
+	ApplySystemPromptToHistory();
+
+	ChatMessages.Add(MakeShared<FChatMessage>(TEXT("系统"), MessageStore.Add(TEXT("已停止请求")), false));
+	LogMessage(FDeepseekSessionLog::ERole::Notice, *ChatMessages.Last());
+	ChatListView->RequestListRefresh();
+	ScrollChatToBottom();
+	UpdateTokenEstimate();
+
+	return FReply::Handled();
+}
+
+FReply SDeepseekChatSession::OnClearChat()
+{
+	if (bIsWaiting)
+	{
+		return FReply::Handled();
+	}
+
+	// 清空聊天记录，保留欢迎消息；旧的文本块在引用释放后回收
+	ChatMessages.Empty();
+	MessageStore.Reset();
+	ChatMessages.Add(MakeShared<FChatMessage>(TEXT("AI助手"), MessageStore.Add(WelcomeMessage), false));
+
+	// 清空聊天历史，保留系统消息
+	ChatHistory.Empty();
+	ChatHistory.Add(FOpenAIMessage(TEXT("system"), MessageStore.Add(Settings->SystemPrompt)));
+	bSystemPromptPending = false;
+	OpenAIService->ResetContext();
+	HistoryCompactor->Cancel();
+	TitleSource.Reset();
+
+	// 记录中只追加一条清空记录，旧消息在后台压缩时丢弃
+	LogLoadedFirst = 0;
+	if (Log.IsValid())
+	{
+		Log->AppendClear();
+		Log->CompactIfNeeded();
+	}
+
+	// 刷新列表
+	ChatListView->RequestListRefresh();
+	UpdateTokenEstimate();
+	OnStateChanged.ExecuteIfBound();
+
+	return FReply::Handled();
+}
+
+void SDeepseekChatSession::SendAIRequest(const FDeepseekMessageText& UserMessage)
+{
+	// 添加用户消息到聊天历史
+	ChatHistory.Add(FOpenAIMessage(TEXT("user"), UserMessage));
+
+	// 近似的问题之前回答过时先给出历史回答，完全相同的问题交给精确缓存
+	FString SimilarReply;
+	int32 Distance = 0;
+	if (!bBypassCache && OpenAIService->FindSimilarReply(ChatHistory, SimilarReply, Distance))
+	{
+		ShowSuggestion(SimilarReply);
+		return;
+	}
+
+	StartAIRequest();
+}
+
+void SDeepseekChatSession::StartAIRequest()
+{
+	// 添加等待消息
+	AddWaitingMessage();
+	UpdateTokenEstimate();
+
+	// 用户正在等待的提问排在后台任务之前
+	FDeepseekRequestOptions Options;
+	Options.bBypassCache = bBypassCache;
+	Options.Priority = EDeepseekRequestPriority::Interactive;
+
+	// 发送流式请求，增量内容到达后立即显示；服务在后台解码，回调已在游戏线程
+	// 缓存命中时回调在此调用内同步执行，返回的句柄为空
+	TWeakPtr<SDeepseekChatSession> WeakThis = SharedThis(this);
+	ActiveRequest = OpenAIService->SendChatStreamRequest(ChatHistory, [WeakThis](const FString& Delta)
+	{
+		TSharedPtr<SDeepseekChatSession> This = WeakThis.Pin();
+		if (This.IsValid())
+		{
+			This->HandleAIDelta(Delta);
+		}
+	}, [WeakThis](const FDeepseekChatReplyRef& Reply)
+	{
+		TSharedPtr<SDeepseekChatSession> This = WeakThis.Pin();
+		if (This.IsValid())
+		{
+			This->ActiveRequest.Reset();
+			This->HandleAIResponse(Reply);
+		}
+	}, Options);
+}
+
+void SDeepseekChatSession::ShowSuggestion(const FString& SuggestedReply)
+{
+	// 用户确认之前不接受新的输入
+	SetWaiting(true);
+
+	SuggestionMessage = MakeShared<FChatMessage>(TEXT("AI助手（相似问题的历史回答）"), MessageStore.Add(SuggestedReply), false);
+	SuggestionMessage->bIsSuggestion = true;
+	ChatMessages.Add(SuggestionMessage);
+
+	ChatListView->RequestListRefresh();
+	ScrollChatToBottom();
+	UpdateCacheStats();
+	UpdateTokenEstimate();
+}
+
+FReply SDeepseekChatSession::OnAcceptSuggestion()
+{
+	if (!SuggestionMessage.IsValid())
+	{
+		return FReply::Handled();
+	}
+
+	// 历史回答转为普通回复，与请求得到的回复一样加入聊天历史
+	SuggestionMessage->Sender = TEXT("AI助手");
+	SuggestionMessage->bIsSuggestion = false;
+	ChatHistory.Add(FOpenAIMessage(TEXT("assistant"), SuggestionMessage->Message));
+	LogMessage(FDeepseekSessionLog::ERole::Assistant, *SuggestionMessage);
+	SuggestionMessage.Reset();
+	SetWaiting(false);
+	ApplySystemPromptToHistory();
+
+	ChatListView->RebuildList();
+	ScrollChatToBottom();
+	CompactHistoryIfNeeded();
+	UpdateTokenEstimate();
+
+	return FReply::Handled();
+}
+
+FReply SDeepseekChatSession::OnRefreshSuggestion()
+{
+	if (!SuggestionMessage.IsValid())
+	{
+		return FReply::Handled();
+	}
+
+	ChatMessages.Remove(SuggestionMessage);
+	SuggestionMessage.Reset();
+	SetWaiting(false);
+
+	StartAIRequest();
+
+	return FReply::Handled();
+}
+
+void SDeepseekChatSession::HandleAIDelta(const FString& Delta)
+{
+	if (!bIsWaiting)
+	{
+		return;
+	}
+
+	StreamingContent.Append(Delta);
+
+	// 只把增量交给正在显示的文本，不刷新整个列表
+	TSharedPtr<SDeepseekStreamingText> StreamingText = StreamingTextWidget.Pin();
+	if (StreamingText.IsValid())
+	{
+		StreamingText->AppendText(Delta);
+	}
+
+	// 回复变长时保持停留在底部
+	ScrollChatToBottom();
+}
+
+void SDeepseekChatSession::HandleAIResponse(const FDeepseekChatReplyRef& Reply)
+{
+	const FString& Response = Reply->Content;
+	const bool bSuccess = Reply->bSuccess;
+
+	// 缓存命中的回复没有usage，不计入前缀缓存统计
+	const FOpenAIUsage& Usage = Reply->Usage;
+	if (Usage.PromptCacheHitTokens + Usage.PromptCacheMissTokens > 0)
+	{
+		LastPromptCacheHitTokens = Usage.PromptCacheHitTokens;
+		LastPromptCacheMissTokens = Usage.PromptCacheMissTokens;
+		TotalPromptCacheHitTokens += Usage.PromptCacheHitTokens;
+		TotalPromptCacheMissTokens += Usage.PromptCacheMissTokens;
+	}
+	if (Reply->Timings.IsValid())
+	{
+		LastTimings = Reply->Timings;
+	}
+	UpdateCacheStats();
+
+	if (bSuccess && ChatMessages.IsValidIndex(WaitingMessageIndex))
+	{
+		// 流式内容已经显示在等待消息中，直接将其转为AI回复
+		const bool bStreamedAll = StreamingContent.Len() == Response.Len();
+		const FDeepseekMessageText ResponseText = MessageStore.Add(Response);
+		ChatMessages[WaitingMessageIndex]->Message = ResponseText;
+		LogMessage(FDeepseekSessionLog::ERole::Assistant, *ChatMessages[WaitingMessageIndex]);
+		WaitingMessageIndex = -1;
+		RemoveWaitingMessage();
+
+		// 添加AI回复到聊天历史
+		ChatHistory.Add(FOpenAIMessage(TEXT("assistant"), ResponseText));
+		ApplySystemPromptToHistory();
+
+		// 输出中途停滞被中断，保留已收到的部分并提示
+		if (Reply->FinishReason == TEXT("timeout"))
+		{
+			ChatMessages.Add(MakeShared<FChatMessage>(TEXT("系统"), MessageStore.Add(TEXT("回复长时间没有新的输出，已中断，以上为已收到的部分")), false));
+			LogMessage(FDeepseekSessionLog::ERole::Notice, *ChatMessages.Last());
+			ChatListView->RequestListRefresh();
+		}
+
+		if (!bStreamedAll)
+		{
+			ChatListView->RebuildList();
+		}
+		ScrollChatToBottom();
+		CompactHistoryIfNeeded();
+		UpdateTokenEstimate();
+		return;
+	}
+
+	// 移除等待消息
+	RemoveWaitingMessage();
+
+	if (bSuccess)
+	{
+		// 添加AI回复
+		const FDeepseekMessageText ResponseText = MessageStore.Add(Response);
+		ChatMessages.Add(MakeShared<FChatMessage>(TEXT("AI助手"), ResponseText, false));
+		LogMessage(FDeepseekSessionLog::ERole::Assistant, *ChatMessages.Last());
+
+		// 添加AI回复到聊天历史
+		ChatHistory.Add(FOpenAIMessage(TEXT("assistant"), ResponseText));
+		CompactHistoryIfNeeded();
+	}
+	else
+	{
+		// 添加错误消息
+		ChatMessages.Add(MakeShared<FChatMessage>(TEXT("系统"), MessageStore.Add(FString::Printf(TEXT("错误: %s"), *Response)), false));
+		LogMessage(FDeepseekSessionLog::ERole::Notice, *ChatMessages.Last());
+	}
+	ApplySystemPromptToHistory();
+
+	// 刷新列表
+	ChatListView->RequestListRefresh();
+	ScrollChatToBottom();
+	UpdateTokenEstimate();
+}
+
+void SDeepseekChatSession::CompactHistoryIfNeeded()
+{
+	TWeakPtr<SDeepseekChatSession> WeakThis = SharedThis(this);
+	HistoryCompactor->MaybeCompact(ChatHistory, [WeakThis](int32 NumFolded, const FString& Summary)
+	{
+		TSharedPtr<SDeepseekChatSession> This = WeakThis.Pin();
+		if (!This.IsValid())
+		{
+			return;
+		}
+
+		// 摘要在两轮之间一次性替换旧轮次，显示的聊天记录保持不变
+		FDeepseekHistoryCompactor::ApplySummary(This->ChatHistory, NumFolded, Summary);
+
+		// 历史下标已变化，窗口需要重新选择
+		This->OpenAIService->ResetContext();
+		This->UpdateTokenEstimate();
+	});
+}
+
+void SDeepseekChatSession::UpdateTokenEstimate()
+{
+	const FString PendingMessage = InputTextBox.IsValid() ? InputTextBox->GetText().ToString() : FString();
+	const int32 PromptTokens = OpenAIService->EstimatePromptTokens(ChatHistory, PendingMessage);
+	TokenEstimateText = FText::FromString(FString::Printf(TEXT("预计发送约 %d tokens（上下文上限 %d，回复预留 %d）"),
+		PromptTokens, Settings->MaxContextTokens, Settings->MaxTokens));
+}
+
+FText SDeepseekChatSession::GetTokenEstimateText() const
+{
+	return TokenEstimateText;
+}
+
+void SDeepseekChatSession::UpdateCacheStats()
+{
+	FString StatsString;
+
+	const FDeepseekResponseCache* ResponseCache = FDeepseekResponseCache::Get();
+	if (ResponseCache != nullptr)
+	{
+		const FDeepseekResponseCache::FStats& Stats = ResponseCache->GetStats();
+		StatsString = FString::Printf(TEXT("缓存命中 %d / 未命中 %d / 相似 %d（%d 条，%.1f MB）"),
+			Stats.Hits, Stats.Misses, Stats.SimilarHits, Stats.NumEntries, Stats.TotalBytes / (1024.0 * 1024.0));
+	}
+
+	// 服务端前缀缓存命中率，来自回复的usage
+	const int64 TotalPromptTokens = TotalPromptCacheHitTokens + TotalPromptCacheMissTokens;
+	if (TotalPromptTokens > 0)
+	{
+		const int32 LastPromptTokens = LastPromptCacheHitTokens + LastPromptCacheMissTokens;
+		StatsString += FString::Printf(TEXT("  前缀缓存命中率 本次 %.0f%% / 累计 %.0f%%，前缀改变 %d 次"),
+			LastPromptTokens > 0 ? 100.0 * LastPromptCacheHitTokens / LastPromptTokens : 0.0,
+			100.0 * TotalPromptCacheHitTokens / TotalPromptTokens,
+			OpenAIService->GetPrefixBreaks());
+	}
+
+	// 连接时间接近0说明复用了已有连接
+	if (LastTimings.IsValid())
+	{
+		StatsString += FString::Printf(TEXT("  上次请求 连接 %.0f ms / 服务端 %.0f ms / 首token %.0f ms / 传输 %.0f ms"),
+			LastTimings.ConnectSeconds * 1000.0, LastTimings.ServerSeconds * 1000.0, LastTimings.FirstTokenSeconds * 1000.0,
+			LastTimings.TransferSeconds * 1000.0);
+	}
+
+	const FDeepseekUsageLedger* Ledger = FDeepseekUsageLedger::Get();
+	if (Ledger != nullptr)
+	{
+		const FDeepseekUsageLedger::FTotals SessionTotals = Ledger->GetSessionTotals(OpenAIService->GetSessionId());
+		if (SessionTotals.Requests > 0)
+		{
+			StatsString += FString::Printf(TEXT("  本会话 %lld tokens，约 $%.4f"),
+				SessionTotals.GetTotalTokens(), Ledger->ComputeCost(Settings->Model, SessionTotals));
+		}
+	}
+
+	CacheStatsText = FText::FromString(StatsString);
+}
+
+FText SDeepseekChatSession::GetCacheStatsText() const
+{
+	return CacheStatsText;
+}
+
+void SDeepseekChatSession::OnChatListScrolled(double ScrollOffset)
+{
+	// 用户向上翻看历史时暂停自动滚动，回到底部后恢复
+	bAutoScrollToBottom = ChatListView->GetScrollDistanceRemaining().Y <= KINDA_SMALL_NUMBER;
+
+	// 滚动到顶部时载入更早的消息
+	if (ScrollOffset < 1.0 && LogLoadedFirst > 0)
+	{
+		LoadOlderMessages();
+	}
+}
+
+void SDeepseekChatSession::ScrollChatToBottom()
+{
+	if (bAutoScrollToBottom && ChatMessages.Num() > 0)
+	{
+		ChatListView->ScrollToBottom();
+	}
+}
+
+void SDeepseekChatSession::RestoreFromLog()
+{
+	const int32 NumRecords = Log->Num();
+	if (NumRecords == 0)
+	{
+		return;
+	}
+
+	// 标题取开头几条中的第一条用户消息
+	TArray<FDeepseekSessionLog::FRecord> HeadRecords;
+	Log->ReadMessages(0, FMath::Min(NumRecords, 8), HeadRecords);
+	for (const FDeepseekSessionLog::FRecord& Record : HeadRecords)
+	{
+		if (Record.Role == FDeepseekSessionLog::ERole::User)
+		{
+			TitleSource = Record.Text;
+			break;
+		}
+	}
+
+	// 只读取最后一页，更早的消息在向上滚动时再载入
+	LogLoadedFirst = FMath::Max(0, NumRecords - LogPageSize);
+	TArray<FDeepseekSessionLog::FRecord> Records;
+	if (!Log->ReadMessages(LogLoadedFirst, NumRecords - LogLoadedFirst, Records))
+	{
+		LogLoadedFirst = 0;
+		return;
+	}
+
+	const int32 FirstDisplayIndex = ChatMessages.Num();
+	for (const FDeepseekSessionLog::FRecord& Record : Records)
+	{
+		ChatMessages.Add(MakeMessageFromRecord(Record));
+	}
+
+	// 聊天历史不受显示页大小的限制，从最后一条向前读取，直到填满上下文预算；超出预算的更早消息本来也不会发送
+	const int32 Budget = FMath::Max(0, Settings->MaxContextTokens - Settings->MaxTokens) - FDeepseekTokenizer::CountMessageTokens(ChatHistory[0]);
+	TArray<FOpenAIMessage> RestoredHistory;
+	int32 HistoryTokens = 0;
+	bool bLaterIsAssistant = false;
+	bool bBudgetFull = false;
+	int32 PageFirst = LogLoadedFirst;
+	TArray<FDeepseekSessionLog::FRecord> OlderRecords;
+	while (true)
+	{
+		// 最后一页已经读入，与显示的消息共用文本
+		const bool bDisplayedPage = PageFirst == LogLoadedFirst;
+		const TArray<FDeepseekSessionLog::FRecord>& Page = bDisplayedPage ? Records : OlderRecords;
+		for (int32 Index = Page.Num() - 1; Index >= 0 && !bBudgetFull; --Index)
+		{
+			const FDeepseekSessionLog::FRecord& Record = Page[Index];
+			if (Record.Role == FDeepseekSessionLog::ERole::Notice)
+			{
+				continue;
+			}
+
+			// 没有得到回答的提问不进入历史，避免连续两条用户消息
+			const bool bIsUser = Record.Role == FDeepseekSessionLog::ERole::User;
+			const bool bAnswered = bLaterIsAssistant;
+			bLaterIsAssistant = !bIsUser;
+			if (bIsUser && !bAnswered)
+			{
+				continue;
+			}
+
+			FOpenAIMessage Message(bIsUser ? TEXT("user") : TEXT("assistant"),
+				bDisplayedPage ? ChatMessages[FirstDisplayIndex + Index]->Message : MessageStore.Add(Record.Text));
+			const int32 MessageTokens = FDeepseekTokenizer::CountMessageTokens(Message);
+			if (RestoredHistory.Num() > 0 && HistoryTokens + MessageTokens > Budget)
+			{
+				bBudgetFull = true;
+				break;
+			}
+			HistoryTokens += MessageTokens;
+			RestoredHistory.Add(MoveTemp(Message));
+		}
+
+		if (bBudgetFull || PageFirst == 0)
+		{
+			break;
+		}
+
+		const int32 OlderFirst = FMath::Max(0, PageFirst - LogPageSize);
+		OlderRecords.Reset();
+		if (!Log->ReadMessages(OlderFirst, PageFirst - OlderFirst, OlderRecords))
+		{
+			break;
+		}
+		PageFirst = OlderFirst;
+	}
+
+	for (int32 Index = RestoredHistory.Num() - 1; Index >= 0; --Index)
+	{
+		ChatHistory.Add(MoveTemp(RestoredHistory[Index]));
+	}
+
+	ChatListView->RequestListRefresh();
+	ScrollChatToBottom();
+}
+
+void SDeepseekChatSession::LoadOlderMessages()
+{
+	const int32 First = FMath::Max(0, LogLoadedFirst - LogPageSize);
+	TArray<FDeepseekSessionLog::FRecord> Records;
+	if (!Log.IsValid() || !Log->ReadMessages(First, LogLoadedFirst - First, Records))
+	{
+		LogLoadedFirst = 0;
+		return;
+	}
+	LogLoadedFirst = First;
+
+	// 插在欢迎消息之后，只用于显示，不加入聊天历史
+	TArray<TSharedPtr<FChatMessage>> OlderMessages;
+	OlderMessages.Reserve(Records.Num());
+	for (const FDeepseekSessionLog::FRecord& Record : Records)
+	{
+		OlderMessages.Add(MakeMessageFromRecord(Record));
+	}
+	ChatMessages.Insert(OlderMessages, 1);
+	if (WaitingMessageIndex >= 0)
+	{
+		WaitingMessageIndex += OlderMessages.Num();
+	}
+
+	// 保持当前看到的消息不动
+	ChatListView->RequestListRefresh();
+	ChatListView->SetScrollOffset(ChatListView->GetScrollOffset() + OlderMessages.Num());
+}
+
+TSharedPtr<FChatMessage> SDeepseekChatSession::MakeMessageFromRecord(const FDeepseekSessionLog::FRecord& Record)
+{
+	return MakeShared<FChatMessage>(Record.Sender, MessageStore.Add(Record.Text), Record.Role == FDeepseekSessionLog::ERole::User);
+}
+
+void SDeepseekChatSession::LogMessage(FDeepseekSessionLog::ERole Role, const FChatMessage& Message)
+{
+	if (Log.IsValid())
+	{
+		Log->Append(Role, Message.Sender, Message.Message.ToString());
+	}
+}
+
+void SDeepseekChatSession::DeleteLog()
+{
+	if (Log.IsValid())
+	{
+		Log->Delete();
+		Log.Reset();
+	}
+}
+
+void SDeepseekChatSession::AddWaitingMessage()
+{
+	SetWaiting(true);
+	StreamingContent.Reset();
+
+	// 添加等待消息，提示文本是临时的，不写入消息存储
+	TSharedPtr<FChatMessage> WaitingMessage = MakeShared<FChatMessage>(TEXT("AI助手"), FDeepseekMessageText(TEXT("正在思考...")), false);
+	ChatMessages.Add(WaitingMessage);
+	WaitingMessageIndex = ChatMessages.Num() - 1;
+
+	// 刷新列表
+	ChatListView->RequestListRefresh();
+	ScrollChatToBottom();
+}
+
+void SDeepseekChatSession::RemoveWaitingMessage()
+{
+	if (WaitingMessageIndex >= 0 && WaitingMessageIndex < ChatMessages.Num())
+	{
+		ChatMessages.RemoveAt(WaitingMessageIndex);
+		WaitingMessageIndex = -1;
+	}
+
+	SetWaiting(false);
+	StreamingContent.Reset();
+	StreamingTextWidget.Reset();
+}
+
+void SDeepseekChatSession::SetWaiting(bool bInIsWaiting)
+{
+	if (bIsWaiting != bInIsWaiting)
+	{
+		bIsWaiting = bInIsWaiting;
+		OnStateChanged.ExecuteIfBound();
+	}
+}
+
+TSharedRef<ITableRow> SDeepseekChatSession::OnGenerateRow(TSharedPtr<FChatMessage> Message,
+                                                          const TSharedRef<STableViewBase>& OwnerTable)
+{
+	// 根据消息发送者设置不同的样式
+	const FSlateBrush* BubbleBrush = Message->bIsUser
+		                                 ? FEditorStyle::GetBrush("ToolPanel.GroupBorder")
+		                                 : FEditorStyle::GetBrush("ToolPanel.DarkGroupBorder");
+
+	EHorizontalAlignment HAlign = Message->bIsUser ? HAlign_Right : HAlign_Left;
+
+	// 等待消息使用可追加的流式文本，其余消息内容固定
+	TSharedPtr<SWidget> MessageContent;
+	if (ChatMessages.IsValidIndex(WaitingMessageIndex) && ChatMessages[WaitingMessageIndex] == Message)
+	{
+		TSharedRef<SDeepseekStreamingText> StreamingText = SNew(SDeepseekStreamingText)
+			.Text(StreamingContent)
+			.HintText(Message->Message.ToString());
+		StreamingTextWidget = StreamingText;
+		MessageContent = StreamingText;
+	}
+	else if (Message->bIsSuggestion)
+	{
+		// 相似问题的历史回答，附带采用与重新请求按钮
+		MessageContent = SNew(SVerticalBox)
+
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock)
+				.Text(FText::FromStringView(Message->Message.View()))
+				.AutoWrapText(true)
+			]
+
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(0, 5, 0, 0)
+			[
+				SNew(SHorizontalBox)
+
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				.Padding(0, 0, 5, 0)
+				[
+					SNew(SButton)
+					.Text(FText::FromString(TEXT("采用")))
+					.OnClicked(this, &SDeepseekChatSession::OnAcceptSuggestion)
+				]
+
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				[
+					SNew(SButton)
+					.Text(FText::FromString(TEXT("重新请求")))
+					.OnClicked(this, &SDeepseekChatSession::OnRefreshSuggestion)
+				]
+			];
+	}
+	else
+	{
+		MessageContent = SNew(STextBlock)
+			.Text(FText::FromStringView(Message->Message.View()))
+			.AutoWrapText(true);
+	}
+
+	return SNew(STableRow<TSharedPtr<FChatMessage>>, OwnerTable)
+		.Padding(FMargin(4.0f))
+		.ShowSelection(false)
+		[
+			SNew(SHorizontalBox)
+
+			// 用户消息靠右，AI消息靠左
+			+ SHorizontalBox::Slot()
+			.FillWidth(1.0f)
+			.HAlign(HAlign)
+			[
+				SNew(SBox)
+				.MaxDesiredWidth(500.0f)
+				[
+					SNew(SBorder)
+					.BorderImage(BubbleBrush)
+					.Padding(FMargin(10.0f))
+					[
+						SNew(SVerticalBox)
+
+						// 发送者名称
+						+ SVerticalBox::Slot()
+						.AutoHeight()
+						.Padding(0, 0, 0, 5)
+						[
+							SNew(STextBlock)
+							.Text(FText::FromString(Message->Sender))
+							.Font(FEditorStyle::GetFontStyle("BoldFont"))
+						]
+
+						// 消息内容
+						+ SVerticalBox::Slot()
+						.AutoHeight()
+						[
+							MessageContent.ToSharedRef()
+						]
+					]
+				]
+			]
+		];
+}
+
+END_SLATE_FUNCTION_BUILD_OPTIMIZATION
@@ -0,0 +1,189 @@
+#include "SDeepseekRequestStatsPanel.h"
+#include "SlateOptMacros.h"
+#include "Widgets/Layout/SExpandableArea.h"
+#include "Widgets/Layout/SGridPanel.h"
+#include "Widgets/Input/SButton.h"
+#include "Widgets/Text/STextBlock.h"
+#include "Widgets/SBoxPanel.h"
+#include "EditorStyleSet.h"
+
+BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
+
+void SDeepseekRequestStatsPanel::Construct(const FArguments& InArgs)
+{
+	CellTexts.Init(FText::GetEmpty(), NumRows * 3);
+	RefreshedGeneration = MAX_uint32;
+	SummaryGeneration = MAX_uint32;
+	bExpanded = false;
+
+	TSharedRef<SGridPanel> Grid = SNew(SGridPanel);
+
+	static const TCHAR* ColumnNames[] = { TEXT("p50"), TEXT("p95"), TEXT("p99") };
+	for (int32 Column = 0; Column < 3; ++Column)
+	{
+		Grid->AddSlot(Column + 1, 0)
+			.Padding(12, 0, 0, 2)
+			.HAlign(HAlign_Right)
+			[
+				SNew(STextBlock)
+				.Text(FText::FromString(ColumnNames[Column]))
+				.Font(FEditorStyle::GetFontStyle("BoldFont"))
+			];
+	}
+
+	for (int32 Row = 0; Row < NumRows; ++Row)
+	{
+		const FString RowName = Row < static_cast<int32>(EDeepseekRequestPhase::Num)
+			? FString::Printf(TEXT("%s (ms)"), FDeepseekRequestStats::GetPhaseName(static_cast<EDeepseekRequestPhase>(Row)))
+			: FString(TEXT("生成速度 (token/s)"));
+
+		Grid->AddSlot(0, Row + 1)
+			[
+				SNew(STextBlock)
+				.Text(FText::FromString(RowName))
+				.ColorAndOpacity(FSlateColor::UseSubduedForeground())
+			];
+
+		for (int32 Column = 0; Column < 3; ++Column)
+		{
+			Grid->AddSlot(Column + 1, Row + 1)
+				.Padding(12, 0, 0, 0)
+				.HAlign(HAlign_Right)
+				[
+					SNew(STextBlock)
+					.Text(this, &SDeepseekRequestStatsPanel::GetCellText, Row, Column)
+				];
+		}
+	}
+
+	ChildSlot
+	[
+		SNew(SExpandableArea)
+		.InitiallyCollapsed(true)
+		.OnAreaExpansionChanged_Lambda([this](bool bIsExpanded)
+		{
+			bExpanded = bIsExpanded;
+			if (bExpanded)
+			{
+				Refresh();
+			}
+		})
+		.HeaderContent()
+		[
+			SNew(STextBlock)
+			.Text_Lambda([this]() { return SummaryText; })
+		]
+		.BodyContent()
+		[
+			SNew(SVerticalBox)
+
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(4)
+			[
+				Grid
+			]
+
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			.Padding(4)
+			[
+				SNew(SHorizontalBox)
+
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				[
+					SNew(SButton)
+					.Text(FText::FromString(TEXT("导出CSV")))
+					.OnClicked(this, &SDeepseekRequestStatsPanel::OnExportCsv)
+				]
+
+				+ SHorizontalBox::Slot()
+				.AutoWidth()
+				.Padding(4, 0, 0, 0)
+				[
+					SNew(SButton)
+					.Text(FText::FromString(TEXT("清空")))
+					.OnClicked(this, &SDeepseekRequestStatsPanel::OnResetStats)
+				]
+			]
+		]
+	];
+
+	Refresh();
+	RegisterActiveTimer(1.0f, FWidgetActiveTimerDelegate::CreateSP(this, &SDeepseekRequestStatsPanel::OnRefreshTimer));
+}
+
+EActiveTimerReturnType SDeepseekRequestStatsPanel::OnRefreshTimer(double InCurrentTime, float InDeltaTime)
+{
+	Refresh();
+	return EActiveTimerReturnType::Continue;
+}
+
+void SDeepseekRequestStatsPanel::Refresh()
+{
+	FDeepseekRequestStats* Stats = FDeepseekRequestStats::Get();
+	if (Stats == nullptr)
+	{
+		return;
+	}
+
+	const uint32 Generation = Stats->GetGeneration();
+	if (Generation != SummaryGeneration)
+	{
+		SummaryGeneration = Generation;
+		const FDeepseekRequestStats::FPercentiles FirstToken = Stats->GetPhasePercentiles(EDeepseekRequestPhase::FirstToken);
+		SummaryText = FText::FromString(FString::Printf(TEXT("请求统计：%d 次，首token p50 %.0f ms / p95 %.0f ms"),
+			Stats->GetNumSamples(), FirstToken.P50 * 1000.0, FirstToken.P95 * 1000.0));
+	}
+
+	// 折叠时只更新摘要，其余各行留到展开时
+	if (!bExpanded || Generation == RefreshedGeneration)
+	{
+		return;
+	}
+	RefreshedGeneration = Generation;
+
+	for (int32 Row = 0; Row < NumRows; ++Row)
+	{
+		const bool bIsPhase = Row < static_cast<int32>(EDeepseekRequestPhase::Num);
+		const FDeepseekRequestStats::FPercentiles Percentiles = bIsPhase
+			? Stats->GetPhasePercentiles(static_cast<EDeepseekRequestPhase>(Row))
+			: Stats->GetTokensPerSecondPercentiles();
+		const double Scale = bIsPhase ? 1000.0 : 1.0;
+
+		CellTexts[Row * 3 + 0] = FText::AsNumber(FMath::RoundToInt(Percentiles.P50 * Scale));
+		CellTexts[Row * 3 + 1] = FText::AsNumber(FMath::RoundToInt(Percentiles.P95 * Scale));
+		CellTexts[Row * 3 + 2] = FText::AsNumber(FMath::RoundToInt(Percentiles.P99 * Scale));
+	}
+}
+
+FText SDeepseekRequestStatsPanel::GetCellText(int32 Row, int32 Column) const
+{
+	return CellTexts[Row * 3 + Column];
+}
+
+FReply SDeepseekRequestStatsPanel::OnExportCsv()
+{
+	FDeepseekRequestStats* Stats = FDeepseekRequestStats::Get();
+	if (Stats != nullptr)
+	{
+		const FString FilePath = FDeepseekRequestStats::GetDefaultExportPath();
+		SummaryText = FText::FromString(Stats->ExportCsv(FilePath)
+			? FString::Printf(TEXT("已导出到 %s"), *FilePath)
+			: FString::Printf(TEXT("导出失败：%s"), *FilePath));
+	}
+	return FReply::Handled();
+}
+
+FReply SDeepseekRequestStatsPanel::OnResetStats()
+{
+	if (FDeepseekRequestStats* Stats = FDeepseekRequestStats::Get())
+	{
+		Stats->Reset();
+		Refresh();
+	}
+	return FReply::Handled();
+}
+
+END_SLATE_FUNCTION_BUILD_OPTIMIZATION
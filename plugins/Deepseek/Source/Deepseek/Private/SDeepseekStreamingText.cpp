@@ -0,0 +1,96 @@
+#include "SDeepseekStreamingText.h"
+#include "SlateOptMacros.h"
+#include "Widgets/SBoxPanel.h"
+#include "Widgets/Text/STextBlock.h"
+
+BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
+
+void SDeepseekStreamingText::Construct(const FArguments& InArgs)
+{
+	bFlushScheduled = false;
+	bShowingHint = false;
+
+	ChildSlot
+	[
+		SAssignNew(ParagraphBox, SVerticalBox)
+	];
+
+	AddTailParagraph();
+
+	if (!InArgs._Text.IsEmpty())
+	{
+		AppendToParagraphs(InArgs._Text);
+	}
+	else if (!InArgs._HintText.IsEmpty())
+	{
+		bShowingHint = true;
+		TailTextBlock->SetText(FText::FromString(InArgs._HintText));
+	}
+}
+
+void SDeepseekStreamingText::AppendText(const FString& Delta)
+{
+	if (Delta.IsEmpty())
+	{
+		return;
+	}
+
+	PendingText.Append(Delta);
+
+	if (!bFlushScheduled)
+	{
+		bFlushScheduled = true;
+		RegisterActiveTimer(0.f, FWidgetActiveTimerDelegate::CreateSP(this, &SDeepseekStreamingText::FlushPendingText));
+	}
+}
+
+EActiveTimerReturnType SDeepseekStreamingText::FlushPendingText(double InCurrentTime, float InDeltaTime)
+{
+	bFlushScheduled = false;
+
+	if (bShowingHint)
+	{
+		bShowingHint = false;
+		TailTextBlock->SetText(FText::GetEmpty());
+	}
+
+	FString Text = MoveTemp(PendingText);
+	PendingText.Reset();
+	AppendToParagraphs(Text);
+
+	return EActiveTimerReturnType::Stop;
+}
+
+void SDeepseekStreamingText::AppendToParagraphs(const FString& Text)
+{
+	int32 SegmentStart = 0;
+	int32 NewlineIndex = INDEX_NONE;
+	while ((NewlineIndex = Text.Find(TEXT("\n"), ESearchCase::CaseSensitive, ESearchDir::FromStart, SegmentStart)) != INDEX_NONE)
+	{
+		// 段落结束，固定其文本块，之后不再重新排版
+		TailParagraph.AppendChars(*Text + SegmentStart, NewlineIndex - SegmentStart);
+		TailTextBlock->SetText(FText::FromString(MoveTemp(TailParagraph)));
+		AddTailParagraph();
+		SegmentStart = NewlineIndex + 1;
+	}
+
+	if (SegmentStart < Text.Len())
+	{
+		TailParagraph.AppendChars(*Text + SegmentStart, Text.Len() - SegmentStart);
+		TailTextBlock->SetText(FText::FromString(TailParagraph));
+	}
+}
+
+void SDeepseekStreamingText::AddTailParagraph()
+{
+	TailParagraph.Reset();
+
+	ParagraphBox->AddSlot()
+	.AutoHeight()
+	[
+		SAssignNew(TailTextBlock, STextBlock)
+		.AutoWrapText(true)
+	];
+}
+
+END_SLATE_FUNCTION_BUILD_OPTIMIZATION
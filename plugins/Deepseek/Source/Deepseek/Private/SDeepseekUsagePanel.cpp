@@ -0,0 +1,64 @@
+#include "SDeepseekUsagePanel.h"
+#include "DeepseekUsageLedger.h"
+#include "SlateOptMacros.h"
+#include "Widgets/Layout/SExpandableArea.h"
+#include "Widgets/Text/STextBlock.h"
+
+BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
+
+void SDeepseekUsagePanel::Construct(const FArguments& InArgs)
+{
+	RefreshedGeneration = MAX_uint32;
+	RefreshedDay = 0;
+
+	ChildSlot
+	[
+		SNew(SExpandableArea)
+		.InitiallyCollapsed(true)
+		.HeaderContent()
+		[
+			SNew(STextBlock)
+			.Text_Lambda([this]() { return HeaderText; })
+		]
+		.BodyContent()
+		[
+			SNew(STextBlock)
+			.Margin(FMargin(4))
+			.AutoWrapText(true)
+			.Text_Lambda([this]() { return SummaryText; })
+		]
+	];
+
+	Refresh();
+	RegisterActiveTimer(1.0f, FWidgetActiveTimerDelegate::CreateSP(this, &SDeepseekUsagePanel::OnRefreshTimer));
+}
+
+EActiveTimerReturnType SDeepseekUsagePanel::OnRefreshTimer(double InCurrentTime, float InDeltaTime)
+{
+	Refresh();
+	return EActiveTimerReturnType::Continue;
+}
+
+void SDeepseekUsagePanel::Refresh()
+{
+	const FDeepseekUsageLedger* Ledger = FDeepseekUsageLedger::Get();
+	if (Ledger == nullptr)
+	{
+		return;
+	}
+
+	const FDateTime Today = FDateTime::Now();
+	if (Ledger->GetGeneration() == RefreshedGeneration && Today.GetDay() == RefreshedDay)
+	{
+		return;
+	}
+	RefreshedGeneration = Ledger->GetGeneration();
+	RefreshedDay = Today.GetDay();
+
+	const FDeepseekUsageLedger::FTotals TodayTotals = Ledger->GetDayTotals(Today);
+	HeaderText = FText::FromString(FString::Printf(TEXT("用量：今日 %d 次请求，%lld tokens，约 $%.4f"),
+		TodayTotals.Requests, TodayTotals.GetTotalTokens(), Ledger->GetDayCost(Today)));
+	SummaryText = FText::FromString(Ledger->BuildSummary());
+}
+
+END_SLATE_FUNCTION_BUILD_OPTIMIZATION
@@ -0,0 +1,71 @@
+#include "DeepseekLoadBenchmark.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * 等待压测结束并检查结果
+ */
+class FDeepseekWaitForLoadBenchmark : public IAutomationLatentCommand
+{
+public:
+	FDeepseekWaitForLoadBenchmark(FAutomationTestBase* InTest, const TSharedRef<FDeepseekLoadBenchmark>& InBenchmark, int32 InConcurrency, double InTimeoutSeconds)
+		: Test(InTest)
+		, Benchmark(InBenchmark)
+		, Concurrency(InConcurrency)
+		, TimeoutSeconds(InTimeoutSeconds)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		if (!Benchmark->IsFinished())
+		{
+			if (GetCurrentRunTime() < TimeoutSeconds)
+			{
+				return false;
+			}
+			Test->AddError(FString::Printf(TEXT("压测 %.0f 秒内没有结束，已完成 %d 个请求"), TimeoutSeconds, Benchmark->GetNumCompleted()));
+			return true;
+		}
+
+		Test->TestEqual(TEXT("失败的请求数"), Benchmark->GetNumFailed(), 0);
+		Test->TestEqual(TEXT("实际并发数"), Benchmark->GetEffectiveConcurrency(), Concurrency);
+		return true;
+	}
+
+private:
+	FAutomationTestBase* Test;
+	TSharedRef<FDeepseekLoadBenchmark> Benchmark;
+	int32 Concurrency;
+	double TimeoutSeconds;
+};
+
+/**
+ * 对本地模拟服务发出少量流式请求，并发数高于调度器的默认上限；所有请求都必须成功
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeepseekLoadBenchmarkTest, "Deepseek.LoadBench.MockServer",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FDeepseekLoadBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 Concurrency = 8;
+	const int32 TotalRequests = 32;
+
+	FDeepseekMockServerSettings ServerSettings;
+	ServerSettings.FirstTokenSeconds = 0.01f;
+	ServerSettings.TokensPerSecond = 0.0f;
+	ServerSettings.CompletionTokens = 20;
+
+	TSharedRef<FDeepseekLoadBenchmark> Benchmark = MakeShared<FDeepseekLoadBenchmark>(Concurrency, TotalRequests, true);
+	if (!Benchmark->Start(ServerSettings))
+	{
+		AddError(TEXT("模拟服务启动失败"));
+		return false;
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FDeepseekWaitForLoadBenchmark(this, Benchmark, Concurrency, 30.0));
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,41 @@
+#include "DeepseekRequestBodyCache.h"
+#include "DeepseekOpenAIService.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * 停止请求后换成等长的新提问：已缓存的前缀必须失效，请求体中只能出现新提问
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeepseekRequestBodyCacheResendTest, "Deepseek.RequestBodyCache.StopThenResendSameLength",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FDeepseekRequestBodyCacheResendTest::RunTest(const FString& Parameters)
+{
+	FDeepseekMessageStore MessageStore;
+	TArray<FOpenAIMessage> History;
+	History.Add(FOpenAIMessage(TEXT("system"), MessageStore.Add(TEXT("你是一个有用的AI助手"))));
+	History.Add(FOpenAIMessage(TEXT("user"), MessageStore.Add(TEXT("first question"))));
+
+	FDeepseekRequestBodyCache Cache;
+	Cache.Update(History);
+	TestTrue(TEXT("同一份历史再次同步时保留前缀"), Cache.Update(History));
+
+	// 与SDeepseekChatSession::OnStopRequest相同：未得到回答的提问从历史中移除
+	History.Pop();
+	History.Add(FOpenAIMessage(TEXT("user"), MessageStore.Add(TEXT("other question"))));
+
+	TestFalse(TEXT("等长的新提问使缓存的前缀失效"), Cache.Update(History));
+	TestEqual(TEXT("缓存的消息数"), Cache.Num(), History.Num());
+
+	TArray<uint8> Body;
+	Cache.BuildBody(TEXT("deepseek-chat"), 1.0, 1000, true, Body);
+	const FUTF8ToTCHAR Converter(reinterpret_cast<const ANSICHAR*>(Body.GetData()), Body.Num());
+	const FString BodyString(Converter.Length(), Converter.Get());
+	TestTrue(TEXT("请求体包含新提问"), BodyString.Contains(TEXT("other question")));
+	TestFalse(TEXT("请求体不包含旧提问"), BodyString.Contains(TEXT("first question")));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
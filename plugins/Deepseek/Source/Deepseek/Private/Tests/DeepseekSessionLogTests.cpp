@@ -0,0 +1,195 @@
+#include "DeepseekSessionLog.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace DeepseekSessionLogTests
+{
+	/** 测试用的日志路径，先删除上次留下的文件 */
+	static FString MakeTestLogPath(const TCHAR* Name)
+	{
+		const FString Path = FPaths::AutomationTransientDir() / TEXT("Deepseek") / FString(Name) + TEXT(".dslog");
+		IFileManager::Get().Delete(*Path, false, false, true);
+		IFileManager::Get().Delete(*FPaths::ChangeExtension(Path, TEXT("dsidx")), false, false, true);
+		return Path;
+	}
+
+	/** 读出全部当前消息的内容，以|连接 */
+	static FString ReadTexts(const FDeepseekSessionLog& Log)
+	{
+		TArray<FString> Texts;
+		TArray<FDeepseekSessionLog::FRecord> Records;
+		if (Log.Num() > 0 && Log.ReadMessages(0, Log.Num(), Records))
+		{
+			for (const FDeepseekSessionLog::FRecord& Record : Records)
+			{
+				Texts.Add(Record.Text);
+			}
+		}
+		return FString::Join(Texts, TEXT("|"));
+	}
+}
+
+/**
+ * 追加、清空后重新打开：只读出最后一次清空之后的消息，角色与发送者保持不变
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeepseekSessionLogReopenTest, "Deepseek.SessionLog.AppendClearReopen",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FDeepseekSessionLogReopenTest::RunTest(const FString& Parameters)
+{
+	using namespace DeepseekSessionLogTests;
+
+	const FString Path = MakeTestLogPath(TEXT("AppendClearReopen"));
+	{
+		TSharedRef<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = FDeepseekSessionLog::Create(Path);
+		Log->Append(FDeepseekSessionLog::ERole::User, TEXT("用户"), TEXT("old question"));
+		Log->Append(FDeepseekSessionLog::ERole::Assistant, TEXT("AI助手"), TEXT("old answer"));
+		Log->AppendClear();
+		TestEqual(TEXT("清空后的消息数"), Log->Num(), 0);
+
+		Log->Append(FDeepseekSessionLog::ERole::User, TEXT("用户"), TEXT("new question"));
+		Log->Append(FDeepseekSessionLog::ERole::Notice, TEXT("系统"), TEXT("notice"));
+		TestEqual(TEXT("追加后的消息数"), Log->Num(), 2);
+	}
+
+	TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Reopened = FDeepseekSessionLog::Open(Path);
+	if (!TestTrue(TEXT("重新打开"), Reopened.IsValid()))
+	{
+		return false;
+	}
+
+	TArray<FDeepseekSessionLog::FRecord> Records;
+	TestTrue(TEXT("读取当前消息"), Reopened->ReadMessages(0, Reopened->Num(), Records));
+	if (TestEqual(TEXT("重新打开后的消息数"), Records.Num(), 2))
+	{
+		TestEqual(TEXT("第一条的内容"), Records[0].Text, FString(TEXT("new question")));
+		TestEqual(TEXT("第一条的发送者"), Records[0].Sender, FString(TEXT("用户")));
+		TestTrue(TEXT("第一条的角色"), Records[0].Role == FDeepseekSessionLog::ERole::User);
+		TestTrue(TEXT("第二条的角色"), Records[1].Role == FDeepseekSessionLog::ERole::Notice);
+	}
+	TestFalse(TEXT("超出范围的读取失败"), Reopened->ReadMessages(1, 2, Records));
+
+	Reopened->Delete();
+	return true;
+}
+
+/**
+ * 写入中途退出：末尾不完整的记录被截掉并重建索引，之后的追加与再次打开正常；索引丢失时同样按日志重建
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeepseekSessionLogTruncatedTailTest, "Deepseek.SessionLog.RebuildAfterTruncatedTail",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FDeepseekSessionLogTruncatedTailTest::RunTest(const FString& Parameters)
+{
+	using namespace DeepseekSessionLogTests;
+
+	const FString Path = MakeTestLogPath(TEXT("TruncatedTail"));
+	int64 ValidSize = 0;
+	{
+		TSharedRef<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = FDeepseekSessionLog::Create(Path);
+		Log->Append(FDeepseekSessionLog::ERole::User, TEXT("用户"), TEXT("first"));
+		Log->Append(FDeepseekSessionLog::ERole::Assistant, TEXT("AI助手"), TEXT("second"));
+		ValidSize = Log->GetFileSize();
+	}
+
+	// 一条声明100字节负载、实际只写了3字节的消息记录
+	const uint8 PartialRecord[] = { 100, 0, 0, 0, 0, 1, 2, 3 };
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Path, FILEWRITE_Append));
+	if (!TestTrue(TEXT("写入不完整的记录"), Writer.IsValid()))
+	{
+		return false;
+	}
+	Writer->Serialize(const_cast<uint8*>(PartialRecord), UE_ARRAY_COUNT(PartialRecord));
+	Writer->Close();
+	Writer.Reset();
+
+	{
+		TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = FDeepseekSessionLog::Open(Path);
+		if (!TestTrue(TEXT("打开末尾不完整的日志"), Log.IsValid()))
+		{
+			return false;
+		}
+		TestEqual(TEXT("截掉后的文件大小"), Log->GetFileSize(), ValidSize);
+		TestEqual(TEXT("截掉后的文件大小（磁盘）"), IFileManager::Get().FileSize(*Path), ValidSize);
+		TestEqual(TEXT("保留完整的记录"), ReadTexts(*Log), FString(TEXT("first|second")));
+
+		Log->Append(FDeepseekSessionLog::ERole::User, TEXT("用户"), TEXT("third"));
+	}
+
+	// 删除索引，再次打开时从日志重建
+	IFileManager::Get().Delete(*FPaths::ChangeExtension(Path, TEXT("dsidx")));
+	TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = FDeepseekSessionLog::Open(Path);
+	if (!TestTrue(TEXT("没有索引时打开"), Log.IsValid()))
+	{
+		return false;
+	}
+	TestEqual(TEXT("重建索引后的消息"), ReadTexts(*Log), FString(TEXT("first|second|third")));
+
+	Log->Delete();
+	return true;
+}
+
+/**
+ * 后台压缩：复制期间追加的消息在完成时补上，压缩后的日志变小，重新打开后内容不变
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeepseekSessionLogCompactionTest, "Deepseek.SessionLog.CompactWithConcurrentAppends",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FDeepseekSessionLogCompactionTest::RunTest(const FString& Parameters)
+{
+	using namespace DeepseekSessionLogTests;
+
+	const FString Path = MakeTestLogPath(TEXT("Compaction"));
+	TSharedRef<FDeepseekSessionLog, ESPMode::ThreadSafe> Log = FDeepseekSessionLog::Create(Path);
+
+	// 清空的记录远大于压缩阈值
+	const FString LongText = FString::ChrN(8 * 1024, TEXT('x'));
+	for (int32 Index = 0; Index < 32; ++Index)
+	{
+		Log->Append(FDeepseekSessionLog::ERole::Assistant, TEXT("AI助手"), LongText);
+	}
+	Log->AppendClear();
+	Log->Append(FDeepseekSessionLog::ERole::User, TEXT("用户"), TEXT("live 0"));
+	Log->Append(FDeepseekSessionLog::ERole::Assistant, TEXT("AI助手"), TEXT("live 1"));
+
+	Log->CompactIfNeeded();
+	if (!TestTrue(TEXT("开始后台压缩"), Log->IsCompacting()))
+	{
+		Log->Delete();
+		return false;
+	}
+
+	// 压缩在游戏线程完成，此时还没有完成，这些记录在快照之后
+	const int64 SizeBeforeCompaction = Log->GetFileSize();
+	Log->Append(FDeepseekSessionLog::ERole::User, TEXT("用户"), TEXT("during 0"));
+	Log->Append(FDeepseekSessionLog::ERole::Assistant, TEXT("AI助手"), TEXT("during 1"));
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Log, Path, SizeBeforeCompaction]()
+	{
+		if (Log->IsCompacting())
+		{
+			return false;
+		}
+
+		const FString Expected = TEXT("live 0|live 1|during 0|during 1");
+		TestTrue(TEXT("压缩后日志变小"), Log->GetFileSize() < SizeBeforeCompaction);
+		TestEqual(TEXT("压缩后的文件大小（磁盘）"), IFileManager::Get().FileSize(*Path), Log->GetFileSize());
+		TestEqual(TEXT("压缩后的消息"), ReadTexts(*Log), Expected);
+
+		Log->Append(FDeepseekSessionLog::ERole::User, TEXT("用户"), TEXT("after"));
+		TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Reopened = FDeepseekSessionLog::Open(Path);
+		if (TestTrue(TEXT("压缩后重新打开"), Reopened.IsValid()))
+		{
+			TestEqual(TEXT("重新打开后的消息"), ReadTexts(*Reopened), Expected + TEXT("|after"));
+		}
+
+		Log->Delete();
+		return true;
+	}));
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,487 @@
+#include "Deepseek.h"
+#include "SDeepseekAIChat.h"
+#include "SDeepseekChatSession.h"
+#include "Widgets/SVirtualWindow.h"
+#include "Input/HittestGrid.h"
+#include "Layout/Children.h"
+#include "Rendering/DrawElements.h"
+#include "Types/PaintArgs.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * 问答界面的性能测试
+ * 在离屏窗口中构造完整的问答界面并载入大量合成消息，逐帧执行预处理与绘制，
+ * 记录每帧耗时、小部件数量与内存，并与保存的基线比较，超过基线时测试失败
+ */
+namespace DeepseekUIPerf
+{
+	/** 生成一条合成消息，长度分布接近真实对话：提问较短，回答多为中等长度，少数很长并带代码 */
+	static FString MakeSyntheticChatMessage(FRandomStream& Stream, bool bIsUser)
+	{
+		static const TCHAR* Sentences[] = {
+			TEXT("Actor的生命周期从BeginPlay开始，到EndPlay结束。"),
+			TEXT("蓝图中的Tick默认每帧执行，不需要时应当关闭。"),
+			TEXT("UPROPERTY标记的指针会被垃圾回收追踪，裸指针不会。"),
+			TEXT("Replicated属性只在服务器修改后同步到客户端。"),
+			TEXT("Use a soft object reference when the asset does not need to be loaded up front. "),
+			TEXT("材质实例可以在运行时修改参数，而不需要重新编译着色器。"),
+			TEXT("Niagara系统的模拟可以在GPU上运行，以支持大量粒子。"),
+			TEXT("The crash happens because the component is destroyed before the timer fires. "),
+		};
+		static const TCHAR* CodeLines[] = {
+			TEXT("    UPROPERTY(EditAnywhere, Category = \"Movement\")\n"),
+			TEXT("    float Speed = 600.f;\n"),
+			TEXT("    GetWorldTimerManager().SetTimer(Handle, this, &AMyActor::OnTimer, 1.0f, true);\n"),
+			TEXT("    if (!IsValid(Target)) { return; }\n"),
+		};
+
+		int32 Length = 0;
+		const float Roll = Stream.GetFraction();
+		if (bIsUser)
+		{
+			Length = Stream.RandRange(20, 300);
+		}
+		else if (Roll < 0.6f)
+		{
+			Length = Stream.RandRange(80, 600);
+		}
+		else if (Roll < 0.9f)
+		{
+			Length = Stream.RandRange(600, 3000);
+		}
+		else
+		{
+			Length = Stream.RandRange(3000, 12000);
+		}
+
+		FString Message;
+		Message.Reserve(Length + 128);
+		while (Message.Len() < Length)
+		{
+			const int32 Kind = Stream.RandHelper(10);
+			if (Kind == 0)
+			{
+				Message.Append(TEXT("\n\n"));
+			}
+			else if (Kind == 1 && !bIsUser && Length > 1000)
+			{
+				Message.Append(TEXT("\n```cpp\n"));
+				for (int32 Line = Stream.RandRange(3, 12); Line > 0; --Line)
+				{
+					Message.Append(CodeLines[Stream.RandHelper(UE_ARRAY_COUNT(CodeLines))]);
+				}
+				Message.Append(TEXT("```\n"));
+			}
+			else
+			{
+				Message.Append(Sentences[Stream.RandHelper(UE_ARRAY_COUNT(Sentences))]);
+			}
+		}
+		return Message;
+	}
+
+	/** 一个场景的逐帧记录 */
+	struct FChatPerfScenario
+	{
+		FString Name;
+
+		/** 每帧预处理与绘制的总耗时（毫秒） */
+		TArray<double> FrameMs;
+
+		double PrepassMs = 0.0;
+		double PaintMs = 0.0;
+
+		/** 窗口中的小部件数与列表生成的行数，取各帧最大值 */
+		int32 MaxWidgets = 0;
+		int32 MaxRows = 0;
+
+		double GetAverageMs() const
+		{
+			return FrameMs.Num() > 0 ? (PrepassMs + PaintMs) / FrameMs.Num() : 0.0;
+		}
+
+		double GetPercentileMs(double Fraction) const
+		{
+			if (FrameMs.Num() == 0)
+			{
+				return 0.0;
+			}
+			TArray<double> Sorted = FrameMs;
+			Sorted.Sort();
+			return Sorted[FMath::Clamp(FMath::CeilToInt(Sorted.Num() * Fraction) - 1, 0, Sorted.Num() - 1)];
+		}
+	};
+
+	/**
+	 * 离屏绘制问答界面
+	 * 界面放在不属于应用程序的虚拟窗口中，每帧的预处理与绘制与编辑器绘制窗口时相同，只是不提交给渲染器
+	 */
+	class FChatPerfHarness
+	{
+	public:
+		explicit FChatPerfHarness(const FVector2D& InSize)
+			: Size(InSize)
+			, CurrentTime(FPlatformTime::Seconds())
+		{
+			// 不读写已保存的会话
+			Chat = SNew(SDeepseekAIChat)
+				.PersistSessions(false);
+			Session = Chat->GetActiveSession();
+			Window = SNew(SVirtualWindow).Size(Size);
+			Window->SetContent(Chat.ToSharedRef());
+		}
+
+		SDeepseekChatSession& GetSession() const { return *Session; }
+
+		SListView<TSharedPtr<FChatMessage>>& GetListView() const { return *Session->GetChatListView(); }
+
+		void SetSize(const FVector2D& InSize)
+		{
+			Size = InSize;
+			Window->Resize(Size);
+		}
+
+		/** 绘制一帧，Scenario为空时不记录 */
+		void DrawFrame(FChatPerfScenario* Scenario)
+		{
+			const float DeltaTime = 1.0f / 60.0f;
+			CurrentTime += DeltaTime;
+
+			const FGeometry WindowGeometry = FGeometry::MakeRoot(Size, FSlateLayoutTransform());
+			const FSlateRect WindowClipRect = WindowGeometry.GetLayoutBoundingRect();
+			HittestGrid.SetHittestArea(FVector2D::ZeroVector, Size);
+
+			const double PrepassStart = FPlatformTime::Seconds();
+			Window->SlatePrepass(1.0f);
+			const double PaintStart = FPlatformTime::Seconds();
+			{
+				FSlateWindowElementList ElementList(Window);
+				FPaintArgs PaintArgs(nullptr, HittestGrid, FVector2D::ZeroVector, CurrentTime, DeltaTime);
+				Window->Paint(PaintArgs, WindowGeometry, WindowClipRect, ElementList, 0, FWidgetStyle(), true);
+			}
+			const double PaintEnd = FPlatformTime::Seconds();
+
+			if (Scenario != nullptr)
+			{
+				Scenario->PrepassMs += (PaintStart - PrepassStart) * 1000.0;
+				Scenario->PaintMs += (PaintEnd - PaintStart) * 1000.0;
+				Scenario->FrameMs.Add((PaintEnd - PrepassStart) * 1000.0);
+				Scenario->MaxWidgets = FMath::Max(Scenario->MaxWidgets, CountWidgets(*Window));
+				Scenario->MaxRows = FMath::Max(Scenario->MaxRows, GetListView().GetNumGeneratedChildren());
+			}
+		}
+
+	private:
+		static int32 CountWidgets(SWidget& Widget)
+		{
+			int32 Count = 1;
+			FChildren* Children = Widget.GetChildren();
+			for (int32 Index = 0; Index < Children->Num(); ++Index)
+			{
+				Count += CountWidgets(Children->GetChildAt(Index).Get());
+			}
+			return Count;
+		}
+
+	private:
+		FVector2D Size;
+		double CurrentTime;
+
+		TSharedPtr<SDeepseekAIChat> Chat;
+		TSharedPtr<SDeepseekChatSession> Session;
+		TSharedPtr<SVirtualWindow> Window;
+		FHittestGrid HittestGrid;
+	};
+
+	/** 当前占用的物理内存（MB） */
+	static double GetUsedPhysicalMB()
+	{
+		return FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0);
+	}
+
+	/** 基线文件 */
+	static FString GetUIPerfBaselinePath()
+	{
+		return FPaths::ProjectSavedDir() / TEXT("Deepseek") / TEXT("UIPerfBaseline.json");
+	}
+
+	static void SaveUIPerfBaseline(int32 NumMessages, double MemoryMB, const TArray<FChatPerfScenario>& Scenarios)
+	{
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetNumberField(TEXT("Messages"), NumMessages);
+		Root->SetNumberField(TEXT("MemoryMB"), MemoryMB);
+
+		TSharedRef<FJsonObject> ScenariosObject = MakeShared<FJsonObject>();
+		for (const FChatPerfScenario& Scenario : Scenarios)
+		{
+			TSharedRef<FJsonObject> ScenarioObject = MakeShared<FJsonObject>();
+			ScenarioObject->SetNumberField(TEXT("AvgMs"), Scenario.GetAverageMs());
+			ScenarioObject->SetNumberField(TEXT("P95Ms"), Scenario.GetPercentileMs(0.95));
+			ScenarioObject->SetNumberField(TEXT("Widgets"), Scenario.MaxWidgets);
+			ScenariosObject->SetObjectField(Scenario.Name, ScenarioObject);
+		}
+		Root->SetObjectField(TEXT("Scenarios"), ScenariosObject);
+
+		FString Json;
+		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+		FJsonSerializer::Serialize(Root, Writer);
+		if (FFileHelper::SaveStringToFile(Json, *GetUIPerfBaselinePath(), FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+		{
+			UE_LOG(LogDeepseek, Display, TEXT("UIPerf: 已保存基线 %s"), *GetUIPerfBaselinePath());
+		}
+	}
+
+	/** 超过基线的(1+Tolerance)倍再加Slack时视为回归，回归项加入OutRegressions */
+	static void CheckUIPerfMetric(const FString& Name, double Current, double Baseline, double Tolerance, double Slack, TArray<FString>& OutRegressions)
+	{
+		const double Limit = Baseline * (1.0 + Tolerance) + Slack;
+		if (Current > Limit)
+		{
+			OutRegressions.Add(FString::Printf(TEXT("UIPerf回归: %s 为 %.3f，基线 %.3f，上限 %.3f"), *Name, Current, Baseline, Limit));
+		}
+	}
+
+	/** 与基线比较，回归项加入OutRegressions；没有可比的基线时返回false */
+	static bool CompareUIPerfBaseline(int32 NumMessages, double MemoryMB, const TArray<FChatPerfScenario>& Scenarios, double Tolerance, TArray<FString>& OutRegressions)
+	{
+		FString Json;
+		TSharedPtr<FJsonObject> Root;
+		if (!FFileHelper::LoadFileToString(Json, *GetUIPerfBaselinePath())
+			|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Root) || !Root.IsValid())
+		{
+			return false;
+		}
+
+		if (static_cast<int32>(Root->GetNumberField(TEXT("Messages"))) != NumMessages)
+		{
+			UE_LOG(LogDeepseek, Warning, TEXT("UIPerf: 基线的消息数为 %d，与本次不同，不做比较"), static_cast<int32>(Root->GetNumberField(TEXT("Messages"))));
+			return false;
+		}
+
+		CheckUIPerfMetric(TEXT("内存(MB)"), MemoryMB, Root->GetNumberField(TEXT("MemoryMB")), Tolerance, 4.0, OutRegressions);
+
+		const TSharedPtr<FJsonObject>* ScenariosObject = nullptr;
+		if (!Root->TryGetObjectField(TEXT("Scenarios"), ScenariosObject))
+		{
+			return true;
+		}
+
+		for (const FChatPerfScenario& Scenario : Scenarios)
+		{
+			const TSharedPtr<FJsonObject>* ScenarioObject = nullptr;
+			if (!(*ScenariosObject)->TryGetObjectField(Scenario.Name, ScenarioObject))
+			{
+				continue;
+			}
+
+			// 很短的帧时间波动较大，另加少量绝对余量
+			CheckUIPerfMetric(Scenario.Name + TEXT(" 平均帧(ms)"), Scenario.GetAverageMs(), (*ScenarioObject)->GetNumberField(TEXT("AvgMs")), Tolerance, 0.1, OutRegressions);
+			CheckUIPerfMetric(Scenario.Name + TEXT(" p95帧(ms)"), Scenario.GetPercentileMs(0.95), (*ScenarioObject)->GetNumberField(TEXT("P95Ms")), Tolerance, 0.2, OutRegressions);
+			CheckUIPerfMetric(Scenario.Name + TEXT(" 小部件数"), Scenario.MaxWidgets, (*ScenarioObject)->GetNumberField(TEXT("Widgets")), Tolerance, 0.0, OutRegressions);
+		}
+		return true;
+	}
+
+	/** 测试参数 */
+	struct FUIPerfSettings
+	{
+		int32 NumMessages = 10000;
+		int32 NumFrames = 240;
+		FVector2D Size = FVector2D(800.0f, 900.0f);
+		float Tolerance = 0.25f;
+
+		/** 以本次结果覆盖基线，不做比较 */
+		bool bSaveBaseline = false;
+	};
+
+	/** 运行所有场景并与基线比较，回归项加入OutRegressions；没有基线时以本次结果作为基线 */
+	static void RunUIPerf(const FUIPerfSettings& Settings, TArray<FString>& OutRegressions)
+	{
+		const int32 NumMessages = FMath::Max(Settings.NumMessages, 1);
+		const int32 NumFrames = FMath::Max(Settings.NumFrames, 10);
+		const FVector2D Size = Settings.Size;
+
+		const double StartMemoryMB = GetUsedPhysicalMB();
+
+		// 合成消息，用户与AI交替，固定种子保证每次相同
+		FRandomStream Stream(2024);
+		FDeepseekMessageStore MessageStore;
+		TArray<TSharedPtr<FChatMessage>> Messages;
+		Messages.Reserve(NumMessages);
+		int64 TextBytes = 0;
+		for (int32 Index = 0; Index < NumMessages; ++Index)
+		{
+			const bool bIsUser = Index % 2 == 0;
+			Messages.Add(MakeShared<FChatMessage>(bIsUser ? TEXT("用户") : TEXT("AI助手"), MessageStore.Add(MakeSyntheticChatMessage(Stream, bIsUser)), bIsUser));
+			TextBytes += Messages.Last()->Message.Len() * sizeof(TCHAR);
+		}
+
+		TArray<FChatPerfScenario> Scenarios;
+		double LoadMs = 0.0;
+		double MemoryMB = 0.0;
+		{
+			FChatPerfHarness Harness(Size);
+			SDeepseekChatSession& Session = Harness.GetSession();
+			SListView<TSharedPtr<FChatMessage>>& ListView = Harness.GetListView();
+
+			// 载入到第一次完整绘制的时间
+			const double LoadStart = FPlatformTime::Seconds();
+			Session.AppendMessages(Messages);
+			Harness.DrawFrame(nullptr);
+			LoadMs = (FPlatformTime::Seconds() - LoadStart) * 1000.0;
+			Messages.Empty();
+			MemoryMB = GetUsedPhysicalMB() - StartMemoryMB;
+
+			// 每个场景先绘制两帧，使新状态下的首次排版不计入
+			auto BeginScenario = [&Scenarios, &Harness](const TCHAR* Name) -> FChatPerfScenario&
+			{
+				Harness.DrawFrame(nullptr);
+				Harness.DrawFrame(nullptr);
+				FChatPerfScenario& Scenario = Scenarios.AddDefaulted_GetRef();
+				Scenario.Name = Name;
+				return Scenario;
+			};
+
+			// 从顶部翻到底部，每帧都需要生成新的行
+			{
+				ListView.ScrollToTop();
+				FChatPerfScenario& Scenario = BeginScenario(TEXT("Scroll"));
+				const float Step = FMath::Max(1.0f, static_cast<float>(NumMessages) / NumFrames);
+				for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+				{
+					ListView.SetScrollOffset(Frame * Step);
+					Harness.DrawFrame(&Scenario);
+				}
+			}
+
+			// 在中间缓慢滚动，模拟滚轮
+			{
+				ListView.SetScrollOffset(NumMessages * 0.5f);
+				FChatPerfScenario& Scenario = BeginScenario(TEXT("Wheel"));
+				for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+				{
+					ListView.SetScrollOffset(NumMessages * 0.5f + Frame * 0.3f);
+					Harness.DrawFrame(&Scenario);
+				}
+			}
+
+			// 在底部接收流式回复，每帧约3个token
+			{
+				FRandomStream ReplyStream(7);
+				FString Reply;
+				while (Reply.Len() < NumFrames * 6)
+				{
+					Reply.Append(MakeSyntheticChatMessage(ReplyStream, false));
+				}
+
+				ListView.ScrollToBottom();
+				Session.BeginSimulatedReply();
+				FChatPerfScenario& Scenario = BeginScenario(TEXT("Stream"));
+				for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+				{
+					Session.AppendSimulatedDelta(Reply.Mid(Frame * 6, 6));
+					ListView.ScrollToBottom();
+					Harness.DrawFrame(&Scenario);
+				}
+				Session.EndSimulatedReply();
+			}
+
+			// 拖动窗口边缘，宽度来回变化，可见的消息全部重新换行
+			{
+				FChatPerfScenario& Scenario = BeginScenario(TEXT("Resize"));
+				for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+				{
+					const float Alpha = 0.5f + 0.5f * FMath::Sin(Frame * 2.0f * PI / 60.0f);
+					Harness.SetSize(FVector2D(FMath::Lerp(Size.X * 0.5f, Size.X * 1.75f, Alpha), Size.Y));
+					Harness.DrawFrame(&Scenario);
+				}
+				Harness.SetSize(Size);
+			}
+
+			MemoryMB = FMath::Max(MemoryMB, GetUsedPhysicalMB() - StartMemoryMB);
+		}
+
+		UE_LOG(LogDeepseek, Display, TEXT("UIPerf: %d 条消息（文本 %.1f MB），%.0fx%.0f，载入并首次绘制 %.0f ms，内存增加 %.1f MB"),
+			NumMessages, TextBytes / (1024.0 * 1024.0), Size.X, Size.Y, LoadMs, MemoryMB);
+		for (const FChatPerfScenario& Scenario : Scenarios)
+		{
+			const int32 Frames = FMath::Max(Scenario.FrameMs.Num(), 1);
+			UE_LOG(LogDeepseek, Display, TEXT("  %-6s 平均 %.3f ms（预处理 %.3f / 绘制 %.3f），p95 %.3f ms，最大 %.3f ms，小部件 %d，行 %d"),
+				*Scenario.Name, Scenario.GetAverageMs(), Scenario.PrepassMs / Frames, Scenario.PaintMs / Frames,
+				Scenario.GetPercentileMs(0.95), Scenario.GetPercentileMs(1.0), Scenario.MaxWidgets, Scenario.MaxRows);
+		}
+
+		if (Settings.bSaveBaseline || !CompareUIPerfBaseline(NumMessages, MemoryMB, Scenarios, Settings.Tolerance, OutRegressions))
+		{
+			SaveUIPerfBaseline(NumMessages, MemoryMB, Scenarios);
+		}
+	}
+
+	/** Deepseek.UIPerf [Messages=10000] [Frames=240] [Width=800] [Height=900] [Tolerance=0.25] [SaveBaseline] */
+	static void RunUIPerfCommand(const TArray<FString>& Args)
+	{
+		if (!FSlateApplication::IsInitialized())
+		{
+			UE_LOG(LogDeepseek, Warning, TEXT("UIPerf: Slate未初始化"));
+			return;
+		}
+
+		const FString Joined = FString::Join(Args, TEXT(" "));
+		FUIPerfSettings Settings;
+		FParse::Value(*Joined, TEXT("Messages="), Settings.NumMessages);
+		FParse::Value(*Joined, TEXT("Frames="), Settings.NumFrames);
+		FParse::Value(*Joined, TEXT("Width="), Settings.Size.X);
+		FParse::Value(*Joined, TEXT("Height="), Settings.Size.Y);
+		FParse::Value(*Joined, TEXT("Tolerance="), Settings.Tolerance);
+		Settings.bSaveBaseline = Args.ContainsByPredicate([](const FString& Arg) { return Arg.Equals(TEXT("SaveBaseline"), ESearchCase::IgnoreCase); });
+
+		TArray<FString> Regressions;
+		RunUIPerf(Settings, Regressions);
+		for (const FString& Regression : Regressions)
+		{
+			UE_LOG(LogDeepseek, Error, TEXT("%s"), *Regression);
+		}
+	}
+
+	static FAutoConsoleCommand UIPerfCommand(
+		TEXT("Deepseek.UIPerf"),
+		TEXT("以指定参数运行问答界面的性能测试，或以SaveBaseline重新保存基线；默认参数的测试为自动化测试Deepseek.UIPerf.ChatPanel。")
+		TEXT("用法: Deepseek.UIPerf [Messages=10000] [Frames=240] [Width=800] [Height=900] [Tolerance=0.25] [SaveBaseline]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunUIPerfCommand));
+}
+
+/**
+ * 以默认参数运行问答界面的所有场景，任何一项超过基线时失败；第一次运行时保存基线
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDeepseekUIPerfTest, "Deepseek.UIPerf.ChatPanel",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FDeepseekUIPerfTest::RunTest(const FString& Parameters)
+{
+	if (!FSlateApplication::IsInitialized())
+	{
+		AddError(TEXT("Slate未初始化"));
+		return false;
+	}
+
+	TArray<FString> Regressions;
+	DeepseekUIPerf::RunUIPerf(DeepseekUIPerf::FUIPerfSettings(), Regressions);
+	for (const FString& Regression : Regressions)
+	{
+		AddError(Regression);
+	}
+	return Regressions.Num() == 0;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 对冲请求策略
+ * 流式请求在一段时间内没有收到首字节时，把同一请求再发往备用的OpenAI兼容地址，先开始输出的一方胜出，另一方被取消；
+ * 等待时间取最近首字节耗时的某个百分位，对冲次数不超过请求数的一定比例；只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekHedgePolicy
+{
+public:
+	/** 统计 */
+	struct FStats
+	{
+		int32 Requests = 0;
+		int32 Hedges = 0;
+		int32 HedgeWins = 0;
+	};
+
+	/** 创建全局策略，备用地址与参数从配置读取，未配置备用地址时不对冲 */
+	static void Initialize();
+
+	/** 释放全局策略 */
+	static void Shutdown();
+
+	/** 全局策略，未初始化时返回空 */
+	static FDeepseekHedgePolicy* Get();
+
+	/** 设置备用地址，模型为空时沿用原请求的模型；密钥为空时只有与服务同一主机的备用地址才会使用服务的密钥 */
+	void SetSecondary(const FString& InApiUrl, const FString& InApiKey, const FString& InModel);
+
+	/** 设置触发对冲的百分位、对冲占请求数的上限比例与最短等待时间 */
+	void SetPolicy(float InPercentile, float InMaxHedgeRatio, float InMinDelaySeconds);
+
+	/** 是否配置了备用地址 */
+	bool IsEnabled() const { return !SecondaryApiUrl.IsEmpty() && MaxHedgeRatio > 0.0f; }
+
+	/** 备用地址 */
+	const FString& GetSecondaryApiUrl() const { return SecondaryApiUrl; }
+	const FString& GetSecondaryApiKey() const { return SecondaryApiKey; }
+	const FString& GetSecondaryModel() const { return SecondaryModel; }
+
+	/** 记录一个主地址请求的首字节耗时 */
+	void AddFirstByteSample(double Seconds);
+
+	/** 记录一个新请求，按比例积累对冲额度；返回本请求的对冲等待时间，样本不足时返回负数 */
+	double OnRequestStarted();
+
+	/** 消耗一次对冲额度，额度不足时返回false */
+	bool TryAcquireHedge();
+
+	/** 对冲请求先开始输出 */
+	void OnHedgeWon() { ++Stats.HedgeWins; }
+
+	/** 获取统计信息 */
+	const FStats& GetStats() const { return Stats; }
+
+private:
+	/** 构造函数 */
+	FDeepseekHedgePolicy();
+
+	/** 最近首字节耗时的百分位 */
+	double ComputePercentile() const;
+
+private:
+	/** 保留的最近样本数 */
+	static const int32 MaxSamples = 256;
+
+	/** 开始对冲前至少需要的样本数 */
+	static const int32 MinSamples = 20;
+
+	/** 备用地址 */
+	FString SecondaryApiUrl;
+	FString SecondaryApiKey;
+	FString SecondaryModel;
+
+	/** 触发对冲的百分位 */
+	float Percentile;
+
+	/** 对冲占请求数的上限比例 */
+	float MaxHedgeRatio;
+
+	/** 最短等待时间 */
+	float MinDelaySeconds;
+
+	/** 首字节耗时样本，环形缓冲 */
+	TArray<double> Samples;
+	int32 NextSample;
+
+	/** 可用的对冲额度，每个请求增加MaxHedgeRatio，每次对冲消耗1 */
+	double HedgeCredit;
+
+	/** 统计 */
+	FStats Stats;
+
+	/** 全局实例 */
+	static TUniquePtr<FDeepseekHedgePolicy> Instance;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DeepseekOpenAIService.h"
+
+/**
+ * 聊天历史压缩器
+ * 历史超过阈值时，用一个独立的低成本模型请求把较早的轮次总结为一条摘要消息，
+ * 用户可以继续对话，摘要返回后再一次性替换到历史中；界面上的聊天记录不受影响
+ */
+class DEEPSEEK_API FDeepseekHistoryCompactor : public TSharedFromThis<FDeepseekHistoryCompactor>
+{
+public:
+	/** 构造函数 */
+	FDeepseekHistoryCompactor();
+
+	/** 初始化摘要请求使用的服务 */
+	void Initialize(const FString& InApiKey, const FString& InModel, const FString& InApiUrl);
+
+	/** 设置触发压缩的token阈值，0表示关闭 */
+	void SetThreshold(int32 InThresholdTokens);
+
+	/**
+	 * 历史超过阈值且没有进行中的压缩时，在后台请求摘要
+	 * 摘要返回后在游戏线程调用OnCompacted，参数为被折叠的消息数与摘要内容
+	 */
+	bool MaybeCompact(const TArray<FOpenAIMessage>& History, TFunction<void(int32, const FString&)> OnCompacted);
+
+	/** 丢弃进行中的压缩结果，清空聊天记录时调用 */
+	void Cancel();
+
+	/** 是否有进行中的压缩 */
+	bool IsCompacting() const { return bCompacting; }
+
+	/** 用一条摘要消息替换系统消息之后的NumFolded条消息 */
+	static void ApplySummary(TArray<FOpenAIMessage>& History, int32 NumFolded, const FString& Summary);
+
+	/** 是否为压缩生成的摘要消息 */
+	static bool IsSummaryMessage(const FOpenAIMessage& Message);
+
+private:
+	/** 选择要折叠的消息数，从系统消息之后开始，到某条用户消息之前结束 */
+	int32 SelectFoldCount(const TArray<FOpenAIMessage>& History) const;
+
+	/** 第一条可折叠消息的下标 */
+	static int32 GetFirstFoldIndex(const TArray<FOpenAIMessage>& History);
+
+private:
+	/** 摘要请求使用的服务 */
+	TSharedPtr<FDeepseekOpenAIService> SummaryService;
+
+	/** 进行中的摘要请求 */
+	FDeepseekRequestHandle SummaryRequest;
+
+	/** 触发压缩的token阈值 */
+	int32 ThresholdTokens;
+
+	/** 是否有进行中的压缩 */
+	bool bCompacting;
+
+	/** 每次取消后递增，用于丢弃过期的摘要 */
+	uint32 Generation;
+};
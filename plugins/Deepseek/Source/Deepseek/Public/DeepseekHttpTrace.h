@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FDeepseekMockServer;
+
+/**
+ * 一段响应字节及其到达时间
+ */
+struct FDeepseekTraceChunk
+{
+	/** 相对发出请求的毫秒数 */
+	uint32 OffsetMs = 0;
+
+	TArray<uint8> Bytes;
+};
+
+/**
+ * 一次HTTP交换：请求体与按到达时间分段的原始响应字节，不包含Authorization等请求头
+ */
+struct FDeepseekTraceExchange
+{
+	TArray<uint8> RequestBody;
+	bool bStream = false;
+	int32 ResponseCode = 0;
+	FString ContentType;
+	FString RetryAfter;
+	TArray<FDeepseekTraceChunk> Chunks;
+
+	/** 录制时发出请求的时间，不写入文件 */
+	double StartTime = 0.0;
+
+	/** 记录新到达的字节 */
+	void AddChunk(const uint8* Data, int32 Num);
+};
+
+/**
+ * HTTP录制与回放
+ * 录制时服务把每次尝试的请求体与原始响应字节（流式响应保留每段的到达时间）追加到紧凑的二进制轨迹文件；
+ * 回放时在本地启动模拟服务按记录的时间或加速后的时间送出这些字节，服务的所有请求都发往它，
+ * HTTP、解码与界面的流程与真实请求完全相同，但不需要网络；
+ * 回放的请求与隔离请求一样不读写响应缓存、不记账，也不影响限流器、提供方池与对冲策略；只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekHttpTrace
+{
+public:
+	/** 创建全局实例 */
+	static void Initialize();
+
+	/** 停止录制与回放并释放全局实例 */
+	static void Shutdown();
+
+	/** 全局实例，未初始化时返回空 */
+	static FDeepseekHttpTrace* Get();
+
+	/** 析构函数 */
+	~FDeepseekHttpTrace();
+
+	/** 开始录制到文件，已有文件时在其后追加 */
+	bool StartRecording(const FString& FilePath);
+
+	/** 开始回放，Speed为回放速度倍数，0表示不等待 */
+	bool StartReplay(const FString& FilePath, float Speed);
+
+	/** 停止录制或回放 */
+	void Stop();
+
+	bool IsRecording() const { return !RecordPath.IsEmpty(); }
+	bool IsReplaying() const { return ReplayServer.IsValid(); }
+
+	/** 回放服务的地址 */
+	FString GetReplayUrl() const;
+
+	/** 录制一次交换 */
+	void AddExchange(const FDeepseekTraceExchange& Exchange);
+
+	/** 读取轨迹文件 */
+	static bool LoadFile(const FString& FilePath, TArray<FDeepseekTraceExchange>& OutExchanges);
+
+	/** 默认的录制文件 */
+	static FString GetDefaultTracePath();
+
+private:
+	/** 构造函数 */
+	FDeepseekHttpTrace();
+
+private:
+	/** 录制中的文件，未录制时为空 */
+	FString RecordPath;
+
+	/** 已录制的交换数 */
+	int32 NumRecorded;
+
+	/** 回放服务 */
+	TUniquePtr<FDeepseekMockServer> ReplayServer;
+
+	/** 全局实例 */
+	static TUniquePtr<FDeepseekHttpTrace> Instance;
+};
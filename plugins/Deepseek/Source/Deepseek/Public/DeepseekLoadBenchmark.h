@@ -0,0 +1,73 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DeepseekMockServer.h"
+#include "DeepseekOpenAIService.h"
+
+/**
+ * 端到端压测
+ * Concurrency个服务各自逐个发送请求，共TotalRequests个，全部发往本地模拟服务；
+ * 每个服务是调度器中的一个会话，压测期间调度器的并发上限至少提高到Concurrency，结束后恢复；
+ * 只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekLoadBenchmark : public TSharedFromThis<FDeepseekLoadBenchmark>
+{
+public:
+	/** 构造函数 */
+	FDeepseekLoadBenchmark(int32 InConcurrency, int32 InTotalRequests, bool bInStream);
+
+	/** 析构函数，未结束时恢复调度器的并发上限 */
+	~FDeepseekLoadBenchmark();
+
+	/** 启动模拟服务与各服务，发出第一批请求；模拟服务启动失败时返回false */
+	bool Start(const FDeepseekMockServerSettings& ServerSettings);
+
+	/** 所有请求都已完成 */
+	bool IsFinished() const { return NumCompleted >= TotalRequests; }
+
+	/** 完成时调用，此时仍在服务的回调中，不能在其中释放压测 */
+	TFunction<void()> OnFinished;
+
+	/** 实际的并发数：请求数与调度器的并发上限中较小的一个 */
+	int32 GetEffectiveConcurrency() const { return EffectiveConcurrency; }
+
+	int32 GetNumCompleted() const { return NumCompleted; }
+	int32 GetNumFailed() const { return NumFailed; }
+
+private:
+	/** 由第Worker个服务发出下一个请求，内容各不相同，避免被合并 */
+	void SendNext(int32 Worker);
+
+	void OnRequestCompleted(int32 Worker, double SendTime, double FirstDeltaTime, const FDeepseekChatReplyRef& Reply);
+
+	/** 输出吞吐、延迟分位数与每个请求占用的游戏线程时间 */
+	void Report(double EndTime);
+
+	/** 恢复压测前调度器的并发上限 */
+	void RestoreMaxConcurrent();
+
+private:
+	int32 Concurrency;
+	int32 TotalRequests;
+	bool bStream;
+
+	/** 压测前调度器的并发上限，没有提高时为0 */
+	int32 PreviousMaxConcurrent;
+	int32 EffectiveConcurrency;
+
+	TUniquePtr<FDeepseekMockServer> Server;
+	TArray<TUniquePtr<FDeepseekOpenAIService>> Services;
+
+	int32 NumSent;
+	int32 NumCompleted;
+	int32 NumFailed;
+	int32 NumRetries;
+	int64 CompletionTokens;
+
+	/** 成功请求从发送到完成、到第一段内容的时间（秒） */
+	TArray<double> Latencies;
+	TArray<double> FirstDeltaLatencies;
+
+	double StartTime;
+	double StartGameThreadSeconds;
+};
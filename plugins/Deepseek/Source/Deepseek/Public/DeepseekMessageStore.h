@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 消息文本块
+ * 容量在创建时一次分配，之后只在末尾追加，已写入的文本不会移动也不会被修改
+ */
+struct FDeepseekTextChunk
+{
+	TArray<TCHAR> Chars;
+};
+
+/**
+ * 不可变的消息文本
+ * 引用文本块中以'\0'结尾的一段，复制只增加文本块的引用计数，最后一个引用释放时文本块随之释放
+ */
+class DEEPSEEK_API FDeepseekMessageText
+{
+public:
+	/** 空文本 */
+	FDeepseekMessageText()
+		: Offset(0)
+		, Length(0)
+	{}
+
+	/** 单独分配一块保存文本，用于不经过消息存储的临时消息 */
+	explicit FDeepseekMessageText(FStringView Text);
+
+	/** 以'\0'结尾的字符 */
+	const TCHAR* operator*() const { return Chunk.IsValid() ? Chunk->Chars.GetData() + Offset : TEXT(""); }
+
+	FStringView View() const { return FStringView(**this, Length); }
+	int32 Len() const { return Length; }
+	bool IsEmpty() const { return Length == 0; }
+	FString ToString() const { return FString(Length, **this); }
+
+	/** 比较内容，引用同一段存储时不逐字比较 */
+	bool Equals(const FDeepseekMessageText& Other) const;
+
+private:
+	/** 所在的文本块，空文本时为空 */
+	TSharedPtr<const FDeepseekTextChunk, ESPMode::ThreadSafe> Chunk;
+
+	/** 在文本块中的位置与长度（不含'\0'） */
+	int32 Offset;
+	int32 Length;
+
+	friend class FDeepseekMessageStore;
+};
+
+/**
+ * 会话的消息存储
+ * 只追加：每条消息的文本只复制一次，写入按块分配的存储，之后聊天记录、发给API的聊天历史与请求体缓存都引用这一份不可变的文本；
+ * 较长的文本单独成块，文本块在最后一个引用释放时回收，因此清空或折叠的消息不会一直占用内存
+ */
+class DEEPSEEK_API FDeepseekMessageStore
+{
+public:
+	/** 构造函数 */
+	FDeepseekMessageStore();
+
+	/** 追加一段文本 */
+	FDeepseekMessageText Add(FStringView Text);
+
+	/** 不再向当前的文本块追加，使其可以随引用一起释放；用于清空会话 */
+	void Reset();
+
+	/** 累计追加的字符数与文本块数 */
+	int64 GetNumChars() const { return NumChars; }
+	int32 GetNumChunks() const { return NumChunks; }
+
+private:
+	/** 每个文本块的字符数 */
+	static constexpr int32 ChunkChars = 16 * 1024;
+
+	/** 正在追加的文本块 */
+	TSharedPtr<FDeepseekTextChunk, ESPMode::ThreadSafe> CurrentChunk;
+
+	int64 NumChars;
+	int32 NumChunks;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Async/Future.h"
+#include "Misc/SecureHash.h"
+#include "DeepseekHttpTrace.h"
+
+class FSocket;
+class FRunnableThread;
+
+/**
+ * 模拟服务的响应行为
+ */
+struct FDeepseekMockServerSettings
+{
+	/** 监听端口，0表示由系统分配 */
+	int32 Port = 0;
+
+	/** 收到请求到发出第一段内容的时间（秒） */
+	float FirstTokenSeconds = 0.3f;
+
+	/** 生成速度（token/s），0表示第一段之后立即发出全部内容 */
+	float TokensPerSecond = 50.0f;
+
+	/** 每个回复的token数 */
+	int32 CompletionTokens = 200;
+
+	/** 每个token的字符数，决定响应的大小 */
+	int32 CharsPerToken = 2;
+
+	/** 每个流式事件包含的token数 */
+	int32 TokensPerChunk = 1;
+
+	/** 返回500的比例 */
+	float ErrorRate = 0.0f;
+
+	/** 返回429的比例 */
+	float RateLimitRate = 0.0f;
+
+	/** 429响应中Retry-After的秒数 */
+	int32 RetryAfterSeconds = 1;
+
+	/** 回放的交换，设置后忽略以上的生成与注入设置 */
+	TSharedPtr<const TArray<FDeepseekTraceExchange>, ESPMode::ThreadSafe> Trace;
+
+	/** 回放速度倍数，0表示不等待 */
+	float ReplaySpeed = 1.0f;
+
+	/** 从命令行形式的参数读取，如 "TTFT=0.3 TPS=50 Tokens=200 Error=0.05 RateLimit=0.05 Trace=文件 Speed=2"，未给出的保持不变 */
+	void ParseFrom(const TCHAR* Args);
+};
+
+/**
+ * 本地模拟的OpenAI兼容服务
+ * 在127.0.0.1上实现POST /chat/completions的流式（SSE）与非流式响应，可配置首token时间、生成速度、
+ * 响应大小以及500与429的注入比例，用于在没有密钥和网络时测量插件的性能；
+ * 也可以回放录制的交换：请求体与录制时相同的使用对应的响应，否则依次轮流使用；
+ * 监听线程接受连接，每个连接一个线程，支持keep-alive
+ */
+class DEEPSEEK_API FDeepseekMockServer : public FRunnable
+{
+public:
+	/** 累计计数，可在任意线程读取 */
+	struct FStats
+	{
+		TAtomic<int32> Connections{ 0 };
+		TAtomic<int32> Requests{ 0 };
+		TAtomic<int32> StreamRequests{ 0 };
+		TAtomic<int32> InjectedErrors{ 0 };
+		TAtomic<int32> InjectedRateLimits{ 0 };
+	};
+
+	/** 构造函数 */
+	explicit FDeepseekMockServer(const FDeepseekMockServerSettings& InSettings);
+
+	/** 析构函数，停止服务 */
+	virtual ~FDeepseekMockServer();
+
+	/** 开始监听，端口被占用等情况返回false */
+	bool Start();
+
+	/** 停止监听，断开所有连接并等待连接线程结束 */
+	void Shutdown();
+
+	/** chat/completions的完整地址 */
+	FString GetUrl() const;
+
+	/** 累计计数 */
+	const FStats& GetStats() const { return Stats; }
+
+	/** 响应行为 */
+	const FDeepseekMockServerSettings& GetSettings() const { return Settings; }
+
+	//~ Begin FRunnable Interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable Interface
+
+private:
+	/** 在连接线程中处理一个连接上的所有请求 */
+	void HandleConnection(FSocket* Socket, uint32 Seed);
+
+	/** 读取一个请求，连接关闭或服务停止时返回false */
+	bool ReadRequest(FSocket* Socket, TArray<uint8>& Buffer, FString& OutRequestLine, TArray<uint8>& OutBody, bool& bOutKeepAlive);
+
+	/** 发送全部数据 */
+	bool SendAll(FSocket* Socket, const FString& Data);
+
+	/** 发送全部字节 */
+	bool SendBytes(FSocket* Socket, const uint8* Data, int32 Num);
+
+	/** 以chunked编码发送一块数据 */
+	bool SendChunk(FSocket* Socket, const FString& Data);
+	bool SendChunk(FSocket* Socket, const uint8* Data, int32 Num);
+
+	/** 按记录的时间送出一次录制的响应 */
+	bool ReplayExchange(FSocket* Socket, const TArray<uint8>& RequestBody, double ReceivedTime, bool bKeepAlive);
+
+	/** 等待到指定时间，服务停止时返回false */
+	bool WaitUntil(double Time) const;
+
+	/** 第Index个token的内容 */
+	FString MakeTokenText(int32 Index) const;
+
+private:
+	/** 响应行为 */
+	FDeepseekMockServerSettings Settings;
+
+	/** 监听套接字 */
+	FSocket* ListenSocket;
+
+	/** 监听线程 */
+	FRunnableThread* Thread;
+
+	/** 实际监听的端口 */
+	int32 BoundPort;
+
+	/** 是否正在停止 */
+	TAtomic<bool> bStopping;
+
+	/** 连接线程，停止时等待它们结束 */
+	TArray<TFuture<void>> Connections;
+	FCriticalSection ConnectionsMutex;
+
+	/** 累计计数 */
+	FStats Stats;
+
+	/** 录制的请求体哈希到交换的下标 */
+	TMap<FSHAHash, int32> TraceIndex;
+
+	/** 没有对应请求体时轮流使用的下一个交换 */
+	TAtomic<int32> NextTraceExchange;
+};
@@ -4,17 +4,34 @@
 #include "Http.h"
 #include "Json.h"
 #include "JsonObjectConverter.h"
+#include "Misc/SecureHash.h"
+#include "DeepseekMessageStore.h"
+#include "DeepseekRequestBodyCache.h"
+#include "DeepseekRequestScheduler.h"
 
 /**
- * OpenAI API响应的消息结构
+ * 聊天历史中的一条消息，内容与聊天记录共享同一份不可变文本
  */
 struct FOpenAIMessage
 {
 	FString Role;
-	FString Content;
+	FDeepseekMessageText Content;
+
+	/** 缓存的token数，INDEX_NONE表示尚未计算 */
+	mutable int32 CachedTokenCount = INDEX_NONE;
 
 	FOpenAIMessage() {}
-	FOpenAIMessage(const FString& InRole, const FString& InContent) : Role(InRole), Content(InContent) {}
+	FOpenAIMessage(const FString& InRole, const FDeepseekMessageText& InContent) : Role(InRole), Content(InContent) {}
+	FOpenAIMessage(const FString& InRole, FStringView InContent) : Role(InRole), Content(InContent) {}
+};
+
+/**
+ * OpenAI API响应的消息结构
+ */
+struct FOpenAIResponseMessage
+{
+	FString Role;
+	FString Content;
 };
 
 /**
@@ -22,9 +39,9 @@ struct FOpenAIMessage
  */
 struct FOpenAIChoice
 {
-	FOpenAIMessage Message;
+	FOpenAIResponseMessage Message;
 	FString FinishReason;
-	int32 Index;
+	int32 Index = 0;
 };
 
 /**
@@ -32,9 +49,15 @@ struct FOpenAIChoice
  */
 struct FOpenAIUsage
 {
-	int32 PromptTokens;
-	int32 CompletionTokens;
-	int32 TotalTokens;
+	int32 PromptTokens = 0;
+	int32 CompletionTokens = 0;
+	int32 TotalTokens = 0;
+
+	/** 命中服务端前缀缓存的提示token数 */
+	int32 PromptCacheHitTokens = 0;
+
+	/** 未命中前缀缓存的提示token数 */
+	int32 PromptCacheMissTokens = 0;
 };
 
 /**
@@ -44,14 +67,138 @@ struct FOpenAIResponse
 {
 	FString Id;
 	FString Object;
-	int32 Created;
+	int32 Created = 0;
 	FString Model;
 	TArray<FOpenAIChoice> Choices;
 	FOpenAIUsage Usage;
 };
 
+/**
+ * 一次请求各阶段的耗时（秒），由HTTP进度回调估算，精度约为一帧
+ */
+struct FDeepseekRequestTimings
+{
+	/** 在调度器中排队的时间 */
+	double QueueSeconds = 0.0;
+
+	/** 选择上下文窗口并序列化请求体 */
+	double SerializeSeconds = 0.0;
+
+	/** 发出到开始上传请求体，包括DNS、TCP与TLS；复用已有连接时接近0 */
+	double ConnectSeconds = 0.0;
+
+	/** 开始上传到收到第一个响应字节，即服务端处理时间 */
+	double ServerSeconds = 0.0;
+
+	/** 第一个响应字节到响应结束 */
+	double TransferSeconds = 0.0;
+
+	/** 发出到收到第一个响应字节 */
+	double FirstByteSeconds = 0.0;
+
+	/** 发出到解析出第一段回复内容；非流式请求为整个响应到达的时间 */
+	double FirstTokenSeconds = 0.0;
+
+	/** 在后台解析响应的累计时间 */
+	double DecodeSeconds = 0.0;
+
+	/** 在游戏线程执行增量与完成回调的累计时间，只出现在请求统计中 */
+	double UIApplySeconds = 0.0;
+
+	/** 调用发送到完成回调，包括排队与重试，只出现在请求统计中 */
+	double TotalSeconds = 0.0;
+
+	/** 重试次数 */
+	int32 Retries = 0;
+
+	/** 是否来自实际的HTTP请求 */
+	bool IsValid() const { return ConnectSeconds + ServerSeconds + TransferSeconds > 0.0; }
+};
+
+/**
+ * 交给调用方的聊天回复，在后台线程组装完成后不再修改
+ */
+struct FDeepseekChatReply
+{
+	/** 是否成功 */
+	bool bSuccess = false;
+
+	/** 回复内容，失败时为错误信息 */
+	FString Content;
+
+	/** 结束原因；流式回复中途停滞被中断时为timeout，内容为已收到的部分 */
+	FString FinishReason;
+
+	/** 使用情况 */
+	FOpenAIUsage Usage;
+
+	/** 实际回答的模型，对冲请求使用备用模型时与服务的模型不同；缓存命中与失败时为空 */
+	FString Model;
+
+	/** 最后一次尝试的各阶段耗时，缓存命中与失败时为空 */
+	FDeepseekRequestTimings Timings;
+};
+
+typedef TSharedRef<const FDeepseekChatReply, ESPMode::ThreadSafe> FDeepseekChatReplyRef;
+
+/** 增量回调，在游戏线程调用 */
+typedef TFunction<void(const FString&)> FOnDeepseekChatDelta;
+
+/** 完成回调，在游戏线程调用 */
+typedef TFunction<void(const FDeepseekChatReplyRef&)> FOnDeepseekChatCompleted;
+
+/**
+ * 单次请求的选项
+ */
+struct FDeepseekRequestOptions
+{
+	/** 跳过响应缓存，总是发出请求；成功的回复仍会写入缓存 */
+	bool bBypassCache = false;
+
+	/** 在调度器中的优先级 */
+	EDeepseekRequestPriority Priority = EDeepseekRequestPriority::Normal;
+
+	/** 只发往服务自己的地址：不经提供方池、不对冲、不读写响应缓存、不记入用量账本，用于本地压测 */
+	bool bIsolated = false;
+};
+
+struct FDeepseekChatRequestState;
+struct FDeepseekRequestGroup;
+
+/**
+ * 请求句柄，用于取消尚未结束的请求；丢弃句柄不会取消请求
+ * 相同的请求在进行中时会合并为一个，每个调用方各有一个句柄，最后一个调用方取消时才真正取消请求
+ */
+class DEEPSEEK_API FDeepseekRequestHandle
+{
+public:
+	FDeepseekRequestHandle() {}
+
+	/** 取消请求：不再调用本调用方的回调；没有其他调用方时排队中的不再发出，进行中的断开连接 */
+	void Cancel();
+
+	/** 请求是否尚未结束，包括排队与等待重试 */
+	bool IsActive() const;
+
+	/** 放开句柄，不影响请求 */
+	void Reset() { Group.Reset(); }
+
+private:
+	friend class FDeepseekOpenAIService;
+
+	FDeepseekRequestHandle(const TSharedRef<FDeepseekRequestGroup>& InGroup, uint32 InSubscriberId) : Group(InGroup), SubscriberId(InSubscriberId) {}
+
+	/** 合并到同一请求上的调用方，请求结束后释放 */
+	TWeakPtr<FDeepseekRequestGroup> Group;
+
+	/** 本调用方在其中的ID */
+	uint32 SubscriberId = 0;
+};
+
 /**
  * OpenAI服务类，用于与OpenAI API通信
+ * 响应的解码与组装在后台任务中进行，回调总是在游戏线程调用
+ * 连接失败、429与5xx会按指数退避重试；服务析构时取消它发出的所有请求，之后不再调用回调
  */
 class DEEPSEEK_API FDeepseekOpenAIService
 {
@@ -65,15 +212,148 @@ public:
 	/** 初始化服务 */
 	void Initialize(const FString& InApiKey, const FString& InModel = TEXT("deepseek-chat"), const FString& InApiUrl = TEXT("https://api.deepseek.com/chat/completions"));
 
-	/** 发送聊天请求 */
-	void SendChatRequest(const TArray<FOpenAIMessage>& Messages, TFunction<void(const FString&, bool)> OnCompleted);
+	/** 设置上下文预算：上下文总token上限与为回复预留的max_tokens */
+	void SetContextBudget(int32 InMaxContextTokens, int32 InMaxTokens);
+
+	/** 估算下一次请求的提示token数，包括尚未发送的用户输入 */
+	int32 EstimatePromptTokens(const TArray<FOpenAIMessage>& Messages, const FString& PendingUserMessage) const;
+
+	/**
+	 * 设置超时：总超时从首次发出算起，包括重试；首字节超时只用于流式请求，每次尝试单独计时。0表示不限
+	 * 已经开始输出的流式回复不受总超时限制，只在输出停滞超过首字节超时时中断
+	 */
+	void SetTimeouts(float InTotalTimeoutSeconds, float InFirstByteTimeoutSeconds);
+
+	/** 设置失败后的最大重试次数 */
+	void SetMaxRetries(int32 InMaxRetries);
+
+	/** 是否复用连接；关闭时每个请求都带Connection: close，用于排查代理问题 */
+	void SetKeepAlive(bool bInKeepAlive);
+
+	/**
+	 * 预热到ApiUrl所在主机的连接：发出一个不消耗token的HEAD请求，
+	 * 让DNS、TCP与TLS握手在第一次提问之前完成，连接留在HTTP模块的连接缓存中；
+	 * 每个主机只预热一次
+	 */
+	static void PrewarmConnection(const FString& InApiUrl);
+
+	/** 取消本服务发出的所有未结束的请求 */
+	void CancelAll();
+
+	/** 重置上下文窗口，清空聊天记录后调用 */
+	void ResetContext();
+
+	/** 上下文总token上限 */
+	int32 GetMaxContextTokens() const { return MaxContextTokens; }
+
+	/** 在调度器中的会话ID，同一服务的请求按顺序逐个发出 */
+	uint32 GetSessionId() const { return SessionId; }
+
+	/** 所有服务在游戏线程累计花费的时间（秒），包括调用回调的时间，用于压测 */
+	static double GetGameThreadSeconds();
+
+	/** 已发送的请求中，messages前缀与上一次请求不一致的次数 */
+	int32 GetPrefixBreaks() const { return PrefixBreaks; }
+
+	/**
+	 * 查找与最后一条用户消息近似（上下文相同）的历史回复，不发出请求
+	 * 命中时返回回复内容与签名的汉明距离，由调用方决定是否采用；回放轨迹时总是返回false
+	 */
+	bool FindSimilarReply(const TArray<FOpenAIMessage>& Messages, FString& OutContent, int32& OutDistance) const;
+
+	/** 发送聊天请求，响应缓存命中时不发出HTTP请求，直接回调并返回空句柄 */
+	FDeepseekRequestHandle SendChatRequest(const TArray<FOpenAIMessage>& Messages, FOnDeepseekChatCompleted OnCompleted, const FDeepseekRequestOptions& Options = FDeepseekRequestOptions());
+
+	/** 发送流式聊天请求，每收到一段增量内容调用OnDelta，结束时以完整内容调用OnCompleted */
+	FDeepseekRequestHandle SendChatStreamRequest(const TArray<FOpenAIMessage>& Messages, FOnDeepseekChatDelta OnDelta, FOnDeepseekChatCompleted OnCompleted, const FDeepseekRequestOptions& Options = FDeepseekRequestOptions());
 
 private:
-	/** 处理HTTP响应 */
-	void HandleResponse(FHttpResponsePtr Response, bool bWasSuccessful, TFunction<void(const FString&, bool)> OnCompleted);
+	/** 流式与非流式请求的共同流程 */
+	FDeepseekRequestHandle SendRequest(const TArray<FOpenAIMessage>& Messages, bool bStream, FOnDeepseekChatDelta OnDelta, FOnDeepseekChatCompleted OnCompleted, const FDeepseekRequestOptions& Options);
+
+	/** 序列化请求体并填写请求的配置，配置无效时返回false并设置错误信息 */
+	bool PrepareChatRequest(const TArray<FOpenAIMessage>& Messages, bool bStream, FDeepseekChatRequestState& OutState, FString& OutError);
+
+	/**
+	 * 选择本次发送的上下文窗口：固定保留系统消息，从最新消息向前保留预算内的轮次；
+	 * 超出预算时一次多丢弃一些旧轮次，让窗口在之后若干轮内保持稳定
+	 */
+	void UpdateContextWindow(const TArray<FOpenAIMessage>& Messages, int32& OutNumPinned);
+
+	/** 计算在额外ExtraTokens的情况下满足预算的窗口起点 */
+	int32 ComputeWindowStart(const TArray<FOpenAIMessage>& Messages, int32 NumPinned, int32 ExtraTokens) const;
+
+	/** 用当前请求体计算缓存键并查找缓存，必须在PrepareChatRequest之后调用 */
+	bool LookupCachedReply(const FDeepseekRequestOptions& Options, FSHAHash& OutKey, FString& OutContent) const;
+
+	/** 包装完成回调，正常结束的回复写入响应缓存，并登记最后一条用户消息的近似签名 */
+	static FOnDeepseekChatCompleted StoreReplyOnCompleted(const FSHAHash& Key, const TArray<FOpenAIMessage>& Messages, FOnDeepseekChatCompleted OnCompleted);
+
+	/** 经全局调度器发出一次尝试，调度器未初始化时直接发出 */
+	static void StartAttempt(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State);
+
+	/** 轮到该请求时创建HTTP请求、开始计时并发出 */
+	static void ProcessAttempt(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State);
+
+	/** 一次尝试结束，在游戏线程决定重试还是交给调用方 */
+	static void FinishAttempt(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State, const FDeepseekChatReplyRef& Reply);
+
+	/** 请求结束，调用完成回调 */
+	static void CompleteRequest(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State, const FDeepseekChatReplyRef& Reply);
+
+	/** 总超时到达 */
+	static void OnTotalTimeout(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State);
+
+	/** 对冲等待时间到达，仍未收到首字节且额度允许时向备用地址发出同一请求 */
+	static void LaunchHedge(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State);
+
+	/** 收到首字节，决出主请求与对冲请求的胜负并取消另一方 */
+	static void OnFirstByte(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State);
+
+	/** 把回调交给对冲请求，并取消主请求 */
+	static void HandOverToHedge(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State);
+
+	/** 取消请求 */
+	static void CancelRequest(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State);
+
+	/** 移除一个调用方，最后一个调用方离开时取消请求 */
+	static void Unsubscribe(const TSharedRef<FDeepseekRequestGroup>& Group, uint32 SubscriberId);
+
+	/** 合并进行中请求的键：地址、密钥与规范化的请求体 */
+	static FSHAHash MakeCoalesceKey(const FDeepseekChatRequestState& State);
+
+	/** 第Attempt次重试前的等待时间：指数退避加随机抖动，且不短于服务端要求的Retry-After */
+	static double ComputeRetryDelay(int32 Attempt, double RetryAfterSeconds);
+
+	/** 读取Retry-After头，支持秒数与HTTP日期，没有时返回0 */
+	static double ParseRetryAfter(const FHttpResponsePtr& Response);
+
+	/** 可以重试的HTTP状态码 */
+	static bool IsRetryableStatus(int32 ResponseCode);
+
+	/** 窗口内消息的token数 */
+	static int32 CountWindowTokens(const TArray<FOpenAIMessage>& Messages, int32 NumPinned, int32 InWindowStart);
+
+	/** 在后台线程解码非流式响应，Model为请求使用的模型 */
+	static FDeepseekChatReplyRef DecodeResponse(FHttpResponsePtr Response, bool bWasSuccessful, const FString& Model, const FDeepseekRequestTimings& Timings);
+
+	/** 把新到达的响应字节交给后台解析 */
+	static void EnqueueStreamBytes(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State, FHttpResponsePtr Response);
+
+	/** 在后台线程解析累积的流式字节，直到没有新数据 */
+	static void DrainStream(const TSharedRef<FDeepseekChatRequestState, ESPMode::ThreadSafe>& State);
+
+	/** 解析流式响应中的单个事件 */
+	static bool ParseStreamEvent(const FString& EventData, FString& OutDelta, FString& OutFinishReason, FOpenAIUsage& OutUsage);
 
 	/** 解析JSON响应 */
-	bool ParseResponse(const FString& ResponseString, FOpenAIResponse& OutResponse);
+	static bool ParseResponse(FString&& ResponseString, FOpenAIResponse& OutResponse);
+
+	/** 生成失败回复 */
+	static FDeepseekChatReplyRef MakeErrorReply(const FString& Error);
+
+	/** 在游戏线程调用完成回调 */
+	static void DeliverReply(const FOnDeepseekChatCompleted& OnCompleted, const FDeepseekChatReplyRef& Reply);
 
 private:
 	/** API密钥 */
@@ -85,6 +365,38 @@ private:
 	/** API地址 */
 	FString ApiUrl;
 
-	/** HTTP请求模块 */
-	FHttpModule* HttpModule;
+	/** 请求体增量序列化缓存 */
+	FDeepseekRequestBodyCache RequestBodyCache;
+
+	/** 上下文总token上限 */
+	int32 MaxContextTokens;
+
+	/** 为回复预留的token数，即请求中的max_tokens */
+	int32 MaxTokens;
+
+	/** 当前窗口中最早的非固定消息下标 */
+	int32 WindowStart;
+
+	/** 前缀被打破的次数 */
+	int32 PrefixBreaks;
+
+	/** 在调度器中的会话ID */
+	uint32 SessionId;
+
+	/** 总超时秒数 */
+	float TotalTimeoutSeconds;
+
+	/** 流式请求的首字节超时秒数 */
+	float FirstByteTimeoutSeconds;
+
+	/** 最大重试次数 */
+	int32 MaxRetries;
+
+	/** 是否复用连接 */
+	bool bKeepAlive;
+
+	/** 本服务发出或合并到的请求，服务析构时取消 */
+	TArray<FDeepseekRequestHandle> ActiveRequests;
+
+	friend class FDeepseekRequestHandle;
 };
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 提供方
+ * 一个OpenAI兼容地址及其密钥、可用模型与权重，以及路由用的运行时状态
+ */
+struct FDeepseekProvider
+{
+	FString Name;
+	FString ApiUrl;
+
+	/** 提供方自己的密钥，必须设置 */
+	FString ApiKey;
+
+	/** 可用的模型，为空时接受任意模型 */
+	TArray<FString> Models;
+
+	/** 权重，越大越容易被选中 */
+	float Weight = 1.0f;
+
+	/** 首字节耗时的指数加权平均，尚无样本时为0 */
+	double LatencyEwma = 0.0;
+
+	/** 连续失败次数 */
+	int32 ConsecutiveFailures = 0;
+
+	/** 被熔断的截止时间，0表示正常 */
+	double EjectedUntil = 0.0;
+
+	/** 本次熔断的时长，恢复探测失败后加倍 */
+	double EjectSeconds = 0.0;
+
+	/** 熔断到期后正在用一个请求探测 */
+	bool bProbing = false;
+
+	/** 统计 */
+	int32 Requests = 0;
+	int32 Failures = 0;
+
+	/** 是否接受该模型 */
+	bool SupportsModel(const FString& Model) const { return Models.Num() == 0 || Models.Contains(Model); }
+};
+
+/**
+ * 提供方池
+ * 在多个OpenAI兼容地址之间按最近的首字节耗时路由请求，连续失败的地址被熔断一段时间，到期后用一个请求探测是否恢复；
+ * 池为空或没有可用地址时由服务使用自己的地址；只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekProviderPool
+{
+public:
+	/** 创建全局提供方池，提供方从配置读取 */
+	static void Initialize();
+
+	/** 释放全局提供方池 */
+	static void Shutdown();
+
+	/** 全局提供方池，未初始化时返回空 */
+	static FDeepseekProviderPool* Get();
+
+	/** 添加提供方，没有密钥的提供方被忽略 */
+	void AddProvider(const FDeepseekProvider& Provider);
+
+	/** 设置熔断阈值、首次熔断时长与最长熔断时长 */
+	void SetCircuitBreaker(int32 InFailureThreshold, float InEjectSeconds, float InMaxEjectSeconds);
+
+	/** 是否没有任何提供方 */
+	bool IsEmpty() const { return Providers.Num() == 0; }
+
+	/** 所有提供方 */
+	const TArray<FDeepseekProvider>& GetProviders() const { return Providers; }
+
+	/**
+	 * 为一次请求选择提供方
+	 * @param Model 请求使用的模型
+	 * @param ExcludeIndex 刚失败的提供方，有其他选择时避开
+	 * @return 提供方索引，没有可用的提供方时返回INDEX_NONE
+	 */
+	int32 SelectProvider(const FString& Model, int32 ExcludeIndex = INDEX_NONE);
+
+	/** 除ExcludeIndex外是否还有可以立即使用的提供方 */
+	bool HasAlternative(const FString& Model, int32 ExcludeIndex) const;
+
+	/** 获取提供方 */
+	const FDeepseekProvider* GetProvider(int32 Index) const { return Providers.IsValidIndex(Index) ? &Providers[Index] : nullptr; }
+
+	/** 请求成功，记录首字节耗时 */
+	void ReportSuccess(int32 Index, double FirstByteSeconds);
+
+	/** 请求因连接失败、超时或服务端错误而失败 */
+	void ReportFailure(int32 Index);
+
+	/** 输出各提供方状态到日志 */
+	void DumpStatus() const;
+
+private:
+	/** 构造函数 */
+	FDeepseekProviderPool();
+
+private:
+	/** 新样本的权重 */
+	static constexpr double EwmaAlpha = 0.2;
+
+	/** 提供方 */
+	TArray<FDeepseekProvider> Providers;
+
+	/** 连续失败多少次后熔断 */
+	int32 FailureThreshold;
+
+	/** 首次熔断时长 */
+	float EjectSeconds;
+
+	/** 最长熔断时长 */
+	float MaxEjectSeconds;
+
+	/** 全局实例 */
+	static TUniquePtr<FDeepseekProviderPool> Instance;
+};
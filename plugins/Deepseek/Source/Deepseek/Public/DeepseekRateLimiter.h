@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/IHttpResponse.h"
+
+/**
+ * 客户端限流器
+ * 用两个令牌桶同时限制每秒请求数与每分钟估算token数，并根据响应中的x-ratelimit-*与Retry-After头调整；
+ * 由请求调度器在发出请求前查询，超出限制的请求留在调度器队列中等待；只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekRateLimiter
+{
+public:
+	/** 构造函数 */
+	FDeepseekRateLimiter();
+
+	/** 设置每秒请求数与每分钟token数上限，0表示不限制 */
+	void SetLimits(float InRequestsPerSecond, int32 InTokensPerMinute);
+
+	/** 每秒请求数上限 */
+	float GetRequestsPerSecond() const { return RequestsPerSecond; }
+
+	/** 每分钟token数上限，可能来自服务端返回的限额 */
+	int32 GetTokensPerMinute() const { return TokensPerMinute; }
+
+	/** 估算需要Tokens个token的请求还要等待多少秒，可以立即发出时返回0 */
+	double GetWaitSeconds(int32 Tokens);
+
+	/** 发出请求，扣除一个请求与估算的token */
+	void Acquire(int32 Tokens);
+
+	/** 请求完成后按实际用量修正估算的token */
+	void Reconcile(int32 EstimatedTokens, int32 ActualTokens);
+
+	/** 根据响应头更新限额与剩余额度，429或带Retry-After时暂停发出请求 */
+	void UpdateFromResponse(const FHttpResponsePtr& Response);
+
+	/** 暂停发出请求 */
+	void PauseFor(double Seconds);
+
+	/** 解析x-ratelimit-reset-*的时长，如"1s"、"6m0s"、"20ms"，失败时返回负数 */
+	static double ParseDuration(const FString& Value);
+
+private:
+	/** 按经过的时间补充两个桶 */
+	void Refill(double Now);
+
+private:
+	/** 每秒请求数上限 */
+	float RequestsPerSecond;
+
+	/** 每分钟token数上限 */
+	int32 TokensPerMinute;
+
+	/** 两个桶当前的余量 */
+	double RequestBucket;
+	double TokenBucket;
+
+	/** 上次补充的时间 */
+	double LastRefillTime;
+
+	/** 暂停到此时间 */
+	double PausedUntil;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DeepseekMessageStore.h"
+
+struct FOpenAIMessage;
+
+/**
+ * 请求体增量序列化缓存
+ * 保存已转义、已编码为UTF-8的messages数组前缀，每轮只序列化新追加的消息，
+ * 不构建JSON DOM，直接写入输出缓冲
+ */
+class DEEPSEEK_API FDeepseekRequestBodyCache
+{
+public:
+	/** 构造函数 */
+	FDeepseekRequestBodyCache();
+
+	/**
+	 * 同步缓存与消息窗口：只序列化新增的消息，已缓存的消息被改写或窗口移动时整体重建
+	 * 窗口由开头固定保留的NumPinned条消息和从WindowStart开始的其余消息组成
+	 * 返回false表示已有的前缀被丢弃，即服务端的前缀缓存也会失效
+	 */
+	bool Update(const TArray<FOpenAIMessage>& Messages, int32 NumPinned = 0, int32 WindowStart = 0);
+
+	/**
+	 * 用缓存的messages前缀组装完整请求体
+	 * 字段顺序与数字格式固定，messages之后的字段不影响前缀
+	 */
+	void BuildBody(const FString& Model, double Temperature, int32 MaxTokens, bool bStream, TArray<uint8>& OutBody) const;
+
+	/** 清空缓存 */
+	void Reset();
+
+	/** 已序列化的messages数组内容，用于计算响应缓存键 */
+	const TArray<uint8>& GetSerializedMessages() const { return SerializedMessages; }
+
+	/** 已缓存的消息数 */
+	int32 Num() const { return CachedMessages.Num(); }
+
+private:
+	/** 检查已缓存的消息是否仍与消息列表一致 */
+	bool IsPrefixOf(const TArray<FOpenAIMessage>& Messages, int32 NumPinned, int32 WindowStart) const;
+
+	/** 窗口中第SequenceIndex条消息在消息列表中的下标 */
+	static int32 ToMessageIndex(int32 SequenceIndex, int32 NumPinned, int32 WindowStart);
+
+	/** 序列化一条消息并追加到缓冲 */
+	static void AppendMessage(TArray<uint8>& Out, const FOpenAIMessage& Message);
+
+	/** 以JSON字符串形式（含引号和转义）追加UTF-8编码 */
+	static void AppendJsonString(TArray<uint8>& Out, FStringView Value);
+
+	/** 追加ASCII字面量 */
+	static void AppendLiteral(TArray<uint8>& Out, const ANSICHAR* Literal);
+
+private:
+	/** 已序列化的messages数组内容（不含方括号） */
+	TArray<uint8> SerializedMessages;
+
+	/** 已缓存的一条消息 */
+	struct FCachedMessage
+	{
+		FString Role;
+
+		/** 与聊天历史共享，不复制；历史未被改写时比较只需判断引用的是同一段文本 */
+		FDeepseekMessageText Content;
+	};
+
+	/** 已缓存的消息，用于发现历史被改写，包括停止请求后换成等长的新提问 */
+	TArray<FCachedMessage> CachedMessages;
+
+	/** 缓存对应的窗口 */
+	int32 CachedNumPinned;
+	int32 CachedWindowStart;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "DeepseekRateLimiter.h"
+
+/**
+ * 请求优先级，数值越大越先发出
+ */
+enum class EDeepseekRequestPriority : uint8
+{
+	/** 后台任务，如历史压缩 */
+	Background,
+
+	/** 默认 */
+	Normal,
+
+	/** 用户正在等待的提问 */
+	Interactive,
+};
+
+/**
+ * 模块级请求调度器
+ * 所有会话的请求都经过这里排队：同时进行的请求数有上限，同一会话内按先后顺序逐个发出，
+ * 不同会话之间优先级高的先发出，同优先级按排队顺序；超出速率限制时请求留在队列中，等限流器放行再发出；只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekRequestScheduler
+{
+public:
+	/** 排队统计 */
+	struct FStats
+	{
+		/** 已发出的请求数 */
+		int32 Started = 0;
+
+		/** 因速率限制而推迟发出的次数 */
+		int32 RateLimited = 0;
+
+		/** 累计与最长的排队时间 */
+		double TotalWaitSeconds = 0.0;
+		double MaxWaitSeconds = 0.0;
+
+		/** 最大队列深度 */
+		int32 MaxQueueDepth = 0;
+
+		/** 平均排队时间 */
+		double GetAverageWaitSeconds() const { return Started > 0 ? TotalWaitSeconds / Started : 0.0; }
+	};
+
+	/** 析构函数 */
+	~FDeepseekRequestScheduler();
+
+	/** 创建全局调度器，并发上限从配置读取 */
+	static void Initialize();
+
+	/** 释放全局调度器，排队中的请求不再发出 */
+	static void Shutdown();
+
+	/** 全局调度器，未初始化时返回空 */
+	static FDeepseekRequestScheduler* Get();
+
+	/** 分配一个新的会话ID，0保留给不属于任何会话的请求 */
+	static uint32 AllocateSessionId();
+
+	/**
+	 * 排队一个请求，轮到它且限流器放行时调用Start发出；请求结束后必须调用一次Finish
+	 * @param EstimatedTokens 估算的提示与回复token数，用于按每分钟token数限流
+	 * 返回用于Finish或Cancel的票据
+	 */
+	uint64 Enqueue(uint32 SessionId, EDeepseekRequestPriority Priority, int32 EstimatedTokens, TFunction<void()> Start);
+
+	/** 请求已结束，释放占用的并发名额 */
+	void Finish(uint64 Ticket);
+
+	/** 取消仍在排队的请求，已发出的请求返回false */
+	bool Cancel(uint64 Ticket);
+
+	/** 设置同时进行的请求数上限 */
+	void SetMaxConcurrent(int32 InMaxConcurrent);
+
+	/** 同时进行的请求数上限 */
+	int32 GetMaxConcurrent() const { return MaxConcurrent; }
+
+	/** 正在进行的请求数 */
+	int32 GetNumActive() const { return Active.Num(); }
+
+	/** 排队中的请求数 */
+	int32 GetNumQueued() const { return Queue.Num(); }
+
+	/** 排队统计 */
+	const FStats& GetStats() const { return Stats; }
+
+	/** 限流器，请求完成后用响应头与实际用量更新 */
+	FDeepseekRateLimiter& GetRateLimiter() { return RateLimiter; }
+
+private:
+	/** 排队中的请求 */
+	struct FQueuedRequest
+	{
+		uint64 Ticket = 0;
+		uint32 SessionId = 0;
+		EDeepseekRequestPriority Priority = EDeepseekRequestPriority::Normal;
+		int32 EstimatedTokens = 0;
+		double EnqueueTime = 0.0;
+		TFunction<void()> Start;
+	};
+
+	/** 构造函数 */
+	FDeepseekRequestScheduler();
+
+	/** 在名额允许时发出可以发出的请求 */
+	void Pump();
+
+	/** 选出下一个要发出的请求，没有时返回INDEX_NONE */
+	int32 SelectNext() const;
+
+	/** 限流器要求等待时，到时再发出 */
+	void ScheduleWakeUp(double Seconds);
+
+private:
+	/** 按排队顺序排列的请求 */
+	TArray<FQueuedRequest> Queue;
+
+	/** 已发出的请求票据及其会话 */
+	TMap<uint64, uint32> Active;
+
+	/** 有请求正在进行的会话 */
+	TSet<uint32> BusySessions;
+
+	/** 同时进行的请求数上限 */
+	int32 MaxConcurrent;
+
+	/** 限流器 */
+	FDeepseekRateLimiter RateLimiter;
+
+	/** 等待限流器放行的定时器 */
+	FTSTicker::FDelegateHandle WakeUpTimer;
+
+	/** 排队统计 */
+	FStats Stats;
+
+	/** 下一个票据 */
+	uint64 NextTicket;
+
+	/** 防止Start中再次进入Pump */
+	bool bPumping;
+
+	/** 全局实例 */
+	static TUniquePtr<FDeepseekRequestScheduler> Instance;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DeepseekOpenAIService.h"
+
+/**
+ * 请求的各个阶段
+ */
+enum class EDeepseekRequestPhase : uint8
+{
+	Queue,
+	Serialize,
+	Connect,
+	FirstByte,
+	FirstToken,
+	Decode,
+	UIApply,
+	Total,
+
+	Num
+};
+
+/**
+ * 一次请求的记录
+ */
+struct FDeepseekRequestSample
+{
+	/** 完成时间 */
+	FDateTime Time;
+
+	FString Model;
+	bool bStream = false;
+	bool bSuccess = false;
+
+	/** 各阶段耗时 */
+	FDeepseekRequestTimings Timings;
+
+	int32 PromptTokens = 0;
+	int32 CompletionTokens = 0;
+
+	/** 某个阶段的耗时秒数 */
+	double GetPhaseSeconds(EDeepseekRequestPhase Phase) const;
+
+	/** 生成速度：回复token数除以首字节之后的传输时间，没有用量时为0 */
+	double GetTokensPerSecond() const;
+};
+
+/**
+ * 请求统计
+ * 保留最近的请求记录，计算各阶段耗时与生成速度的p50/p95/p99，并可导出为CSV；
+ * 记录同时作为Unreal Insights计数器输出；只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekRequestStats
+{
+public:
+	/** 百分位 */
+	struct FPercentiles
+	{
+		double P50 = 0.0;
+		double P95 = 0.0;
+		double P99 = 0.0;
+	};
+
+	/** 创建全局统计 */
+	static void Initialize();
+
+	/** 释放全局统计 */
+	static void Shutdown();
+
+	/** 全局统计，未初始化时返回空 */
+	static FDeepseekRequestStats* Get();
+
+	/** 阶段的显示名 */
+	static const TCHAR* GetPhaseName(EDeepseekRequestPhase Phase);
+
+	/** 记录一次完成的请求 */
+	void AddSample(const FDeepseekRequestSample& Sample);
+
+	/** 某个阶段在成功请求中的百分位，单位秒 */
+	FPercentiles GetPhasePercentiles(EDeepseekRequestPhase Phase) const;
+
+	/** 生成速度在成功请求中的百分位，单位token/秒 */
+	FPercentiles GetTokensPerSecondPercentiles() const;
+
+	/** 保留的记录数 */
+	int32 GetNumSamples() const { return Samples.Num(); }
+
+	/** 每次记录变化时加一，供界面判断是否需要刷新 */
+	uint32 GetGeneration() const { return Generation; }
+
+	/** 清空记录 */
+	void Reset();
+
+	/** 按时间顺序导出所有记录 */
+	bool ExportCsv(const FString& FilePath) const;
+
+	/** 默认的导出路径 */
+	static FString GetDefaultExportPath();
+
+private:
+	/** 构造函数 */
+	FDeepseekRequestStats();
+
+	/** 按时间顺序遍历记录 */
+	template <typename FunctorType>
+	void ForEachSample(FunctorType&& Functor) const
+	{
+		const int32 First = Samples.Num() < MaxSamples ? 0 : NextSample;
+		for (int32 Offset = 0; Offset < Samples.Num(); ++Offset)
+		{
+			Functor(Samples[(First + Offset) % Samples.Num()]);
+		}
+	}
+
+	/** 对成功请求的某个取值计算百分位 */
+	template <typename GetterType>
+	FPercentiles ComputePercentiles(GetterType&& Getter) const;
+
+private:
+	/** 保留的最近记录数 */
+	static const int32 MaxSamples = 1024;
+
+	/** 记录，环形缓冲 */
+	TArray<FDeepseekRequestSample> Samples;
+	int32 NextSample;
+
+	uint32 Generation;
+
+	/** 全局实例 */
+	static TUniquePtr<FDeepseekRequestStats> Instance;
+};
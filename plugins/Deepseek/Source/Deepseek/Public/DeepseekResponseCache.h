@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+#include "DeepseekSimilarPromptIndex.h"
+
+/**
+ * 持久化的内容寻址响应缓存
+ * 以(模型, API地址, 温度, 序列化后的消息)的SHA1为键，回复内容按键存放在单独的文件中；
+ * 索引文件启动时以内存映射方式读取，按最近访问时间和总大小淘汰；
+ * 另有一个近似重复提问索引指向同一批回复
+ */
+class DEEPSEEK_API FDeepseekResponseCache
+{
+public:
+	/** 缓存统计 */
+	struct FStats
+	{
+		int32 Hits = 0;
+		int32 Misses = 0;
+		int32 SimilarHits = 0;
+		int32 NumEntries = 0;
+		int64 TotalBytes = 0;
+	};
+
+	/** 创建并加载全局缓存 */
+	static void Initialize();
+
+	/** 写回索引并释放全局缓存 */
+	static void Shutdown();
+
+	/** 全局缓存，未初始化时返回空 */
+	static FDeepseekResponseCache* Get();
+
+	/** 计算缓存键 */
+	static FSHAHash MakeKey(const FString& Model, const FString& ApiUrl, double Temperature, const TArray<uint8>& SerializedMessages);
+
+	/**
+	 * 计算请求的哈希，缓存键与合并请求的键共用
+	 * @param HeaderFields 不含换行的字段，以换行连接
+	 * @param Body 序列化的消息或请求体，与字段之间以一个0字节分隔
+	 */
+	static FSHAHash HashRequest(TArrayView<const FString> HeaderFields, TArrayView<const uint8> Body);
+
+	/** 查找缓存的回复，命中时更新访问时间 */
+	bool Lookup(const FSHAHash& Key, FString& OutContent);
+
+	/** 保存回复，超出容量时淘汰最久未访问的条目 */
+	void Store(const FSHAHash& Key, const FString& Content);
+
+	/** 为回复登记近似提问签名，需先Store */
+	void AddSimilar(const FDeepseekPromptSignature& Signature, const FSHAHash& Key);
+
+	/** 查找近似提问的回复，不影响精确命中统计 */
+	bool LookupSimilar(const FDeepseekPromptSignature& Signature, FString& OutContent, int32& OutDistance);
+
+	/** 清空缓存 */
+	void Clear();
+
+	/** 获取统计信息 */
+	const FStats& GetStats() const { return Stats; }
+
+	/** 设置容量上限 */
+	void SetLimits(int64 InMaxTotalBytes, int32 InMaxEntries);
+
+private:
+	/** 索引条目 */
+	struct FEntry
+	{
+		uint32 Size = 0;
+		int64 LastAccessTicks = 0;
+	};
+
+	/** 构造函数 */
+	explicit FDeepseekResponseCache(const FString& InCacheDir);
+
+	/** 从映射的索引文件读取条目 */
+	void LoadIndex();
+
+	/** 把索引写回磁盘 */
+	void SaveIndex();
+
+	/** 淘汰条目直到低于容量上限 */
+	void EvictIfNeeded();
+
+	/** 条目对应的内容文件 */
+	FString GetBlobPath(const FSHAHash& Key) const;
+
+	/** 索引文件路径 */
+	FString GetIndexPath() const;
+
+	/** 近似提问索引文件路径 */
+	FString GetSimilarIndexPath() const;
+
+	/** 删除一个条目及其文件 */
+	void RemoveEntry(const FSHAHash& Key);
+
+private:
+	/** 缓存目录 */
+	FString CacheDir;
+
+	/** 内存中的索引 */
+	TMap<FSHAHash, FEntry> Entries;
+
+	/** 近似提问索引 */
+	FDeepseekSimilarPromptIndex SimilarIndex;
+
+	/** 统计信息 */
+	FStats Stats;
+
+	/** 容量上限 */
+	int64 MaxTotalBytes;
+	int32 MaxEntries;
+
+	/** 索引是否有未写回的修改 */
+	bool bIndexDirty;
+
+	/** 近似提问索引是否有未写回的修改 */
+	bool bSimilarIndexDirty;
+
+	/** 自上次写回以来的写入次数 */
+	int32 StoresSinceSave;
+
+	/** 全局实例 */
+	static TUniquePtr<FDeepseekResponseCache> Instance;
+};
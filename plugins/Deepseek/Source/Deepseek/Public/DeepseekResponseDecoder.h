@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/JsonReader.h"
+
+struct FOpenAIResponse;
+struct FOpenAIChoice;
+struct FOpenAIUsage;
+
+/**
+ * 流式（SAX风格）响应解码器
+ * 逐个读取JSON记号，一遍填充FOpenAIResponse，只提取需要的字段，不构建DOM；
+ * 缺失的字段保持默认值
+ */
+class DEEPSEEK_API FDeepseekResponseDecoder
+{
+public:
+	/** 解码完整的非流式响应 */
+	static bool DecodeResponse(FString&& ResponseString, FOpenAIResponse& OutResponse);
+
+	/** 解码流式响应中的单个事件，choices[].delta写入Message */
+	static bool DecodeStreamChunk(const FString& EventData, FOpenAIResponse& OutChunk);
+
+private:
+	/** 读取根对象 */
+	static bool ReadResponse(TJsonReader<TCHAR>& Reader, FOpenAIResponse& OutResponse);
+
+	/** 读取choices数组 */
+	static bool ReadChoices(TJsonReader<TCHAR>& Reader, TArray<FOpenAIChoice>& OutChoices);
+
+	/** 读取单个choice对象 */
+	static bool ReadChoice(TJsonReader<TCHAR>& Reader, FOpenAIChoice& OutChoice);
+
+	/** 读取message或delta对象 */
+	static bool ReadMessage(TJsonReader<TCHAR>& Reader, FOpenAIChoice& OutChoice);
+
+	/** 读取usage对象 */
+	static bool ReadUsage(TJsonReader<TCHAR>& Reader, FOpenAIUsage& OutUsage);
+
+	/** 跳过当前不关心的值 */
+	static bool SkipValue(TJsonReader<TCHAR>& Reader, EJsonNotation Notation);
+};
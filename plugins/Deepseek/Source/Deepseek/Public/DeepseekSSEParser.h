@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * text/event-stream 增量解析器
+ * 按块输入原始UTF-8字节，跨块重组完整的行与事件，输出每个事件的data内容
+ */
+class DEEPSEEK_API FDeepseekSSEParser
+{
+public:
+	/** 构造函数 */
+	FDeepseekSSEParser();
+
+	/** 输入新到达的字节，解析出的完整事件data追加到OutEvents */
+	void Feed(const uint8* Data, int32 Num, TArray<FString>& OutEvents);
+
+	/** 是否已收到[DONE]结束标记 */
+	bool IsDone() const { return bDone; }
+
+	/** 重置解析状态 */
+	void Reset();
+
+private:
+	/** 处理一行（不含换行符） */
+	void ProcessLine(const uint8* Line, int32 Len, TArray<FString>& OutEvents);
+
+	/** 派发当前累积的事件 */
+	void DispatchEvent(TArray<FString>& OutEvents);
+
+private:
+	/** 尚未形成完整行的字节 */
+	TArray<uint8> PendingBytes;
+
+	/** 当前事件已累积的data字节 */
+	TArray<uint8> EventData;
+
+	/** 当前事件是否包含data字段 */
+	bool bHasEventData;
+
+	/** 是否已结束 */
+	bool bDone;
+};
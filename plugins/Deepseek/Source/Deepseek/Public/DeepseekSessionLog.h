@@ -0,0 +1,116 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * 会话记录
+ * 每个会话的聊天记录追加写入一个日志文件，另有一个只保存记录位置的索引文件；
+ * 打开时只读取索引，消息按需从映射的文件区域中解析，长记录也能立即打开。
+ * 清空聊天记录只追加一条清空记录，之前的记录在后台压缩时丢弃。
+ * 除后台压缩外只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekSessionLog : public TSharedFromThis<FDeepseekSessionLog, ESPMode::ThreadSafe>
+{
+public:
+	/** 消息的角色 */
+	enum class ERole : uint8
+	{
+		/** 系统提示、错误等，只显示不加入聊天历史 */
+		Notice = 0,
+		User = 1,
+		Assistant = 2,
+	};
+
+	/** 一条消息记录 */
+	struct FRecord
+	{
+		ERole Role = ERole::Notice;
+		FString Sender;
+		FString Text;
+	};
+
+	/** 新建会话记录，路径为空时在会话目录中新建；第一次写入时才创建文件 */
+	static TSharedRef<FDeepseekSessionLog, ESPMode::ThreadSafe> Create(const FString& LogPath = FString());
+
+	/** 打开已有的会话记录，索引与日志不一致时重建索引；打开失败返回空 */
+	static TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Open(const FString& LogPath);
+
+	/** 已保存的会话记录文件，按创建时间排序 */
+	static TArray<FString> FindLogs();
+
+	/** 当前（最后一次清空之后）的消息数 */
+	int32 Num() const { return Entries.Num() - FirstLive; }
+
+	/** 日志文件的大小 */
+	int64 GetFileSize() const { return LogSize; }
+
+	/** 追加一条消息 */
+	void Append(ERole Role, const FString& Sender, const FString& Text);
+
+	/** 追加清空记录，之前的消息不再读出 */
+	void AppendClear();
+
+	/**
+	 * 读取当前消息中的一段
+	 * @param First 第一条消息的序号，0为最早的一条
+	 * @param Count 消息数
+	 * @return 是否全部读取成功
+	 */
+	bool ReadMessages(int32 First, int32 Count, TArray<FRecord>& OutRecords) const;
+
+	/** 已清空的记录占到一定比例时在后台重写日志，只保留当前消息 */
+	void CompactIfNeeded();
+
+	/** 是否正在后台压缩 */
+	bool IsCompacting() const { return bCompacting; }
+
+	/** 删除会话记录文件，之后的写入被忽略 */
+	void Delete();
+
+private:
+	/** 构造函数 */
+	explicit FDeepseekSessionLog(const FString& InLogPath);
+
+	/** 读取索引，与日志不一致时重建 */
+	bool Load();
+
+	/** 扫描日志重建索引，截掉末尾不完整的记录 */
+	bool RebuildIndex();
+
+	/** 写入完整的索引文件 */
+	bool SaveIndex(const FString& Path, const TArray<uint64>& InEntries) const;
+
+	/** 追加一条记录及其索引 */
+	void AppendRecord(uint8 Type, const TArray<uint8>& Payload);
+
+	/** 读取日志中的一段字节交给Visit，优先映射文件，映射失败时读入内存 */
+	bool ReadRegion(int64 Offset, int64 Size, TFunctionRef<bool(TArrayView<const uint8>)> Visit) const;
+
+	/** 后台压缩完成，在游戏线程替换文件 */
+	void FinishCompaction(int32 SnapshotFirstLive, int32 SnapshotNum, int64 SnapshotSize, const TArray<uint64>& CompactedEntries, int64 CompactedSize);
+
+	/** 索引项中的记录位置与类型 */
+	static int64 GetOffset(uint64 Entry) { return static_cast<int64>(Entry & ((1ull << 56) - 1)); }
+	static uint8 GetType(uint64 Entry) { return static_cast<uint8>(Entry >> 56); }
+	static uint64 MakeEntry(int64 Offset, uint8 Type) { return static_cast<uint64>(Offset) | (static_cast<uint64>(Type) << 56); }
+
+private:
+	/** 日志与索引文件 */
+	FString LogPath;
+	FString IndexPath;
+
+	/** 每条记录一项，记录位置与类型 */
+	TArray<uint64> Entries;
+
+	/** 最后一次清空之后的第一项 */
+	int32 FirstLive;
+
+	/** 日志文件的大小 */
+	int64 LogSize;
+
+	/** 是否正在后台压缩 */
+	bool bCompacting;
+
+	/** 文件已删除 */
+	bool bDeleted;
+};
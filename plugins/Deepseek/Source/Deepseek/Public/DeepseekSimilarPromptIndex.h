@@ -0,0 +1,105 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+
+struct FOpenAIMessage;
+
+/**
+ * 用户提问的局部敏感签名
+ */
+struct FDeepseekPromptSignature
+{
+	/** 规范化后提问的64位SimHash */
+	uint64 SimHash = 0;
+
+	/** 模型、接口地址、温度、系统提示词与之前若干条消息的哈希，只有上下文相同的提问才会互相匹配 */
+	uint32 ContextHash = 0;
+
+	/** 未规范化提问的哈希，完全相同的提问由精确缓存处理 */
+	uint32 PromptHash = 0;
+};
+
+/**
+ * 近似重复提问索引
+ * 提问先规范化（大小写、空白、数字），按字符三元组计算SimHash；
+ * 64位签名分为4段16位，以(上下文, 段号, 段值)为桶，汉明距离不超过3的签名必定落在同一个桶中，
+ * 查找只需访问4个桶，与索引大小基本无关，完全在本地运行
+ */
+class DEEPSEEK_API FDeepseekSimilarPromptIndex
+{
+public:
+	/** 默认允许的最大汉明距离 */
+	static const int32 DefaultMaxDistance = 3;
+
+	/** 参与上下文哈希的之前消息数 */
+	static const int32 ContextMessages = 2;
+
+	/** 构造函数 */
+	FDeepseekSimilarPromptIndex();
+
+	/**
+	 * 为最后一条用户消息计算签名，最后一条不是用户消息时返回false
+	 * 模型、接口地址和温度与响应缓存键相同，一并计入上下文哈希
+	 */
+	static bool MakeSignature(const FString& Model, const FString& ApiUrl, double Temperature, const TArray<FOpenAIMessage>& Messages, FDeepseekPromptSignature& OutSignature);
+
+	/** 规范化提问：转小写、合并空白、把连续数字替换为同一个占位符 */
+	static FString NormalizePrompt(FStringView Prompt);
+
+	/** 计算规范化文本的SimHash */
+	static uint64 ComputeSimHash(const FString& NormalizedText);
+
+	/** 添加一条签名及其对应的响应缓存键 */
+	void Add(const FDeepseekPromptSignature& Signature, const FSHAHash& Key);
+
+	/** 查找上下文相同且距离最近的签名，跳过原文完全相同的条目 */
+	bool FindNearest(const FDeepseekPromptSignature& Signature, int32 MaxDistance, FSHAHash& OutKey, int32& OutDistance) const;
+
+	/** 清空索引 */
+	void Reset();
+
+	/** 条目数 */
+	int32 Num() const { return Entries.Num(); }
+
+	/** 设置条目上限，超出时丢弃最早的四分之一 */
+	void SetMaxEntries(int32 InMaxEntries);
+
+	/** 保存到文件 */
+	bool Save(const FString& Path) const;
+
+	/** 从文件加载，格式不符时保持为空 */
+	void Load(const FString& Path);
+
+private:
+	/** 索引条目 */
+	struct FEntry
+	{
+		uint64 SimHash = 0;
+		uint32 ContextHash = 0;
+		uint32 PromptHash = 0;
+		FSHAHash Key;
+	};
+
+	/** 桶键：高32位为上下文哈希，低位为段号与段值 */
+	static uint64 MakeBucketKey(uint32 ContextHash, int32 Band, uint64 SimHash);
+
+	/** 把条目加入它的4个桶 */
+	void AddToBuckets(int32 EntryIndex);
+
+	/** 丢弃最早的条目并重建桶 */
+	void Trim();
+
+private:
+	/** 按添加顺序排列的条目 */
+	TArray<FEntry> Entries;
+
+	/** 桶到条目下标的映射 */
+	TMap<uint64, TArray<int32>> Buckets;
+
+	/** 已索引的缓存键，避免重复添加 */
+	TSet<FSHAHash> Keys;
+
+	/** 条目上限 */
+	int32 MaxEntries;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FOpenAIMessage;
+
+/**
+ * 本地token计数器
+ * 按BPE分词器的预切分规则把文本切成片段（字母串、数字串、标点串、空白、中日韩字符），
+ * 再按各类片段在DeepSeek词表中的平均合并长度估算token数，只用于预算，不要求逐个精确
+ */
+class DEEPSEEK_API FDeepseekTokenizer
+{
+public:
+	/** 估算文本的token数 */
+	static int32 CountTokens(FStringView Text);
+
+	/** 估算一条消息的token数（含角色等格式开销），结果缓存在消息上 */
+	static int32 CountMessageTokens(const FOpenAIMessage& Message);
+
+	/** 每条消息的格式开销 */
+	static constexpr int32 MessageOverheadTokens = 4;
+
+private:
+	/** 字符类别 */
+	enum class ECharClass : uint8
+	{
+		Letter,
+		Digit,
+		Space,
+		Newline,
+		CJK,
+		Punctuation,
+		Other
+	};
+
+	/** 判断字符类别 */
+	static ECharClass Classify(TCHAR Char);
+
+	/** 估算同类字符组成的片段的token数 */
+	static int32 CountPieceTokens(ECharClass Class, int32 Length);
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DeepseekOpenAIService.h"
+
+/**
+ * 用量账本
+ * 每个完成的请求把usage追加到磁盘上的紧凑二进制文件，启动时读回；按模型、按天、按会话的累计在追加时增量更新，
+ * 费用按配置的单价从token数计算，单价变化后历史费用随之更新；只在游戏线程使用
+ */
+class DEEPSEEK_API FDeepseekUsageLedger
+{
+public:
+	/** 累计用量 */
+	struct FTotals
+	{
+		int32 Requests = 0;
+		int64 PromptTokens = 0;
+		int64 CompletionTokens = 0;
+
+		/** 提示token中命中服务端前缀缓存的部分 */
+		int64 CacheHitTokens = 0;
+
+		int64 GetTotalTokens() const { return PromptTokens + CompletionTokens; }
+	};
+
+	/** 每百万token的单价 */
+	struct FPrice
+	{
+		double PromptPerMillion = 0.0;
+		double CacheHitPerMillion = 0.0;
+		double CompletionPerMillion = 0.0;
+	};
+
+	/** 创建全局账本，读取账本文件与单价、预算配置 */
+	static void Initialize();
+
+	/** 释放全局账本 */
+	static void Shutdown();
+
+	/** 全局账本，未初始化时返回空 */
+	static FDeepseekUsageLedger* Get();
+
+	/** 记录一次请求的用量 */
+	void Record(const FString& Model, uint32 SessionId, const FOpenAIUsage& Usage);
+
+	/** 按模型的累计 */
+	const TMap<FString, FTotals>& GetModelTotals() const { return ModelTotals; }
+
+	/** 某一天（本地时间）的累计 */
+	FTotals GetDayTotals(const FDateTime& Day) const;
+
+	/** 本次运行中某个会话的累计 */
+	FTotals GetSessionTotals(uint32 SessionId) const;
+
+	/** 某天按模型计算的费用 */
+	double GetDayCost(const FDateTime& Day) const;
+
+	/** 按模型单价计算费用，未配置单价的模型为0 */
+	double ComputeCost(const FString& Model, const FTotals& Totals) const;
+
+	/**
+	 * 发送前检查请求规模与当日预算
+	 * @param PromptTokens 估算的提示token数
+	 * @param MaxTokens 回复的token上限
+	 * @param OutWarning 超出阈值时的提示
+	 * @return 是否需要提醒
+	 */
+	bool CheckRequest(const FString& Model, int32 PromptTokens, int32 MaxTokens, FString& OutWarning) const;
+
+	/** 今日、近7天与各模型用量的摘要 */
+	FString BuildSummary() const;
+
+	/** 每次记录变化时加一，供界面判断是否需要刷新 */
+	uint32 GetGeneration() const { return Generation; }
+
+private:
+	/** 构造函数 */
+	FDeepseekUsageLedger();
+
+	/** 本地日期的天序号 */
+	static int32 GetDayNumber(const FDateTime& LocalTime);
+
+	/** 读取账本文件，截掉末尾不完整的记录 */
+	void Load();
+
+	/** 把一条记录计入各项累计 */
+	void Accumulate(const FString& Model, int32 DayNumber, uint32 SessionId, int32 PromptTokens, int32 CompletionTokens, int32 CacheHitTokens);
+
+	/** 追加写入文件 */
+	bool Append(const TArray<uint8>& Bytes);
+
+	/** 模型在账本中的编号，首次出现时写入模型记录 */
+	uint16 GetModelId(const FString& Model, TArray<uint8>& OutBytes);
+
+private:
+	/** 账本文件 */
+	FString FilePath;
+
+	/** 文件中的模型名，按编号 */
+	TArray<FString> ModelNames;
+
+	/** 各项累计 */
+	TMap<FString, FTotals> ModelTotals;
+	TMap<int32, FTotals> DayTotals;
+	TMap<int32, TMap<FString, FTotals>> DayModelTotals;
+	TMap<uint32, FTotals> SessionTotals;
+
+	/** 各模型单价 */
+	TMap<FString, FPrice> Prices;
+
+	/** 每日预算，0表示不限制 */
+	float DailyBudget;
+
+	/** 提示token数超过此值时提醒，0表示不提醒 */
+	int32 LargeRequestTokens;
+
+	uint32 Generation;
+
+	/** 全局实例 */
+	static TUniquePtr<FDeepseekUsageLedger> Instance;
+};
@@ -4,26 +4,13 @@
 #include "Widgets/SCompoundWidget.h"
 #include "Widgets/Input/SEditableTextBox.h"
 #include "Widgets/Input/SButton.h"
-#include "Widgets/Views/SListView.h"
+#include "Widgets/SBoxPanel.h"
+#include "Widgets/Layout/SWidgetSwitcher.h"
 #include "Widgets/Input/SComboBox.h"
 #include "Widgets/SWindow.h"
-#include "DeepseekOpenAIService.h"
+#include "SDeepseekChatSession.h"
 #include "Widgets/Input/SMultiLineEditableTextBox.h"
 
-/**
- * 聊天消息结构体
- */
-struct FChatMessage
-{
-    FString Sender;
-    FString Message;
-    bool bIsUser;
-
-    FChatMessage(const FString& InSender, const FString& InMessage, bool bInIsUser)
-        : Sender(InSender), Message(InMessage), bIsUser(bInIsUser)
-    {}
-};
-
 /**
  * 模型信息结构体
  */
@@ -39,6 +26,7 @@ struct FModelInfo
 
 /**
  * AI问答界面小部件
+ * 在同一个停靠页中管理多个会话，设置由所有会话共用
  */
 class DEEPSEEK_API SDeepseekAIChat : public SCompoundWidget
 {
@@ -47,36 +35,48 @@ public:
         : _ApiKey("")
         , _ApiUrl("https://api.deepseek.com/chat/completions")
         , _Model("deepseek-chat")
+        , _PersistSessions(true)
     {}
         SLATE_ARGUMENT(FString, ApiKey)
         SLATE_ARGUMENT(FString, ApiUrl)
         SLATE_ARGUMENT(FString, Model)
+        /** 是否把会话保存到磁盘并在打开时恢复 */
+        SLATE_ARGUMENT(bool, PersistSessions)
     SLATE_END_ARGS()
 
     /** 构造函数 */
     void Construct(const FArguments& InArgs);
 
+    /** 当前显示的会话 */
+    TSharedPtr<SDeepseekChatSession> GetActiveSession() const;
+
 private:
-    /** 发送消息回调 */
-    FReply OnSendMessage();
-    
-    /** 清空聊天记录回调 */
-    FReply OnClearChat();
-    
-    /** 发送AI请求 */
-    void SendAIRequest(const FString& UserMessage);
-    
-    /** 处理AI响应 */
-    void HandleAIResponse(const FString& Response, bool bSuccess);
-    
-    /** 创建聊天消息行 */
-    TSharedRef<ITableRow> OnGenerateRow(TSharedPtr<FChatMessage> Message, const TSharedRef<STableViewBase>& OwnerTable);
-
-    /** 添加等待消息 */
-    void AddWaitingMessage();
-
-    /** 移除等待消息 */
-    void RemoveWaitingMessage();
+    /** 新建会话并切换过去 */
+    FReply OnNewSession();
+
+    /** 切换到指定会话 */
+    FReply OnSelectSession(TSharedRef<SDeepseekChatSession> Session);
+
+    /** 关闭指定会话：只卸载，聊天记录保留，下次打开时恢复 */
+    FReply OnCloseSession(TSharedRef<SDeepseekChatSession> Session);
+
+    /** 确认后永久删除当前会话的聊天记录并关闭它 */
+    FReply OnDeleteActiveSession();
+
+    /** 从标签栏移除会话，没有会话时新建一个 */
+    void RemoveSession(TSharedRef<SDeepseekChatSession> Session);
+
+    /** 创建一个会话小部件 */
+    TSharedRef<SDeepseekChatSession> CreateSession(TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log);
+
+    /** 添加会话并切换过去 */
+    void AddSession(TSharedRef<SDeepseekChatSession> Session);
+
+    /** 恢复已保存的会话，返回恢复的数量 */
+    int32 RestoreSessions();
+
+    /** 重建会话标签栏 */
+    void RefreshSessionTabs();
 
     /** 显示设置窗口 */
     FReply OnShowSettings();
@@ -109,26 +109,20 @@ private:
     static const FString ConfigFileName;
 
 private:
-    /** 聊天消息列表 */
-    TArray<TSharedPtr<FChatMessage>> ChatMessages;
-    
-    /** 聊天消息列表视图 */
-    TSharedPtr<SListView<TSharedPtr<FChatMessage>>> ChatListView;
-    
-    /** 输入文本框 */
-    TSharedPtr<SEditableTextBox> InputTextBox;
+    /** 所有会话共用的设置 */
+    TSharedPtr<FDeepseekChatSettings> Settings;
 
-    /** OpenAI服务 */
-    TSharedPtr<FDeepseekOpenAIService> OpenAIService;
+    /** 会话列表，顺序与标签栏一致 */
+    TArray<TSharedPtr<SDeepseekChatSession>> Sessions;
 
-    /** 聊天历史 */
-    TArray<FOpenAIMessage> ChatHistory;
+    /** 显示当前会话的切换器 */
+    TSharedPtr<SWidgetSwitcher> SessionSwitcher;
 
-    /** 是否正在等待AI响应 */
-    bool bIsWaiting;
+    /** 会话标签栏 */
+    TSharedPtr<SHorizontalBox> SessionTabBar;
 
-    /** 等待消息的索引 */
-    int32 WaitingMessageIndex;
+    /** 是否保存会话 */
+    bool bPersistSessions;
 
     /** 设置窗口 */
     TSharedPtr<SWindow> SettingsWindow;
@@ -157,22 +151,12 @@ private:
     /** 临时模型 */
     FString TempModel;
 
-    /** 当前API密钥 */
-    FString CurrentApiKey;
-
-    /** 当前API地址 */
-    FString CurrentApiUrl;
-
-    /** 当前模型 */
-    FString CurrentModel;
-
-    
-    /** 当前系统提示词 */
-    FString CurrentSystemPrompt;
-
     /** 临时系统提示词 */
     FString TempSystemPrompt;
 
     /** 系统提示词输入框 */
     TSharedPtr<SMultiLineEditableTextBox> SystemPromptTextBox;
+
+    /** 响应缓存容量上限（MB） */
+    int32 CurrentResponseCacheMaxMB;
 }; 
\ No newline at end of file
@@ -0,0 +1,282 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/Input/SEditableTextBox.h"
+#include "Widgets/Input/SButton.h"
+#include "Widgets/Input/SCheckBox.h"
+#include "Widgets/Views/SListView.h"
+#include "DeepseekOpenAIService.h"
+#include "DeepseekSessionLog.h"
+
+/**
+ * 聊天消息结构体
+ */
+struct FChatMessage
+{
+	FString Sender;
+
+	/** 消息内容，与聊天历史共享同一份不可变文本 */
+	FDeepseekMessageText Message;
+
+	bool bIsUser;
+
+	/** 是否为等待用户确认的相似问题历史回答 */
+	bool bIsSuggestion;
+
+	FChatMessage(const FString& InSender, const FDeepseekMessageText& InMessage, bool bInIsUser)
+		: Sender(InSender), Message(InMessage), bIsUser(bInIsUser), bIsSuggestion(false)
+	{}
+};
+
+/**
+ * 所有会话共用的设置，由问答界面加载和保存
+ */
+struct FDeepseekChatSettings
+{
+	FString ApiKey;
+	FString ApiUrl;
+	FString Model;
+	FString SystemPrompt;
+
+	/** 上下文总token上限 */
+	int32 MaxContextTokens = 64000;
+
+	/** 为回复预留的token数 */
+	int32 MaxTokens = 1000;
+
+	/** 触发历史压缩的token阈值，0表示关闭；前缀稳定模式下至少为上下文预算的90% */
+	int32 CompactThresholdTokens = 24000;
+
+	/** 历史压缩使用的模型 */
+	FString CompactModel = TEXT("deepseek-chat");
+
+	/**
+	 * 前缀稳定模式：修改系统提示词时追加新的系统消息，不改写已发送的历史。
+	 * 历史压缩推迟到接近上下文预算时进行，每轮的前缀缓存都能命中，代价是每次请求发送的token更多；
+	 * 填满预算时摘要仍会改写一次前缀，之后的第一轮前缀缓存不命中
+	 */
+	bool bPrefixStableHistory = true;
+
+	/** 请求总超时秒数，包括重试 */
+	float RequestTimeoutSeconds = 120.0f;
+
+	/** 流式请求等待首字节的超时秒数 */
+	float FirstByteTimeoutSeconds = 30.0f;
+
+	/** 请求失败后的最大重试次数 */
+	int32 MaxRetries = 3;
+
+	/** 是否复用连接 */
+	bool bKeepAlive = true;
+
+	/** 打开问答界面时预热到API主机的连接 */
+	bool bPrewarmConnection = true;
+};
+
+/**
+ * 单个会话的聊天面板
+ * 每个会话有自己的聊天历史和服务实例，请求经模块级调度器发出，多个会话可以同时等待回复
+ */
+class DEEPSEEK_API SDeepseekChatSession : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SDeepseekChatSession)
+	{}
+		/** 共用的设置 */
+		SLATE_ARGUMENT(TSharedPtr<const FDeepseekChatSettings>, Settings)
+		/** 会话记录，构造时从中恢复最近的消息；为空时不保存 */
+		SLATE_ARGUMENT(TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe>, Log)
+		/** 会话标题或等待状态变化时调用 */
+		SLATE_EVENT(FSimpleDelegate, OnStateChanged)
+	SLATE_END_ARGS()
+
+	/** 构造函数 */
+	void Construct(const FArguments& InArgs);
+
+	/** 设置已更新，重新初始化服务；系统提示词变化时更新聊天历史 */
+	void ApplySettings(bool bSystemPromptChanged);
+
+	/** 是否正在等待AI响应 */
+	bool IsWaiting() const { return bIsWaiting; }
+
+	/** 会话标题，取第一条用户消息的开头 */
+	FText GetTitle() const;
+
+	/** 追加已有的消息，用户与AI的消息同时写入聊天历史；不发出请求，用于性能测试加载聊天记录 */
+	void AppendMessages(const TArray<TSharedPtr<FChatMessage>>& Messages);
+
+	/** 用本地内容模拟一次流式回复，界面走与真实回复相同的路径，不发出请求也不写入聊天历史 */
+	void BeginSimulatedReply();
+	void AppendSimulatedDelta(const FString& Delta);
+	void EndSimulatedReply();
+
+	/** 永久删除会话记录，只在用户确认删除会话时调用；关闭会话不删除记录 */
+	void DeleteLog();
+
+	/** 聊天列表视图，用于性能测试驱动滚动 */
+	TSharedPtr<SListView<TSharedPtr<FChatMessage>>> GetChatListView() const { return ChatListView; }
+
+private:
+	/** 发送消息回调 */
+	FReply OnSendMessage();
+
+	/** 清空聊天记录回调 */
+	FReply OnClearChat();
+
+	/** 停止等待中的请求 */
+	FReply OnStopRequest();
+
+	/** 发送AI请求 */
+	void SendAIRequest(const FDeepseekMessageText& UserMessage);
+
+	/** 按当前聊天历史发出请求 */
+	void StartAIRequest();
+
+	/** 显示相似问题的历史回答，等待用户采用或重新请求 */
+	void ShowSuggestion(const FString& SuggestedReply);
+
+	/** 采用历史回答 */
+	FReply OnAcceptSuggestion();
+
+	/** 放弃历史回答并重新请求 */
+	FReply OnRefreshSuggestion();
+
+	/** 处理AI响应 */
+	void HandleAIResponse(const FDeepseekChatReplyRef& Reply);
+
+	/** 处理AI流式增量 */
+	void HandleAIDelta(const FString& Delta);
+
+	/** 历史超过阈值时在后台压缩较早的轮次 */
+	void CompactHistoryIfNeeded();
+
+	/** 把等待期间修改的系统提示词写入聊天历史 */
+	void ApplySystemPromptToHistory();
+
+	/** 重新估算下一次请求的token数 */
+	void UpdateTokenEstimate();
+
+	/** 获取token估算文本 */
+	FText GetTokenEstimateText() const;
+
+	/** 刷新响应缓存命中统计 */
+	void UpdateCacheStats();
+
+	/** 获取响应缓存统计文本 */
+	FText GetCacheStatsText() const;
+
+	/** 聊天列表滚动回调 */
+	void OnChatListScrolled(double ScrollOffset);
+
+	/** 启用自动滚动时滚动到最新消息 */
+	void ScrollChatToBottom();
+
+	/** 从会话记录恢复最后一页消息，聊天历史按上下文预算恢复 */
+	void RestoreFromLog();
+
+	/** 向上滚动到顶部时从会话记录载入更早的一页消息 */
+	void LoadOlderMessages();
+
+	/** 会话记录中的消息转为聊天消息 */
+	TSharedPtr<FChatMessage> MakeMessageFromRecord(const FDeepseekSessionLog::FRecord& Record);
+
+	/** 把消息追加到会话记录 */
+	void LogMessage(FDeepseekSessionLog::ERole Role, const FChatMessage& Message);
+
+	/** 创建聊天消息行 */
+	TSharedRef<ITableRow> OnGenerateRow(TSharedPtr<FChatMessage> Message, const TSharedRef<STableViewBase>& OwnerTable);
+
+	/** 添加等待消息 */
+	void AddWaitingMessage();
+
+	/** 移除等待消息 */
+	void RemoveWaitingMessage();
+
+	/** 设置等待状态并通知界面 */
+	void SetWaiting(bool bInIsWaiting);
+
+private:
+	/** 共用的设置 */
+	TSharedPtr<const FDeepseekChatSettings> Settings;
+
+	/** 状态变化回调 */
+	FSimpleDelegate OnStateChanged;
+
+	/** 会话记录 */
+	TSharedPtr<FDeepseekSessionLog, ESPMode::ThreadSafe> Log;
+
+	/** 已载入的最早一条记录的序号，之前的记录还在磁盘上 */
+	int32 LogLoadedFirst;
+
+	/** 第一条用户消息，用作会话标题 */
+	FString TitleSource;
+
+	/** 消息存储，聊天记录与聊天历史中的文本都来自这里，两者只保存引用 */
+	FDeepseekMessageStore MessageStore;
+
+	/** 聊天消息列表 */
+	TArray<TSharedPtr<FChatMessage>> ChatMessages;
+
+	/** 聊天消息列表视图 */
+	TSharedPtr<SListView<TSharedPtr<FChatMessage>>> ChatListView;
+
+	/** 输入文本框 */
+	TSharedPtr<SEditableTextBox> InputTextBox;
+
+	/** OpenAI服务 */
+	TSharedPtr<FDeepseekOpenAIService> OpenAIService;
+
+	/** 进行中的请求 */
+	FDeepseekRequestHandle ActiveRequest;
+
+	/** 聊天历史 */
+	TArray<FOpenAIMessage> ChatHistory;
+
+	/** 聊天历史压缩器 */
+	TSharedPtr<class FDeepseekHistoryCompactor> HistoryCompactor;
+
+	/** 是否正在等待AI响应 */
+	bool bIsWaiting;
+
+	/** 是否自动滚动到最新消息 */
+	bool bAutoScrollToBottom;
+
+	/** 等待消息的索引 */
+	int32 WaitingMessageIndex;
+
+	/** 流式回复已收到的内容 */
+	FString StreamingContent;
+
+	/** 正在显示流式回复的文本小部件 */
+	TWeakPtr<class SDeepseekStreamingText> StreamingTextWidget;
+
+	/** 等待用户确认的历史回答消息 */
+	TSharedPtr<FChatMessage> SuggestionMessage;
+
+	/** 等待期间系统提示词被修改，回复后再写入历史 */
+	bool bSystemPromptPending;
+
+	/** 下一次请求是否跳过响应缓存 */
+	bool bBypassCache;
+
+	/** token估算文本 */
+	FText TokenEstimateText;
+
+	/** 已提醒过用量的消息，原样再次发送时不再提醒 */
+	FString BudgetConfirmedMessage;
+
+	/** 响应缓存统计文本 */
+	FText CacheStatsText;
+
+	/** 最近一次回复的提示token中命中服务端前缀缓存的部分 */
+	int32 LastPromptCacheHitTokens;
+	int32 LastPromptCacheMissTokens;
+
+	/** 本会话累计的前缀缓存命中与未命中token数 */
+	int64 TotalPromptCacheHitTokens;
+	int64 TotalPromptCacheMissTokens;
+
+	/** 最近一次实际发出的请求的各阶段耗时 */
+	FDeepseekRequestTimings LastTimings;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+#include "DeepseekRequestStats.h"
+
+/**
+ * 请求统计面板
+ * 折叠显示最近请求各阶段耗时与生成速度的p50/p95/p99，可导出为CSV；
+ * 统计变化时才重新计算，展开前不做任何计算
+ */
+class DEEPSEEK_API SDeepseekRequestStatsPanel : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SDeepseekRequestStatsPanel)
+	{}
+	SLATE_END_ARGS()
+
+	/** 构造函数 */
+	void Construct(const FArguments& InArgs);
+
+private:
+	/** 定期检查统计是否变化 */
+	EActiveTimerReturnType OnRefreshTimer(double InCurrentTime, float InDeltaTime);
+
+	/** 重新计算显示的数值 */
+	void Refresh();
+
+	/** 某一行某一列的文本，列0为p50 */
+	FText GetCellText(int32 Row, int32 Column) const;
+
+	/** 导出CSV */
+	FReply OnExportCsv();
+
+	/** 清空记录 */
+	FReply OnResetStats();
+
+private:
+	/** 行数：各阶段加生成速度 */
+	static const int32 NumRows = static_cast<int32>(EDeepseekRequestPhase::Num) + 1;
+
+	/** 每行的p50、p95、p99文本 */
+	TArray<FText> CellTexts;
+
+	/** 摘要文本 */
+	FText SummaryText;
+
+	/** 上次刷新各行与摘要时统计的版本 */
+	uint32 RefreshedGeneration;
+	uint32 SummaryGeneration;
+
+	/** 是否展开 */
+	bool bExpanded;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+
+class SVerticalBox;
+class STextBlock;
+
+/**
+ * 流式回复文本小部件
+ * 已完成的段落各自占用一个固定的文本块，新增内容只会重新排版最后一个段落；
+ * 同一帧内的多次追加会合并为一次刷新
+ */
+class DEEPSEEK_API SDeepseekStreamingText : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SDeepseekStreamingText)
+		: _Text()
+		, _HintText()
+	{}
+		/** 初始文本 */
+		SLATE_ARGUMENT(FString, Text)
+		/** 尚无内容时显示的提示 */
+		SLATE_ARGUMENT(FString, HintText)
+	SLATE_END_ARGS()
+
+	/** 构造函数 */
+	void Construct(const FArguments& InArgs);
+
+	/** 追加增量文本，下一帧统一刷新 */
+	void AppendText(const FString& Delta);
+
+private:
+	/** 每帧最多一次，把累积的增量写入排版 */
+	EActiveTimerReturnType FlushPendingText(double InCurrentTime, float InDeltaTime);
+
+	/** 把文本追加到段落末尾，遇到换行时固定当前段落并开启新段落 */
+	void AppendToParagraphs(const FString& Text);
+
+	/** 新建一个段落作为末尾段落 */
+	void AddTailParagraph();
+
+private:
+	/** 段落容器 */
+	TSharedPtr<SVerticalBox> ParagraphBox;
+
+	/** 末尾段落的文本块 */
+	TSharedPtr<STextBlock> TailTextBlock;
+
+	/** 末尾段落的内容 */
+	FString TailParagraph;
+
+	/** 尚未刷新的增量 */
+	FString PendingText;
+
+	/** 是否已注册刷新 */
+	bool bFlushScheduled;
+
+	/** 是否正在显示提示 */
+	bool bShowingHint;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+
+/**
+ * 用量面板
+ * 折叠时显示今日的token数与费用，展开后显示近7天与各模型的累计；账本变化时才重新生成文本
+ */
+class DEEPSEEK_API SDeepseekUsagePanel : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SDeepseekUsagePanel)
+	{}
+	SLATE_END_ARGS()
+
+	/** 构造函数 */
+	void Construct(const FArguments& InArgs);
+
+private:
+	/** 定期检查账本是否变化 */
+	EActiveTimerReturnType OnRefreshTimer(double InCurrentTime, float InDeltaTime);
+
+	/** 重新生成显示的文本 */
+	void Refresh();
+
+private:
+	/** 今日用量 */
+	FText HeaderText;
+
+	/** 完整摘要 */
+	FText SummaryText;
+
+	/** 上次刷新时账本的版本 */
+	uint32 RefreshedGeneration;
+
+	/** 上次刷新时的日期，跨天后今日用量需要重新计算 */
+	int32 RefreshedDay;
+};